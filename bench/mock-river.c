@@ -0,0 +1,426 @@
+/* A tiny stand-in for river: it only implements wl_output and
+ * river_layout_manager_v3, floods the layout client it starts with layout
+ * demands and measures how long the commits take.
+ *
+ * mock-river [options] -- client [args...]
+ */
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <wayland-server.h>
+
+#include "river-layout-v3-server-protocol.h"
+
+#define WIDTH 1920
+#define HEIGHT 1080
+
+typedef struct {
+	uint32_t serial;
+	uint32_t view_count;
+	uint64_t sent;
+} Demand;
+
+typedef struct {
+	struct wl_global *global;
+	struct wl_resource *layout;
+
+	uint32_t sent;         // demands sent so far
+	uint32_t pushed;       // views pushed since the last commit
+	Demand *in_flight;     // oldest first
+	uint32_t n_in_flight;
+} MockOutput;
+
+static struct {
+	uint32_t outputs;
+	uint32_t demands;
+	uint32_t views;
+	uint32_t tags;
+	uint32_t window;
+
+	struct wl_display *display;
+	MockOutput *output;
+	uint32_t layouts;
+	uint32_t serial;
+
+	uint64_t start;
+	uint64_t *latency;
+	uint32_t n_latency;
+	uint32_t commits;
+	uint32_t stale;
+	uint32_t superseded;
+	uint32_t mismatches;
+
+	bool done;
+	bool failed;
+} mock;
+
+static uint64_t now_usec (void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void fail (const char *message)
+{
+	fprintf(stderr, "mock-river: %s\n", message);
+	mock.failed = true;
+	mock.done = true;
+}
+
+static void check_done (void)
+{
+	for (uint32_t i = 0; i < mock.outputs; i++) {
+		if (mock.output[i].sent < mock.demands || mock.output[i].n_in_flight > 0) {
+			return;
+		}
+	}
+	mock.done = true;
+}
+
+/* Keep window demands in flight, like river does when views come and go
+ * faster than the layout answers */
+static void send_demands (MockOutput *out)
+{
+	while (out->layout != NULL && out->sent < mock.demands &&
+			out->n_in_flight < mock.window) {
+		Demand *demand = &out->in_flight[out->n_in_flight++];
+
+		demand->serial = ++mock.serial;
+		demand->view_count = 1 + out->sent % mock.views;
+		demand->sent = now_usec();
+		river_layout_v3_send_layout_demand(out->layout, demand->view_count,
+				WIDTH, HEIGHT, 1u << (out->sent % mock.tags), demand->serial);
+		out->sent++;
+	}
+}
+
+static void layout_destroy (struct wl_client *client, struct wl_resource *resource)
+{
+	wl_resource_destroy(resource);
+}
+
+static void layout_push_view_dimensions (struct wl_client *client,
+		struct wl_resource *resource, int32_t x, int32_t y, uint32_t width,
+		uint32_t height, uint32_t serial)
+{
+	MockOutput *out = wl_resource_get_user_data(resource);
+
+	out->pushed++;
+}
+
+static void layout_commit (struct wl_client *client, struct wl_resource *resource,
+		const char *layout_name, uint32_t serial)
+{
+	MockOutput *out = wl_resource_get_user_data(resource);
+	uint32_t pushed = out->pushed;
+	uint32_t i;
+
+	out->pushed = 0;
+	mock.commits++;
+
+	for (i = 0; i < out->n_in_flight; i++) {
+		if (out->in_flight[i].serial == serial) {
+			break;
+		}
+	}
+	if (i == out->n_in_flight) {
+		mock.stale++;
+		return;
+	}
+
+	/* river ignores commits for anything but the newest demand, and so
+	 * do we */
+	Demand *demand = &out->in_flight[i];
+	if (i != out->n_in_flight - 1) {
+		mock.stale++;
+	} else {
+		if (pushed != demand->view_count) {
+			mock.mismatches++;
+		}
+		mock.latency[mock.n_latency++] = now_usec() - demand->sent;
+	}
+
+	/* what was sent before will never be answered */
+	mock.superseded += i;
+	memmove(out->in_flight, out->in_flight + i + 1,
+			(out->n_in_flight - i - 1) * sizeof(Demand));
+	out->n_in_flight -= i + 1;
+
+	send_demands(out);
+	check_done();
+}
+
+static const struct river_layout_v3_interface layout_impl = {
+	.destroy = layout_destroy,
+	.push_view_dimensions = layout_push_view_dimensions,
+	.commit = layout_commit,
+};
+
+static void layout_resource_destroy (struct wl_resource *resource)
+{
+	MockOutput *out = wl_resource_get_user_data(resource);
+
+	out->layout = NULL;
+	if (!mock.done) {
+		fail("layout destroyed before the benchmark was done");
+	}
+}
+
+static void manager_destroy (struct wl_client *client, struct wl_resource *resource)
+{
+	wl_resource_destroy(resource);
+}
+
+static void manager_get_layout (struct wl_client *client, struct wl_resource *resource,
+		uint32_t id, struct wl_resource *output, const char *namespace)
+{
+	MockOutput *out = wl_resource_get_user_data(output);
+	struct wl_resource *layout = wl_resource_create(client,
+			&river_layout_v3_interface, wl_resource_get_version(resource), id);
+
+	if (layout == NULL) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(layout, &layout_impl, out, layout_resource_destroy);
+
+	if (out->layout != NULL) {
+		river_layout_v3_send_namespace_in_use(layout);
+		return;
+	}
+	out->layout = layout;
+
+	/* start the clock once every output has its layout */
+	if (++mock.layouts == mock.outputs) {
+		mock.start = now_usec();
+		for (uint32_t i = 0; i < mock.outputs; i++) {
+			send_demands(&mock.output[i]);
+		}
+	}
+}
+
+static const struct river_layout_manager_v3_interface manager_impl = {
+	.destroy = manager_destroy,
+	.get_layout = manager_get_layout,
+};
+
+static void manager_bind (struct wl_client *client, void *data, uint32_t version, uint32_t id)
+{
+	struct wl_resource *resource = wl_resource_create(client,
+			&river_layout_manager_v3_interface, version, id);
+
+	if (resource == NULL) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(resource, &manager_impl, NULL, NULL);
+}
+
+static void output_release (struct wl_client *client, struct wl_resource *resource)
+{
+	wl_resource_destroy(resource);
+}
+
+static const struct wl_output_interface output_impl = {
+	.release = output_release,
+};
+
+static void output_bind (struct wl_client *client, void *data, uint32_t version, uint32_t id)
+{
+	struct wl_resource *resource = wl_resource_create(client,
+			&wl_output_interface, version, id);
+
+	if (resource == NULL) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(resource, &output_impl, data, NULL);
+	wl_output_send_mode(resource, WL_OUTPUT_MODE_CURRENT, WIDTH, HEIGHT, 60000);
+	wl_output_send_done(resource);
+}
+
+static int compare_latency (const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *) a;
+	uint64_t y = *(const uint64_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+static uint64_t percentile (double q)
+{
+	if (mock.n_latency == 0) {
+		return 0;
+	}
+	uint32_t rank = (uint32_t) (q * mock.n_latency);
+	return mock.latency[rank < mock.n_latency ? rank : mock.n_latency - 1];
+}
+
+static void report (uint64_t elapsed)
+{
+	double seconds = elapsed / 1e6;
+
+	qsort(mock.latency, mock.n_latency, sizeof(uint64_t), compare_latency);
+	printf("outputs %u, demands %u, commits %u, superseded %u, stale %u, "
+			"mismatched %u\n",
+			mock.outputs, mock.outputs * mock.demands, mock.commits,
+			mock.superseded, mock.stale, mock.mismatches);
+	printf("%.3f s, %.0f demands/s, latency p50 %llu us, p99 %llu us, "
+			"max %llu us\n",
+			seconds, seconds > 0 ? mock.outputs * mock.demands / seconds : 0.0,
+			(unsigned long long) percentile(0.5),
+			(unsigned long long) percentile(0.99),
+			(unsigned long long) (mock.n_latency ? mock.latency[mock.n_latency - 1] : 0));
+}
+
+static pid_t spawn_client (char **argv, const char *socket)
+{
+	pid_t pid = fork();
+
+	if (pid == 0) {
+		unsetenv("WAYLAND_SOCKET");
+		setenv("WAYLAND_DISPLAY", socket, 1);
+		execvp(argv[0], argv);
+		fprintf(stderr, "mock-river: failed to run %s: %s\n", argv[0],
+				strerror(errno));
+		_exit(127);
+	}
+	return pid;
+}
+
+static void usage (const char *name)
+{
+	fprintf(stderr,
+			"usage: %s [options] -- client [args...]\n"
+			"  -o, --outputs N   number of outputs (1)\n"
+			"  -d, --demands N   demands per output (1000)\n"
+			"  -v, --views N     view counts cycle through 1..N (16)\n"
+			"  -t, --tags N      tags cycle through the first N (1)\n"
+			"  -w, --window N    demands in flight per output (1)\n"
+			"  -T, --timeout S   give up after S seconds (60)\n",
+			name);
+}
+
+static bool parse_uint (const char *arg, uint32_t *value)
+{
+	char *end;
+	unsigned long v = strtoul(arg, &end, 10);
+
+	if (*arg == '\0' || *end != '\0' || v == 0 || v > UINT32_MAX) {
+		return false;
+	}
+	*value = (uint32_t) v;
+	return true;
+}
+
+int main (int argc, char *argv[])
+{
+	static const struct option options[] = {
+		{ "outputs", required_argument, NULL, 'o' },
+		{ "demands", required_argument, NULL, 'd' },
+		{ "views", required_argument, NULL, 'v' },
+		{ "tags", required_argument, NULL, 't' },
+		{ "window", required_argument, NULL, 'w' },
+		{ "timeout", required_argument, NULL, 'T' },
+		{ NULL, 0, NULL, 0 },
+	};
+	uint32_t timeout = 60;
+	int opt;
+
+	mock.outputs = 1;
+	mock.demands = 1000;
+	mock.views = 16;
+	mock.tags = 1;
+	mock.window = 1;
+
+	while ((opt = getopt_long(argc, argv, "o:d:v:t:w:T:", options, NULL)) != -1) {
+		bool ok;
+		switch (opt) {
+			case 'o': ok = parse_uint(optarg, &mock.outputs); break;
+			case 'd': ok = parse_uint(optarg, &mock.demands); break;
+			case 'v': ok = parse_uint(optarg, &mock.views); break;
+			case 't': ok = parse_uint(optarg, &mock.tags) && mock.tags <= 32; break;
+			case 'w': ok = parse_uint(optarg, &mock.window); break;
+			case 'T': ok = parse_uint(optarg, &timeout); break;
+			default: ok = false; break;
+		}
+		if (!ok) {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind >= argc) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	mock.output = calloc(mock.outputs, sizeof(MockOutput));
+	mock.latency = calloc((size_t) mock.outputs * mock.demands, sizeof(uint64_t));
+	for (uint32_t i = 0; i < mock.outputs; i++) {
+		mock.output[i].in_flight = calloc(mock.window, sizeof(Demand));
+	}
+
+	mock.display = wl_display_create();
+	const char *socket = wl_display_add_socket_auto(mock.display);
+	if (socket == NULL) {
+		fprintf(stderr, "mock-river: failed to create a socket\n");
+		return EXIT_FAILURE;
+	}
+
+	wl_global_create(mock.display, &river_layout_manager_v3_interface, 2,
+			NULL, manager_bind);
+	for (uint32_t i = 0; i < mock.outputs; i++) {
+		mock.output[i].global = wl_global_create(mock.display,
+				&wl_output_interface, 4, &mock.output[i], output_bind);
+	}
+
+	pid_t client = spawn_client(argv + optind, socket);
+	if (client < 0) {
+		fprintf(stderr, "mock-river: fork failed: %s\n", strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	struct wl_event_loop *loop = wl_display_get_event_loop(mock.display);
+	uint64_t deadline = now_usec() + (uint64_t) timeout * 1000000;
+	while (!mock.done) {
+		wl_display_flush_clients(mock.display);
+		if (wl_event_loop_dispatch(loop, 100) < 0 && errno != EINTR) {
+			fail("dispatching failed");
+			break;
+		}
+		if (now_usec() > deadline) {
+			fail("timed out");
+			break;
+		}
+		if (waitpid(client, NULL, WNOHANG) == client) {
+			client = -1;
+			fail("the client exited");
+			break;
+		}
+	}
+	uint64_t elapsed = now_usec() - mock.start;
+
+	if (!mock.failed) {
+		report(elapsed);
+	}
+
+	if (client > 0) {
+		kill(client, SIGTERM);
+		waitpid(client, NULL, 0);
+	}
+	wl_display_destroy_clients(mock.display);
+	wl_display_destroy(mock.display);
+
+	return mock.failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
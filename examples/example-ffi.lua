@@ -0,0 +1,65 @@
+#!/bin/luajit
+-- A tall layout like the one of example.lua, through the LuaJIT FFI: every
+-- call the loop makes is compiled by the JIT
+package.path = "lua/?.lua;" .. package.path
+local ffi = require "ffi"
+local griver = require "griver.ffi"
+
+local floor = math.floor
+local min = math.min
+
+local ctx = griver.new "rivertile"
+
+-- main-count, main-ratio, view-padding, outer-padding, main-location,
+-- layout and reset are parsed and applied to the tag state in C
+ctx:register_tag_commands()
+
+-- allocated once, filled for every demand
+local state = ffi.new "GriverFfiTagState"
+local capacity = 64
+local rects = griver.rects(capacity)
+
+-- main views on the left, the rest stacked on the right, main-location is
+-- left out to keep it short
+local function tile(event)
+  local view_count = event.view_count
+  local s = griver.get_tag_state(event.output, event.tags, state)
+
+  if view_count > capacity then
+    capacity = view_count
+    rects = griver.rects(capacity)
+  end
+
+  local pad = s.outer_padding
+  local width = event.width - 2 * pad
+  local height = event.height - 2 * pad
+  local main_count = min(s.main_count, view_count)
+  local rest = view_count - main_count
+  local main_width = rest > 0 and floor(width * s.ratio) or width
+
+  for i = 0, view_count - 1 do
+    local x, w, count, index
+    if i < main_count then
+      x, w, count, index = 0, main_width, main_count, i
+    else
+      x, w, count, index = main_width, width - main_width, rest, i - main_count
+    end
+    local h = floor(height / count)
+    rects[4 * i] = pad + x + s.view_padding
+    rects[4 * i + 1] = pad + index * h + s.view_padding
+    rects[4 * i + 2] = w - 2 * s.view_padding
+    rects[4 * i + 3] = h - 2 * s.view_padding
+  end
+
+  griver.push_rects(event.output, rects, 4 * view_count, "[]=", event.serial)
+end
+
+for event in ctx:events() do
+  if event.type == griver.DEMAND then
+    tile(event)
+  elseif event.type == griver.COMMAND then
+    print(string.format("Unknown command: %s", ffi.string(event.command)))
+  elseif event.type == griver.OUTPUT_REMOVE then
+    print(string.format("output %d removed", event.uid))
+  end
+end
@@ -1,20 +1,19 @@
 #include "griver-output.h"
 #include "griver-context.h"
 #include <stdio.h>
+#include <string.h>
 
-GriverOutput *outputs = NULL;
-
-uint32_t main_count = 1;
-uint32_t view_padding = 1;
-uint32_t outer_padding = 1;
-double ratio = 0.6;
-GriverRotation rotation = GRIVER_LEFT;
-
-void
+/* Lay out the views yourself, here with the tall layout and the settings
+ * of the tag */
+static void
 tile(GriverOutput *output, uint32_t view_count, uint32_t width,
 		uint32_t height, uint32_t tags, uint32_t serial)
 {
-	g_river_output_tall_layout(output, view_count, width, height, main_count, view_padding, outer_padding, ratio, rotation, serial);
+	const GriverTagState *state = g_river_output_get_tag_state(output, tags);
+
+	g_river_output_tall_layout(output, view_count, width, height,
+			state->main_count, state->view_padding, state->outer_padding,
+			state->ratio, state->rotation, serial);
 	g_river_output_commit_dimensions(output, "[]=", serial);
 }
 
@@ -27,7 +26,15 @@ user_command(GriverOutput *output, const char *cmd, uint32_t tags)
 
 void add_output(GriverContext *ctx, GriverOutput *output, gpointer user_data)
 {
-	g_signal_connect(output, "layout-demand", G_CALLBACK(tile), NULL);
+	gboolean own_layout = GPOINTER_TO_INT(user_data);
+
+	if (own_layout) {
+		g_signal_connect(output, "layout-demand", G_CALLBACK(tile), NULL);
+	} else {
+		/* or let griver do it, using the settings of the tag, without
+		 * going through the layout-demand signal */
+		g_river_output_arrange_on_demand(output);
+	}
 	g_signal_connect(output, "user-command", G_CALLBACK(user_command), NULL);
 }
 
@@ -42,9 +49,33 @@ int main(int argc, char *argv[])
 	GError *error = NULL;
 
 	ctx = (GriverContext *)g_river_context_new("rivertile");
+	/* main-ratio, main-count etc are handled by griver, the rest ends up
+	 * in user_command */
+	g_river_context_register_tag_commands(ctx);
+	/* arrange only cares about the newest demand */
+	g_river_context_set_coalesce_demands(ctx, true);
 
-	g_signal_connect(ctx, "output-add", G_CALLBACK(add_output), NULL);
+	/* example --tile lays out the views in tile() */
+	gboolean own_layout = argc == 2 && strcmp(argv[1], "--tile") == 0;
+	g_signal_connect(ctx, "output-add", G_CALLBACK(add_output),
+			GINT_TO_POINTER(own_layout));
 	g_signal_connect(ctx, "output-remove", G_CALLBACK(output_delete), NULL);
+
+	/* example --record session.log, then example --replay session.log
+	 * runs the same session again without river */
+	if (argc == 3 && strcmp(argv[1], "--replay") == 0) {
+		guint mismatches = 0;
+		gboolean ret = g_river_context_replay_session(ctx, argv[2],
+				&mismatches, &error);
+		printf("Ret: %d, %u commits differ\n", ret, mismatches);
+		return ret && mismatches == 0 ? 0 : 1;
+	}
+	if (argc == 3 && strcmp(argv[1], "--record") == 0 &&
+			!g_river_context_record_session(ctx, argv[2], &error)) {
+		fprintf(stderr, "%s\n", error->message);
+		return 1;
+	}
+
 	gboolean ret = g_river_context_run(ctx, &error);
 	printf("Ret: %d\n", ret);
 
@@ -6,66 +6,16 @@ local griver = lgi.require("Griver", 0.1)
 local min = math.min
 local max = math.max
 
--- Our screens
-local outputs = {}
-
-local function mktags()
-  local tags = {}
-  -- create 9 tags for each output
-  for _ = 1, 9 do
-    local tag = {
-      main_count = 1,
-      main_ratio = 0.6,
-      outer_padding = 0,
-      view_padding = 0,
-      rotation = griver.Rotation.LEFT,
-    }
-    table.insert(tags, tag)
-  end
-  return tags
-end
-
--- Sets the defaults
-local function reset(o)
-  o.tags = mktags()
-end
-
-local function new_output(output)
-  local o = {
-    output = output,
-  }
-  reset(o)
-  return o
-end
-
-local function get_output(out)
-  local uid = out:get_uid()
-  return outputs[uid]
-end
-
+-- The settings of every tag live in griver, one GriverTagState per tag
+-- and output. lgi hands out the state itself, but other bindings copy it,
+-- so changes go back through set_tag_state
 local function get_tag(out, tags)
-  local output = get_output(out)
-  return output.tags[griver.first_set_bit_pos(tags)]
+  return out:get_tag_state(tags)
 end
 
--- tile using the a pre-defined algorithm
+-- tile using the settings of the tag
 local function tile(out, view_count, width, height, tags, serial)
-  local tag = get_tag(out, tags)
-  local rotation = tag.rotation
-
-  out:tall_layout(
-    view_count,
-    width,
-    height,
-    tag.main_count,
-    tag.view_padding,
-    tag.outer_padding,
-    tag.main_ratio,
-    rotation,
-    serial
-  )
-
-  out:commit_dimensions("[]=", serial)
+  out:arrange(view_count, width, height, tags, serial)
 end
 
 -- Or define your own algorithm
@@ -116,6 +66,18 @@ local function tile_self(
     main_height_rem = usable_height % main_count
   end
 
+  -- collect every view and send them in one call, instead of one
+  -- push_view_dimensions per view
+  local dims = {}
+  local n = 0
+  local function push(x, y, w, h)
+    dims[n + 1] = x
+    dims[n + 2] = y
+    dims[n + 3] = w
+    dims[n + 4] = h
+    n = n + 4
+  end
+
   for i = 0, view_count - 1 do
     local x, y, lwidth, lheight
 
@@ -149,98 +111,58 @@ local function tile_self(
     lheight = lheight - 2 * view_padding
 
     if rotation == rotation.LEFT then
-      out:push_view_dimensions(x + outer_padding, y + outer_padding, lwidth, lheight, serial)
+      push(x + outer_padding, y + outer_padding, lwidth, lheight)
     elseif rotation == rotation.RIGHT then
-      out:push_view_dimensions(width - lwidth - x + outer_padding, y + outer_padding, lwidth, lheight, serial)
+      push(width - lwidth - x + outer_padding, y + outer_padding, lwidth, lheight)
     elseif rotation == rotation.TOP then
-      out:push_view_dimensions(y + outer_padding, x + outer_padding, lheight, lwidth, serial)
+      push(y + outer_padding, x + outer_padding, lheight, lwidth)
     elseif rotation == rotation.BOTTOM then
-      out:push_view_dimensions(y + outer_padding, usable_width - lwidth - x + outer_padding, lheight, lwidth, serial)
+      push(y + outer_padding, usable_width - lwidth - x + outer_padding, lheight, lwidth)
     end
   end
-  out:commit_dimensions("[]=", serial)
-end
-
-local function clamp(val, low, upp)
-  return min(max(low, upp), max(min(low, upp), val))
-end
-
-local function find(command, match)
-  local _, _, n = string.find(command, match)
-  return n
-end
-
-local function split(str)
-  local buf = {}
-  for word in str:gmatch "%S+" do
-    table.insert(buf, word)
-  end
-  return buf
+  out:push_view_dimensions_array(dims, "[]=", serial)
 end
 
-local function command(out, cmd, tags)
-  local output = get_output(out)
+-- Commands registered with register_command are parsed by griver and
+-- arrive typed, as "command::<name>"
+local function gaps(out, cmd, tags)
+  -- gaps +2 / gaps 4, set both paddings at once
   local tag = get_tag(out, tags)
-
-  local args = split(cmd)
-
-  if not args[1] then
-    return
-  end
-
-  if args[1] == "main-count" and args[2] then
-    local num = tonumber(args[2])
-    if num then
-      tag.main_count = tag.main_count + num
-    end
-  end
-
-  if args[1] == "view-padding" and args[2] then
-    local num = tonumber(args[2])
-    if num then
-      tag.view_padding = tag.main_count + num
-    end
-  end
-
-  if args[1] == "outer-padding" and args[2] then
-    local num = tonumber(args[2])
-    if num then
-      tag.outer_padding = tag.outer_padding + num
-    end
-  end
-
-  if args[1] == "main-ratio" and args[2] then
-    local num = tonumber(args[2])
-    if num then
-      tag.main_ratio = clamp(tag.main_ratio + tonumber(num), 0.1, 0.9)
-    end
-  end
-
-  local rotation = find(cmd, "main%-location%s+(%a+)")
-  if rotation then
-    rotation = rotation:upper()
-    tag.rotation = griver.Rotation[rotation] or tag.rotation
+  local gap = cmd.int_value
+  if cmd.relative then
+    gap = gap + tag.view_padding
   end
+  gap = max(gap, 0)
+  tag.view_padding = gap
+  tag.outer_padding = gap
+  out:set_tag_state(tags, tag)
+end
 
-  if args[1] == "reset" then
-    reset(output)
-  end
+local function user_command(_, cmd, _)
+  print(string.format("Unknown command: %s", cmd))
 end
 
 local ctx = griver.Context.new "rivertile"
 
+-- main-count, main-ratio, view-padding, outer-padding, main-location,
+-- layout and reset are parsed and applied to the tag state in C
+ctx:register_tag_commands()
+ctx:register_command("gaps", griver.ArgType.INT, nil)
+
 ctx.on_output_add = function(_, output)
-  local uid = output:get_uid()
-  outputs[uid] = new_output(output)
+  -- replay layouts we already computed instead of calling tile again
+  output:set_layout_cache(true)
+  -- when a view is opened or closed, only recompute the views that move
+  output:set_incremental_layout(true)
 
   -- output.on_layout_demand = tile
   output.on_layout_demand = tile
-  output.on_user_command = command
+  output.on_command["gaps"] = gaps
+  output.on_user_command = user_command
 end
 
 ctx.on_output_remove = function(_, output)
-  local uid = output:get_uid()
-  outputs[uid] = nil
+  print(string.format("output %d removed", output:get_uid()))
 end
 
 local err = ctx:run()
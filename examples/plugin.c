@@ -0,0 +1,31 @@
+/* A layout plugin, build it with
+ *
+ *   cc -shared -fPIC -o plugin.so plugin.c $(pkg-config --cflags --libs griver-layout)
+ *
+ * and load it with g_river_layout_spec_new_from_plugin(). Edit, rebuild
+ * and run `riverctl send-layout-cmd <namespace> reload` to swap it in. */
+#include <griver-layout-plugin.h>
+
+/* The tall layout, but always with the main views on top */
+static void compute (uint32_t view_count, uint32_t width, uint32_t height,
+		const GriverLayoutParams *params, const GriverRects *rects)
+{
+	GriverLayoutParams top = *params;
+	top.rotation = GRIVER_TOP;
+
+	griver_layout_compute_rects(GRIVER_LAYOUT_TALL, view_count, width, height,
+			&top, 0, rects);
+}
+
+static const GriverLayoutPlugin plugin = {
+	.abi = GRIVER_LAYOUT_PLUGIN_ABI,
+	.size = sizeof(GriverLayoutPlugin),
+	.name = "[^]",
+	.compute = compute,
+};
+
+GRIVER_LAYOUT_PLUGIN_EXPORT const GriverLayoutPlugin *
+griver_layout_plugin_v1 (void)
+{
+	return &plugin;
+}
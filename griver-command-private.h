@@ -0,0 +1,42 @@
+#ifndef __GRIVER_COMMAND_PRIVATE_H__
+#define __GRIVER_COMMAND_PRIVATE_H__
+
+#include "griver-command.h"
+
+G_BEGIN_DECLS
+
+/* Commands that griver knows how to apply to a GriverTagState */
+typedef enum {
+	GRIVER_BUILTIN_NONE,
+	GRIVER_BUILTIN_MAIN_COUNT,
+	GRIVER_BUILTIN_MAIN_RATIO,
+	GRIVER_BUILTIN_VIEW_PADDING,
+	GRIVER_BUILTIN_OUTER_PADDING,
+	GRIVER_BUILTIN_MAIN_LOCATION,
+	GRIVER_BUILTIN_LAYOUT,
+	GRIVER_BUILTIN_RESET,
+	GRIVER_BUILTIN_RELOAD,
+} GriverBuiltinCommand;
+
+typedef struct {
+	const char *name;      // interned
+	GQuark detail;
+	GriverArgType type;
+	const char **values;   // interned, NULL terminated, for GRIVER_ARG_ENUM
+	GriverBuiltinCommand builtin;
+} GriverCommandSpec;
+
+/* name -> GriverCommandSpec */
+GHashTable *griver_command_table_new (void);
+
+void griver_command_table_add (GHashTable *table, const char *name,
+		GriverArgType type, const char * const *values, GriverBuiltinCommand builtin);
+
+void griver_command_table_add_builtins (GHashTable *table);
+
+const GriverCommandSpec *griver_command_parse (GHashTable *table,
+		const char *str, GriverCommand *cmd);
+
+G_END_DECLS
+
+#endif /* __GRIVER_COMMAND_PRIVATE_H__ */
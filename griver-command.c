@@ -0,0 +1,198 @@
+#include "griver-command.h"
+#include "griver-command-private.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+
+G_DEFINE_BOXED_TYPE (GriverCommand, g_river_command,
+		g_river_command_copy, g_river_command_free)
+
+/**
+ * g_river_command_copy:
+ * @cmd: A #GriverCommand
+ *
+ * Returns: (transfer full): a copy of @cmd
+ **/
+GriverCommand *g_river_command_copy(const GriverCommand *cmd)
+{
+	g_return_val_if_fail(cmd != NULL, NULL);
+
+	/* all strings are interned, a shallow copy is enough */
+	GriverCommand *copy = g_new(GriverCommand, 1);
+	*copy = *cmd;
+	return copy;
+}
+
+/**
+ * g_river_command_free:
+ * @cmd: A #GriverCommand
+ *
+ * Frees a command created by g_river_command_copy().
+ **/
+void g_river_command_free(GriverCommand *cmd)
+{
+	g_free(cmd);
+}
+
+static void spec_free (gpointer data)
+{
+	GriverCommandSpec *spec = data;
+
+	g_free(spec->values);
+	g_free(spec);
+}
+
+GHashTable *griver_command_table_new (void)
+{
+	/* the keys are interned, so we can compare them directly */
+	return g_hash_table_new_full(g_str_hash, g_str_equal, NULL, spec_free);
+}
+
+void griver_command_table_add (GHashTable *table, const char *name,
+		GriverArgType type, const char * const *values, GriverBuiltinCommand builtin)
+{
+	GriverCommandSpec *spec = g_new0(GriverCommandSpec, 1);
+
+	spec->name = g_intern_string(name);
+	spec->detail = g_quark_from_string(name);
+	spec->type = type;
+	spec->builtin = builtin;
+
+	if (values != NULL) {
+		guint n = 0;
+		while (values[n]) {
+			n++;
+		}
+		spec->values = g_new0(const char *, n + 1);
+		for (guint i = 0; i < n; i++) {
+			spec->values[i] = g_intern_string(values[i]);
+		}
+	}
+
+	g_hash_table_replace(table, (gpointer) spec->name, spec);
+}
+
+void griver_command_table_add_builtins (GHashTable *table)
+{
+	static const char *locations[] = { "left", "right", "top", "bottom", NULL };
+	/* same order as GriverLayout */
+	static const char *layouts[] = { "tall", "monocle", "grid", "dwindle",
+		"spiral", "centered-master", "multi-column", "deck", NULL };
+
+	griver_command_table_add(table, "main-count", GRIVER_ARG_INT, NULL,
+			GRIVER_BUILTIN_MAIN_COUNT);
+	griver_command_table_add(table, "main-ratio", GRIVER_ARG_FLOAT, NULL,
+			GRIVER_BUILTIN_MAIN_RATIO);
+	griver_command_table_add(table, "view-padding", GRIVER_ARG_INT, NULL,
+			GRIVER_BUILTIN_VIEW_PADDING);
+	griver_command_table_add(table, "outer-padding", GRIVER_ARG_INT, NULL,
+			GRIVER_BUILTIN_OUTER_PADDING);
+	griver_command_table_add(table, "main-location", GRIVER_ARG_ENUM, locations,
+			GRIVER_BUILTIN_MAIN_LOCATION);
+	griver_command_table_add(table, "layout", GRIVER_ARG_ENUM, layouts,
+			GRIVER_BUILTIN_LAYOUT);
+	griver_command_table_add(table, "reset", GRIVER_ARG_NONE, NULL,
+			GRIVER_BUILTIN_RESET);
+	griver_command_table_add(table, "reload", GRIVER_ARG_NONE, NULL,
+			GRIVER_BUILTIN_RELOAD);
+}
+
+static bool parse_arg (const GriverCommandSpec *spec, const char *arg,
+		GriverCommand *cmd)
+{
+	char *end = NULL;
+	gint64 value;
+
+	switch (spec->type) {
+		case GRIVER_ARG_NONE:
+			/* arg has its leading spaces skipped already */
+			return arg[0] == '\0';
+		case GRIVER_ARG_INT:
+			cmd->relative = arg[0] == '+' || arg[0] == '-';
+			errno = 0;
+			value = g_ascii_strtoll(arg, &end, 10);
+			if (errno == ERANGE || value < G_MININT || value > G_MAXINT) {
+				return false;
+			}
+			cmd->int_value = (gint) value;
+			break;
+		case GRIVER_ARG_FLOAT:
+			cmd->relative = arg[0] == '+' || arg[0] == '-';
+			errno = 0;
+			cmd->float_value = g_ascii_strtod(arg, &end);
+			/* strtod takes "nan" and "inf", which no ratio can be */
+			if (errno == ERANGE || !isfinite(cmd->float_value)) {
+				return false;
+			}
+			break;
+		case GRIVER_ARG_ENUM:
+			for (gint i = 0; spec->values && spec->values[i]; i++) {
+				size_t len = strlen(spec->values[i]);
+				if (g_ascii_strncasecmp(arg, spec->values[i], len) == 0 &&
+						(arg[len] == '\0' || g_ascii_isspace(arg[len]))) {
+					cmd->enum_value = i;
+					cmd->enum_name = spec->values[i];
+					end = (char *) arg + len;
+					break;
+				}
+			}
+			if (end == NULL) {
+				return false;
+			}
+			break;
+	}
+
+	if (end == arg) {
+		return false;
+	}
+	while (g_ascii_isspace(*end)) {
+		end++;
+	}
+	return *end == '\0';
+}
+
+/* Parses str into cmd, returns NULL if str isn't a registered command or
+ * the argument doesn't match */
+const GriverCommandSpec *griver_command_parse (GHashTable *table,
+		const char *str, GriverCommand *cmd)
+{
+	if (table == NULL || str == NULL) {
+		return NULL;
+	}
+
+	while (g_ascii_isspace(*str)) {
+		str++;
+	}
+
+	const char *end = str;
+	while (*end && !g_ascii_isspace(*end)) {
+		end++;
+	}
+
+	char name[64];
+	size_t len = end - str;
+	if (len == 0 || len >= sizeof(name)) {
+		return NULL;
+	}
+	memcpy(name, str, len);
+	name[len] = '\0';
+
+	const GriverCommandSpec *spec = g_hash_table_lookup(table, name);
+	if (spec == NULL) {
+		return NULL;
+	}
+
+	while (g_ascii_isspace(*end)) {
+		end++;
+	}
+
+	memset(cmd, 0, sizeof(*cmd));
+	cmd->name = spec->name;
+	cmd->type = spec->type;
+
+	if (!parse_arg(spec, end, cmd)) {
+		return NULL;
+	}
+	return spec;
+}
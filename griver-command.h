@@ -0,0 +1,57 @@
+#ifndef __GRIVER_COMMAND_H__
+#define __GRIVER_COMMAND_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GRIVER_TYPE_COMMAND (g_river_command_get_type())
+
+/**
+ * GriverArgType:
+ * @GRIVER_ARG_NONE: The command takes no argument
+ * @GRIVER_ARG_INT: An integer, relative if prefixed with + or -
+ * @GRIVER_ARG_FLOAT: A floating point number, relative if prefixed with + or -
+ * @GRIVER_ARG_ENUM: One of a fixed set of words
+ *
+ * The type of the argument a registered command takes.
+ **/
+typedef enum {
+	GRIVER_ARG_NONE,
+	GRIVER_ARG_INT,
+	GRIVER_ARG_FLOAT,
+	GRIVER_ARG_ENUM,
+} GriverArgType;
+
+/**
+ * GriverCommand:
+ * @name: The name of the command, the first word sent by the user
+ * @type: The type of the argument
+ * @relative: Whether the number started with + or -, and should be
+ *   added to the current value instead of replacing it.
+ * @int_value: The argument if @type is %GRIVER_ARG_INT
+ * @float_value: The argument if @type is %GRIVER_ARG_FLOAT
+ * @enum_value: Index of the argument in the registered values if @type is
+ *   %GRIVER_ARG_ENUM
+ * @enum_name: The argument if @type is %GRIVER_ARG_ENUM
+ *
+ * A user command that has already been parsed.
+ **/
+typedef struct {
+	const char *name;
+	GriverArgType type;
+	gboolean relative;
+	gint int_value;
+	gdouble float_value;
+	gint enum_value;
+	const char *enum_name;
+} GriverCommand;
+
+GType g_river_command_get_type(void);
+
+GriverCommand *g_river_command_copy(const GriverCommand *cmd);
+void g_river_command_free(GriverCommand *cmd);
+
+G_END_DECLS
+
+#endif /* __GRIVER_COMMAND_H__ */
@@ -1,41 +1,78 @@
 #include "griver-context.h"
 #include "griver-output.h"
+#include "griver-output-private.h"
+#include "griver-command-private.h"
+#include "griver-thread-private.h"
+#include "griver-pool-private.h"
+#include "griver-status-private.h"
+#include "griver-control-private.h"
+#include "griver-state-file-private.h"
+#include "griver-trace-private.h"
+#include "griver-session-private.h"
 #include "glib.h"
 
-#include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <wayland-client-core.h>
 #include <wayland-client.h>
 #include <wayland-client-protocol.h>
-#include <math.h>
 
 #include "river-layout-v3-client-protocol.h"
 
+/* Wayland state shared by every context (namespace) on the same
+ * connection */
+typedef struct {
+	gint ref_count;
+
+	struct wl_display *display;
+	struct wl_registry *registry;
+	struct wl_callback *sync_callback;
+	struct river_layout_manager_v3 *layout_manager;
+	gboolean initialized;
+
+	struct wl_seat *seat;   // the first seat, for river-status and -control
+	GriverStatus *status;   // NULL without river-status
+	struct zriver_control_v1 *control_manager;
+
+	GHashTable *wl_outputs; // global name -> struct wl_output
+	GHashTable *output_names; // global name -> name of the wl_output
+	GList *contexts;        // connected contexts, not referenced
+} GriverConnection;
+
 typedef struct {
 	char *namespace;
-	gboolean intialized;
+	gboolean connected;
 	gboolean loop;
 	gboolean exitcode;
 
 	GError *error;
-	GList *outputs; // List of Outputs
+	GriverConnection *conn;
+	GHashTable *outputs;  // uid -> GriverOutput
+
+	gboolean coalesce;
+
+	gboolean use_layout_thread;
+	int thread_cpu;
+	int thread_policy;
+	int thread_priority;
+	GriverLayoutThread *thread;
+	guint parallel_workers; // 0 without a worker pool
+	GriverLayoutPool *pool;
+	GHashTable *commands; // name -> GriverCommandSpec
+	GriverControl *control; // created by g_river_context_get_control()
+	GriverStateFile *state_file;
+	GriverSession *session; // set by g_river_context_record_session()
 } GriverContextPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (GriverContext, g_river_context, G_TYPE_OBJECT)
 
 static gboolean run (GriverContext *ctx, GError **err);
 
-static bool init_wayland (GriverContext *ctx);
-static void finish_wayland (GriverContext *ctx);
+static GriverConnection *connection_new (void);
+static GriverConnection *connection_ref (GriverConnection *conn);
+static void connection_unref (GriverConnection *conn);
 static void context_finalize(GObject *object);
 
-// TODO: move this to the private context
-struct wl_registry *wl_registry = NULL;
-struct wl_callback *sync_callback = NULL;
-struct river_layout_manager_v3 *layout_manager = NULL;
-struct wl_display  *wl_display = NULL;
-
 enum {
   GRIVER_ADD_OUTPUT,
   GRIVER_REMOVE_OUTPUT,
@@ -44,14 +81,14 @@ enum {
 
 static guint griver_signals[GRIVER_CONTEXT_LAST_SIGNAL] = { 0 };
 
-GQuark griver_error_quark;
+G_DEFINE_QUARK (griver-error-quark, griver_error)
 
 /**
  * GMIME_ERROR:
  *
  * The GMime error domain GQuark value.
  **/
-#define GRIVER_ERROR griver_error_quark
+#define GRIVER_ERROR griver_error_quark ()
 
 /**
  * GMIME_ERROR_IS_SYSTEM:
@@ -76,12 +113,26 @@ enum {
 static void g_river_context_init(GriverContext *ctx) {
 	GriverContextPrivate *priv = g_river_context_get_instance_private (ctx);
 	priv->namespace = NULL;
-	priv->intialized = false;
+	priv->connected = false;
 	priv->loop = true;
 	priv->exitcode = true;
 
 	priv->error = NULL;
-	priv->outputs = NULL;
+	priv->conn = connection_new();
+
+	priv->coalesce = false;
+
+	priv->use_layout_thread = false;
+	priv->thread_cpu = -1;
+	priv->thread_policy = -1;
+	priv->thread_priority = 0;
+	priv->thread = NULL;
+	priv->parallel_workers = 0;
+	priv->pool = NULL;
+	priv->outputs = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+			NULL, g_object_unref);
+	priv->commands = griver_command_table_new();
+	priv->session = NULL;
 }
 
 static void g_river_context_class_init(GriverContextClass *klass){
@@ -126,59 +177,441 @@ static void g_river_context_class_init(GriverContextClass *klass){
 			);
 }
 
-GriverOutput *create_output (GriverContext *ctx, struct wl_output *wl_output, uint32_t global_name)
+/* With a layout thread, the layouts are created on its queue, with a
+ * worker pool on a queue of their own */
+static struct river_layout_manager_v3 *get_layout_manager (GriverContext *ctx,
+		uint32_t uid)
+{
+	GriverContextPrivate *priv = g_river_context_get_instance_private (ctx);
+
+	if (priv->pool != NULL) {
+		return griver_layout_pool_wrap_manager(priv->pool,
+				priv->conn->layout_manager, uid);
+	}
+	if (priv->thread != NULL) {
+		return griver_layout_thread_wrap_manager(priv->thread,
+				priv->conn->layout_manager);
+	}
+	return priv->conn->layout_manager;
+}
+
+static void lock_outputs (GriverContext *ctx)
+{
+	GriverContextPrivate *priv = g_river_context_get_instance_private (ctx);
+
+	if (priv->thread != NULL) {
+		griver_layout_thread_lock(priv->thread);
+	}
+	if (priv->pool != NULL) {
+		griver_layout_pool_lock(priv->pool);
+	}
+}
+
+static void unlock_outputs (GriverContext *ctx)
+{
+	GriverContextPrivate *priv = g_river_context_get_instance_private (ctx);
+
+	if (priv->pool != NULL) {
+		griver_layout_pool_unlock(priv->pool);
+	}
+	if (priv->thread != NULL) {
+		griver_layout_thread_unlock(priv->thread);
+	}
+}
+
+/* Keep the tag states of the output in the state file, restoring the
+ * ones saved by an earlier run. Needs the name of the output */
+static void attach_state (GriverContext *ctx, GriverOutput *output, const char *name)
+{
+	GriverContextPrivate *priv = g_river_context_get_instance_private (ctx);
+	bool restored = false;
+
+	if (priv->state_file == NULL || name == NULL) {
+		return;
+	}
+	GriverTagState *states = griver_state_file_lookup(priv->state_file,
+			priv->namespace, name, &restored);
+	if (states == NULL) {
+		g_warning("Keeping the tag states of %s in memory, the state file "
+				"has no room left or can not be locked", name);
+		return;
+	}
+
+	lock_outputs(ctx);
+	griver_output_set_tag_storage(output, priv->state_file, states, restored);
+	unlock_outputs(ctx);
+}
+
+static void record_output_add (GriverContext *ctx, GriverOutput *output)
+{
+	GriverContextPrivate *priv = g_river_context_get_instance_private (ctx);
+
+	if (priv->session == NULL) {
+		return;
+	}
+	GriverRecord record = {
+		.type = GRIVER_RECORD_OUTPUT_ADD,
+		.uid = g_river_output_get_uid(output),
+		.text = g_river_output_get_name(output),
+	};
+	griver_session_write(priv->session, &record);
+
+	lock_outputs(ctx);
+	griver_output_set_session(output, priv->session);
+	unlock_outputs(ctx);
+}
+
+static void add_output (GriverContext *ctx, struct wl_output *wl_output, uint32_t global_name)
 {
 	GriverContextPrivate *priv = g_river_context_get_instance_private (ctx);
+	GriverConnection *conn = priv->conn;
 
+	lock_outputs(ctx);
 	GriverOutput *output = GRIVER_OUTPUT(
-		g_river_output_new(layout_manager, wl_output, global_name, priv->namespace, priv->intialized));
-	priv->outputs = g_list_append(priv->outputs, output);
-	return output;
+		g_river_output_new(get_layout_manager(ctx, global_name), wl_output, global_name,
+			priv->namespace, conn->initialized && conn->layout_manager != NULL));
+	griver_output_set_command_table(output, priv->commands);
+	griver_output_set_coalesce(output, priv->coalesce);
+	if (conn->status != NULL) {
+		const GriverOutputStatus *status = griver_status_lookup(conn->status,
+				global_name);
+		if (status != NULL) {
+			griver_output_set_status(output, status);
+		}
+	}
+	g_hash_table_insert(priv->outputs, GUINT_TO_POINTER(global_name), output);
+	unlock_outputs(ctx);
+
+	const char *name = g_hash_table_lookup(conn->output_names,
+			GUINT_TO_POINTER(global_name));
+	griver_output_set_name(output, name);
+	attach_state(ctx, output, name);
+	record_output_add(ctx, output);
+
+	gint64 start = GRIVER_TRACE_BEGIN();
+	g_signal_emit (ctx, griver_signals[GRIVER_ADD_OUTPUT], 0, output);
+	GRIVER_TRACE_SPAN("add-output", "signal", start, "name", global_name,
+			NULL, 0);
+}
+
+static void remove_output (GriverContext *ctx, uint32_t global_name)
+{
+	GriverContextPrivate *priv = g_river_context_get_instance_private (ctx);
+	GriverOutput *output = g_hash_table_lookup(priv->outputs,
+			GUINT_TO_POINTER(global_name));
+
+	if ( output != NULL ){
+		if (priv->session != NULL) {
+			GriverRecord record = {
+				.type = GRIVER_RECORD_OUTPUT_REMOVE,
+				.uid = global_name,
+			};
+			griver_session_write(priv->session, &record);
+		}
+		/* the handlers may take the lock themselves, so they run without
+		 * it, like the ones of output-add */
+		lock_outputs(ctx);
+		g_hash_table_steal(priv->outputs, GUINT_TO_POINTER(global_name));
+		unlock_outputs(ctx);
+
+		gint64 start = GRIVER_TRACE_BEGIN();
+		g_signal_emit (ctx, griver_signals[GRIVER_REMOVE_OUTPUT], 0, output);
+		GRIVER_TRACE_SPAN("remove-output", "signal", start, "name",
+				global_name, NULL, 0);
+
+		/* destroying the river_layout must not race with its dispatch */
+		lock_outputs(ctx);
+		g_object_unref(output);
+		unlock_outputs(ctx);
+	}
+}
+
+static void configure_outputs (GriverContext *ctx)
+{
+	GriverContextPrivate *priv = g_river_context_get_instance_private (ctx);
+	GHashTableIter iter;
+	gpointer key, value;
+
+	lock_outputs(ctx);
+	g_hash_table_iter_init(&iter, priv->outputs);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		g_river_output_configure(GRIVER_OUTPUT(value),
+				get_layout_manager(ctx, GPOINTER_TO_UINT(key)), priv->namespace);
+	}
+	unlock_outputs(ctx);
+}
+
+/* Answer the demands that were held back while dispatching, only the
+ * newest one of each output is left at this point */
+static void flush_demands (GriverContext *ctx)
+{
+	GriverContextPrivate *priv = g_river_context_get_instance_private (ctx);
+	GHashTableIter iter;
+	gpointer value;
+
+	g_hash_table_iter_init(&iter, priv->outputs);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		griver_output_flush_demand(GRIVER_OUTPUT(value));
+	}
+	if (priv->session != NULL) {
+		griver_session_flush(priv->session);
+	}
+}
+
+static void thread_dispatched (gpointer thread, gpointer data)
+{
+	flush_demands(GRIVER_CONTEXT(data));
+}
+
+/* Only the output that got the events belongs to the calling worker */
+static void pool_dispatched (uint32_t uid, gpointer data)
+{
+	GriverContextPrivate *priv = g_river_context_get_instance_private (data);
+	GriverOutput *output = g_hash_table_lookup(priv->outputs,
+			GUINT_TO_POINTER(uid));
+
+	if (output != NULL) {
+		griver_output_flush_demand(output);
+	}
+	if (priv->session != NULL) {
+		griver_session_flush(priv->session);
+	}
+}
+
+static void connection_flush_demands (GriverConnection *conn)
+{
+	for (GList *list = conn->contexts; list; list = list->next) {
+		GriverContext *ctx = GRIVER_CONTEXT(list->data);
+		GriverContextPrivate *priv = g_river_context_get_instance_private (ctx);
+
+		/* the layout thread and the workers flush their own outputs */
+		if (priv->thread == NULL && priv->pool == NULL) {
+			flush_demands(ctx);
+		}
+	}
+}
+
+/* Point the control of the context at the connection, or at nothing when
+ * disconnected */
+static void update_control (GriverContext *ctx)
+{
+	GriverContextPrivate *priv = g_river_context_get_instance_private(ctx);
+	GriverConnection *conn = priv->conn;
+
+	if (priv->control == NULL) {
+		return;
+	}
+	if (priv->connected) {
+		griver_control_set_target(priv->control, conn->display,
+				conn->control_manager, conn->seat);
+	} else {
+		griver_control_set_target(priv->control, NULL, NULL, NULL);
+	}
+}
+
+static void connection_update_controls (GriverConnection *conn)
+{
+	for (GList *list = conn->contexts; list; list = list->next) {
+		update_control(GRIVER_CONTEXT(list->data));
+	}
+}
+
+/* river-status is shared by the contexts, update the output of each */
+static void connection_status_changed (uint32_t output_name,
+		const GriverOutputStatus *status, GriverStatusChange changed,
+		gpointer data)
+{
+	GriverConnection *conn = data;
+
+	for (GList *list = conn->contexts; list; list = list->next) {
+		GriverContext *ctx = GRIVER_CONTEXT(list->data);
+		GriverContextPrivate *priv = g_river_context_get_instance_private (ctx);
+		GriverOutput *output = g_hash_table_lookup(priv->outputs,
+				GUINT_TO_POINTER(output_name));
+
+		if (output == NULL) {
+			continue;
+		}
+		lock_outputs(ctx);
+		GriverStatusChange output_changed = griver_output_set_status(output, status);
+		unlock_outputs(ctx);
+		griver_output_notify_status(output, output_changed);
+	}
+}
+
+static void set_error (GriverContext *ctx, gint code, const char *message)
+{
+	GriverContextPrivate *priv = g_river_context_get_instance_private(ctx);
+
+	priv->exitcode = false;
+	priv->loop = false;
+	if (priv->error == NULL) {
+		g_set_error_literal(&priv->error, GRIVER_ERROR, code, message);
+	}
+}
+
+/* Every context on the connection is affected by connection errors */
+static void connection_set_error (GriverConnection *conn, gint code, const char *message)
+{
+	for (GList *list = conn->contexts; list; list = list->next) {
+		set_error(GRIVER_CONTEXT(list->data), code, message);
+	}
+}
+
+static void set_dispatch_error (GriverContext *ctx)
+{
+	GriverContextPrivate *priv = g_river_context_get_instance_private(ctx);
+
+	connection_set_error(priv->conn, G_RIVER_ERROR_INIT,
+			"Lost connection to the Wayland server");
+}
+
+static void output_handle_geometry (void *data, struct wl_output *wl_output,
+		int32_t x, int32_t y, int32_t physical_width, int32_t physical_height,
+		int32_t subpixel, const char *make, const char *model, int32_t transform)
+{
+}
+
+static void output_handle_mode (void *data, struct wl_output *wl_output,
+		uint32_t flags, int32_t width, int32_t height, int32_t refresh)
+{
+}
+
+static void output_handle_done (void *data, struct wl_output *wl_output)
+{
+}
+
+static void output_handle_scale (void *data, struct wl_output *wl_output,
+		int32_t factor)
+{
+}
+
+/* Sent right after binding, so before river demands a layout for it */
+static void output_handle_name (void *data, struct wl_output *wl_output,
+		const char *name)
+{
+	GriverConnection *conn = data;
+	GHashTableIter iter;
+	gpointer key, value;
+	uint32_t global_name = 0;
+
+	g_hash_table_iter_init(&iter, conn->wl_outputs);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		if (value == wl_output) {
+			global_name = GPOINTER_TO_UINT(key);
+			break;
+		}
+	}
+	if (global_name == 0) {
+		return;
+	}
+	g_hash_table_insert(conn->output_names, GUINT_TO_POINTER(global_name),
+			g_strdup(name));
+
+	for (GList *list = conn->contexts; list; list = list->next) {
+		GriverContext *ctx = GRIVER_CONTEXT(list->data);
+		GriverContextPrivate *priv = g_river_context_get_instance_private (ctx);
+		GriverOutput *output = g_hash_table_lookup(priv->outputs,
+				GUINT_TO_POINTER(global_name));
+
+		if (output != NULL) {
+			/* the layout thread and the workers read it in their handlers */
+			lock_outputs(ctx);
+			griver_output_set_name(output, name);
+			unlock_outputs(ctx);
+			attach_state(ctx, output, name);
+		}
+	}
 }
 
+static void output_handle_description (void *data, struct wl_output *wl_output,
+		const char *description)
+{
+}
+
+static const struct wl_output_listener output_listener = {
+	.geometry    = output_handle_geometry,
+	.mode        = output_handle_mode,
+	.done        = output_handle_done,
+	.scale       = output_handle_scale,
+	.name        = output_handle_name,
+	.description = output_handle_description,
+};
+
 static void registry_handle_global (void *data, struct wl_registry *registry,
 		uint32_t name, const char *interface, uint32_t version)
 {
-	GriverContext *ctx = GRIVER_CONTEXT(data);
+	GriverConnection *conn = data;
+	GRIVER_TRACE_INSTANT("global", "registry", interface, "name", name,
+			"version", version);
 	if ( strcmp(interface, river_layout_manager_v3_interface.name) == 0 )
 	{
-		layout_manager = wl_registry_bind(registry, name,
+		conn->layout_manager = wl_registry_bind(registry, name,
 				&river_layout_manager_v3_interface, 2);
 	}
-	else if ( strcmp(interface, wl_output_interface.name) == 0 )
+	else if ( strcmp(interface, zriver_status_manager_v1_interface.name) == 0 )
 	{
-		struct wl_output *wl_output = wl_registry_bind(registry, name,
-				&wl_output_interface, 4);
+		struct zriver_status_manager_v1 *manager = wl_registry_bind(registry,
+				name, &zriver_status_manager_v1_interface, MIN(version, 3));
+		GHashTableIter iter;
+		gpointer key, value;
 
-		GriverOutput *output = create_output(ctx, wl_output, name);
-		g_signal_emit (ctx, griver_signals[GRIVER_ADD_OUTPUT], 0, output);
+		conn->status = griver_status_new(manager, connection_status_changed, conn);
+		g_hash_table_iter_init(&iter, conn->wl_outputs);
+		while (g_hash_table_iter_next(&iter, &key, &value)) {
+			griver_status_add_output(conn->status, value, GPOINTER_TO_UINT(key));
+		}
+		if (conn->seat != NULL) {
+			griver_status_set_seat(conn->status, conn->seat);
+		}
 	}
-}
+	else if ( strcmp(interface, zriver_control_v1_interface.name) == 0 )
+	{
+		conn->control_manager = wl_registry_bind(registry, name,
+				&zriver_control_v1_interface, 1);
+		connection_update_controls(conn);
+	}
+	else if ( strcmp(interface, wl_seat_interface.name) == 0 && conn->seat == NULL )
+	{
+		conn->seat = wl_registry_bind(registry, name, &wl_seat_interface, 1);
+		if (conn->status != NULL) {
+			griver_status_set_seat(conn->status, conn->seat);
+		}
+		connection_update_controls(conn);
+	}
+	else if ( strcmp(interface, wl_output_interface.name) == 0 )
+	{
+		struct wl_output *wl_output = wl_registry_bind(registry, name,
+				&wl_output_interface, MIN(version, 4));
+		wl_output_add_listener(wl_output, &output_listener, conn);
+		g_hash_table_insert(conn->wl_outputs, GUINT_TO_POINTER(name), wl_output);
+		if (conn->status != NULL) {
+			griver_status_add_output(conn->status, wl_output, name);
+		}
 
-static GriverOutput *output_from_global_name (GriverContextPrivate *priv, uint32_t uid)
-{
-	GList *list = priv->outputs;
-	while (list) {
-		if (list->data) {
-			GriverOutput *output = GRIVER_OUTPUT(list->data);
-			if (g_river_output_get_uid(output) == uid)
-				return output;
+		for (GList *list = conn->contexts; list; list = list->next) {
+			add_output(GRIVER_CONTEXT(list->data), wl_output, name);
 		}
-		list = list->next;
 	}
-	return NULL;
 }
 
 static void registry_handle_global_remove (void *data, struct wl_registry *registry, uint32_t name)
 {
-	GriverContext *ctx = GRIVER_CONTEXT(data);
-	GriverContextPrivate *priv = g_river_context_get_instance_private (ctx);
-	GriverOutput *output = output_from_global_name(priv, name);
-	if ( output != NULL ){
-		g_signal_emit (ctx, griver_signals[GRIVER_REMOVE_OUTPUT], 0, output);
-		priv->outputs = g_list_remove(priv->outputs, output);
-		g_object_unref(output);
+	GriverConnection *conn = data;
+
+	GRIVER_TRACE_INSTANT("global_remove", "registry", NULL, "name", name,
+			NULL, 0);
+	if (!g_hash_table_contains(conn->wl_outputs, GUINT_TO_POINTER(name))) {
+		return;
+	}
+	for (GList *list = conn->contexts; list; list = list->next) {
+		remove_output(GRIVER_CONTEXT(list->data), name);
+	}
+	if (conn->status != NULL) {
+		griver_status_remove_output(conn->status, name);
 	}
+	g_hash_table_remove(conn->wl_outputs, GUINT_TO_POINTER(name));
+	g_hash_table_remove(conn->output_names, GUINT_TO_POINTER(name));
 }
 
 static const struct wl_registry_listener registry_listener = {
@@ -189,23 +622,18 @@ static const struct wl_registry_listener registry_listener = {
 static void sync_handle_done (void *data, struct wl_callback *wl_callback,
 		uint32_t irrelevant)
 {
+	GriverConnection *conn = data;
+
 	wl_callback_destroy(wl_callback);
-	sync_callback = NULL;
+	conn->sync_callback = NULL;
 
 	/* When this function is called, the registry finished advertising all
 	 * available globals. Let's check if we have everything we need.
 	 */
-	GriverContext *ctx = GRIVER_CONTEXT(data);
-	GriverContextPrivate *priv = g_river_context_get_instance_private (ctx);
-	if ( layout_manager == NULL )
+	if ( conn->layout_manager == NULL )
 	{
-		// GError *err;
-		// g_set_error(err, G_RIVER_ERROR, G_RIVER_ERROR_NOT_SUPPORTED,
-		// 		"Namespace already in use");
-		// priv->error = err;
-		fputs("Wayland compositor does not support river-layout-v3.\n", stderr);
-		priv->exitcode = false;
-		priv->loop = false;
+		connection_set_error(conn, G_RIVER_ERROR_NOT_SUPPORTED,
+				"Wayland compositor does not support river-layout-v3");
 		return;
 	}
 
@@ -213,13 +641,8 @@ static void sync_handle_done (void *data, struct wl_callback *wl_callback,
 	 * available, they won't have a river_layout, so we need to create those
 	 * here.
 	 */
-	GList *list = priv->outputs;
-	while (list) {
-		if (list->data) {
-			GriverOutput *output = GRIVER_OUTPUT(list->data);
-			g_river_output_configure(output, layout_manager, priv->namespace);
-		}
-		list = list->next;
+	for (GList *list = conn->contexts; list; list = list->next) {
+		configure_outputs(GRIVER_CONTEXT(list->data));
 	}
 }
 
@@ -228,9 +651,31 @@ static const struct wl_callback_listener sync_callback_listener = {
 	.done = sync_handle_done,
 };
 
-static bool init_wayland (GriverContext *ctx)
+static void wl_output_free (gpointer data)
+{
+	wl_output_destroy(data);
+}
+
+static GriverConnection *connection_new (void)
+{
+	GriverConnection *conn = g_new0(GriverConnection, 1);
+
+	conn->ref_count = 1;
+	conn->wl_outputs = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+			NULL, wl_output_free);
+	conn->output_names = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+			NULL, g_free);
+	return conn;
+}
+
+static GriverConnection *connection_ref (GriverConnection *conn)
+{
+	conn->ref_count++;
+	return conn;
+}
+
+static bool connection_open (GriverConnection *conn, GError **error)
 {
-	GriverContextPrivate *priv = g_river_context_get_instance_private (ctx);
 	/* We query the display name here instead of letting wl_display_connect()
 	 * figure it out itself, because libwayland (for legacy reasons) falls
 	 * back to using "wayland-0" when $WAYLAND_DISPLAY is not set, which is
@@ -239,91 +684,133 @@ static bool init_wayland (GriverContext *ctx)
 	const char *display_name = g_getenv("WAYLAND_DISPLAY");
 	if ( display_name == NULL )
 	{
-		// g_set_error(err, G_RIVER_ERROR, G_RIVER_ERROR_INIT,
-		// 		"WAYLAND_DISPLAY is not set");
-		g_printerr("WAYLAND_DISPLAY is not set.\n");
+		g_set_error(error, GRIVER_ERROR, G_RIVER_ERROR_INIT,
+				"WAYLAND_DISPLAY is not set");
 		return false;
 	}
 
-	wl_display = wl_display_connect(display_name);
-	if ( wl_display == NULL )
+	conn->display = wl_display_connect(display_name);
+	if ( conn->display == NULL )
 	{
-		// g_set_error(err, G_RIVER_ERROR, G_RIVER_ERROR_INIT,
-		// 		"Can not connect to Wayland server");
-		g_printerr("Can not connect to Wayland server.\n");
+		g_set_error(error, GRIVER_ERROR, G_RIVER_ERROR_INIT,
+				"Can not connect to Wayland server");
 		return false;
 	}
+	return true;
+}
 
-	wl_registry = wl_display_get_registry(wl_display);
-	wl_registry_add_listener(wl_registry, &registry_listener, ctx);
+static bool connection_init (GriverConnection *conn, GError **error)
+{
+	conn->registry = wl_display_get_registry(conn->display);
+	wl_registry_add_listener(conn->registry, &registry_listener, conn);
 
-	if (wl_display_roundtrip(wl_display) <  0) {
-		g_printerr("initial roundtrip failed\n");
+	if (wl_display_roundtrip(conn->display) <  0) {
+		g_set_error(error, GRIVER_ERROR, G_RIVER_ERROR_INIT,
+				"Initial roundtrip failed");
 		return false;
 	}
-	priv->intialized = true;
-	
+	conn->initialized = true;
 
-	sync_callback = wl_display_sync(wl_display);
-	wl_callback_add_listener(sync_callback, &sync_callback_listener, ctx);
+	conn->sync_callback = wl_display_sync(conn->display);
+	wl_callback_add_listener(conn->sync_callback, &sync_callback_listener, conn);
 
 	return true;
 }
 
-static void destroy_all_outputs (GriverContext *ctx)
-{
-	GriverContextPrivate *priv = g_river_context_get_instance_private (ctx);
-	GList *list = priv->outputs;
-	
-	while (list) {
-		if (list->data) {
-			GriverOutput *output = GRIVER_OUTPUT(list->data);
-			g_object_unref(output);
-		}
-		list = list->next;
-	}
-	g_list_free(list);
-}
-
-static void finish_wayland (GriverContext *ctx)
+static void connection_close (GriverConnection *conn)
 {  
-	if ( wl_display == NULL ) {
+	if ( conn->display == NULL ) {
 		return;
 	}
 
-	destroy_all_outputs(ctx);
-	if ( sync_callback != NULL )
-		wl_callback_destroy(sync_callback);
+	if ( conn->sync_callback != NULL ) {
+		wl_callback_destroy(conn->sync_callback);
+		conn->sync_callback = NULL;
+	}
+
+	if ( conn->layout_manager != NULL ) {
+		river_layout_manager_v3_destroy(conn->layout_manager);
+		conn->layout_manager = NULL;
+	}
+
+	if ( conn->status != NULL ) {
+		griver_status_free(conn->status);
+		conn->status = NULL;
+	}
+	if ( conn->control_manager != NULL ) {
+		zriver_control_v1_destroy(conn->control_manager);
+		conn->control_manager = NULL;
+	}
+	if ( conn->seat != NULL ) {
+		wl_seat_destroy(conn->seat);
+		conn->seat = NULL;
+	}
+
+	g_hash_table_remove_all(conn->wl_outputs);
+	g_hash_table_remove_all(conn->output_names);
+	if ( conn->registry != NULL ) {
+		wl_registry_destroy(conn->registry);
+		conn->registry = NULL;
+	}
+	wl_display_disconnect(conn->display);
+	conn->display = NULL;
+	conn->initialized = false;
+}
 
-	if ( layout_manager != NULL ) {
-		river_layout_manager_v3_destroy(layout_manager);
+static void connection_unref (GriverConnection *conn)
+{
+	if (--conn->ref_count > 0) {
+		return;
 	}
 
-	wl_registry_destroy(wl_registry);
-	wl_display_disconnect(wl_display);
+	connection_close(conn);
+	g_hash_table_destroy(conn->wl_outputs);
+	g_hash_table_destroy(conn->output_names);
+	g_list_free(conn->contexts);
+	g_free(conn);
+}
+
+/* The results of river-control are GTasks, which complete from the main
+ * context they were created in. While run() blocks in libwayland that is
+ * a private one, holding nothing but the results, so no source of the
+ * application runs behind its back. Commands sent from the layout thread
+ * or the workers get their task on this thread once answered, so they
+ * complete in it as well */
+static void dispatch_control_results (GMainContext *results)
+{
+	while (g_main_context_iteration(results, false));
 }
 
 static gboolean 
 run (GriverContext *ctx, GError **error) {
 	GriverContextPrivate *priv = g_river_context_get_instance_private(ctx);
 
-	if (!init_wayland(ctx)) {
+	if (!priv->connected && !g_river_context_connect(ctx, error)) {
 		return false;
 	}
 
-	priv->exitcode = true;
+	GMainContext *results = g_main_context_new();
+	g_main_context_push_thread_default(results);
+
 	while(priv->loop) {
-		if (wl_display_dispatch(wl_display) < 0) {
-			priv->exitcode = false;
-			*error = priv->error;
+		if (wl_display_dispatch(priv->conn->display) < 0) {
+			set_dispatch_error(ctx);
 			break;
 		}
+		connection_flush_demands(priv->conn);
+		dispatch_control_results(results);
 	}
 
 	if (priv->error) {
-		printf("Error: %s", priv->error->message);
+		g_propagate_error(error, priv->error);
+		priv->error = NULL;
 	}
-	finish_wayland(ctx);
+	g_river_context_disconnect(ctx);
+
+	/* the commands still waiting failed with the disconnect */
+	dispatch_control_results(results);
+	g_main_context_pop_thread_default(results);
+	g_main_context_unref(results);
 	return priv->exitcode;
 }
 
@@ -331,67 +818,1023 @@ static void context_finalize(GObject *object) {
 	GriverContext *ctx = GRIVER_CONTEXT(object);
 	GriverContextPrivate *priv = g_river_context_get_instance_private(ctx);
 
+	g_river_context_disconnect(ctx);
+	connection_unref(priv->conn);
+	g_hash_table_destroy(priv->outputs);
+	g_clear_error(&priv->error);
+	g_hash_table_unref(priv->commands);
+	g_clear_object(&priv->control);
+	g_clear_pointer(&priv->state_file, griver_state_file_unref);
+	g_clear_pointer(&priv->session, griver_session_unref);
 	g_free(priv->namespace);
-}
 
-/**
- * g_river_context_run:
- * @ctx: The context to run
- * @err: a #GError
- *
- * Run the river context, until the compositor stops.
- *
- **/
-gboolean 
-g_river_context_run (GriverContext *ctx, GError **error) {
-	g_return_val_if_fail(GRIVER_IS_CONTEXT(ctx), false);
-	
-	return GRIVER_CONTEXT_GET_CLASS(ctx)->run(ctx, error);
+	G_OBJECT_CLASS(g_river_context_parent_class)->finalize(object);
 }
 
-/**
- * g_river_context_new:
- *
- * Creates a new river context object.
- *
- * Returns: (transfer full): a new river context object.
- **/
-GObject *g_river_context_new(const char *namespace) {
-	g_return_val_if_fail(namespace, NULL);
-
-	GriverContext *ctx = g_object_new(GRIVER_TYPE_CONTEXT, NULL);
+static struct wl_display *get_display (GriverContext *ctx)
+{
 	GriverContextPrivate *priv = g_river_context_get_instance_private(ctx);
-	
-	priv->namespace = strdup(namespace);
-	return (GObject *)ctx;
+
+	return priv->connected ? priv->conn->display : NULL;
 }
 
-/**
- * g_river_first_set_bit_pos:
- *
- * Gets the position of the first bit.
+/* A GSource that dispatches the wayland display, using the
+ * prepare_read/read_events dance so we never block in libwayland. */
+typedef struct {
+	GSource source;
+	GriverContext *ctx;
+	gpointer fd_tag;
+	bool reading;
+} GriverSource;
+
+static gboolean source_prepare (GSource *source, gint *timeout)
+{
+	GriverSource *gsource = (GriverSource *) source;
+	GriverContextPrivate *priv = g_river_context_get_instance_private(gsource->ctx);
+	struct wl_display *display = get_display(gsource->ctx);
+
+	*timeout = -1;
+	if (gsource->reading || display == NULL) {
+		return display == NULL;
+	}
+
+	while (wl_display_prepare_read(display) != 0) {
+		if (wl_display_dispatch_pending(display) < 0) {
+			return true;
+		}
+	}
+	connection_flush_demands(priv->conn);
+	gsource->reading = true;
+	wl_display_flush(display);
+
+	return false;
+}
+
+static gboolean source_check (GSource *source)
+{
+	GriverSource *gsource = (GriverSource *) source;
+	struct wl_display *display = get_display(gsource->ctx);
+	GIOCondition revents = g_source_query_unix_fd(source, gsource->fd_tag);
+
+	if (!gsource->reading) {
+		return true;
+	}
+	gsource->reading = false;
+
+	if (revents & G_IO_IN) {
+		/* errors show up again when dispatching */
+		wl_display_read_events(display);
+		return true;
+	}
+	wl_display_cancel_read(display);
+
+	return (revents & (G_IO_ERR | G_IO_HUP)) != 0;
+}
+
+static gboolean source_dispatch (GSource *source, GSourceFunc callback, gpointer user_data)
+{
+	GriverSource *gsource = (GriverSource *) source;
+	GriverContextPrivate *priv = g_river_context_get_instance_private(gsource->ctx);
+	struct wl_display *display = get_display(gsource->ctx);
+	GIOCondition revents = g_source_query_unix_fd(source, gsource->fd_tag);
+
+	if (display == NULL) {
+		return G_SOURCE_REMOVE;
+	}
+	if (wl_display_dispatch_pending(display) < 0 ||
+			(revents & (G_IO_ERR | G_IO_HUP))) {
+		set_dispatch_error(gsource->ctx);
+		return G_SOURCE_REMOVE;
+	}
+	connection_flush_demands(priv->conn);
+	if (!priv->loop) {
+		return G_SOURCE_REMOVE;
+	}
+
+	if (callback != NULL) {
+		return callback(user_data);
+	}
+	return G_SOURCE_CONTINUE;
+}
+
+static void source_finalize (GSource *source)
+{
+	GriverSource *gsource = (GriverSource *) source;
+
+	struct wl_display *display = get_display(gsource->ctx);
+
+	if (gsource->reading && display != NULL) {
+		wl_display_cancel_read(display);
+	}
+	g_object_unref(gsource->ctx);
+}
+
+static GSourceFuncs source_funcs = {
+	.prepare = source_prepare,
+	.check = source_check,
+	.dispatch = source_dispatch,
+	.finalize = source_finalize,
+};
+
+/**
+ * g_river_context_connect:
+ * @ctx: The context to connect
+ * @err: a #GError
+ *
+ * Connect to the compositor and do the initial roundtrip, outputs known
+ * at this point are announced through #GriverContext::output-add before
+ * this returns.
+ *
+ * You only need this if you drive the context yourself, with
+ * g_river_context_create_source() or g_river_context_get_fd(),
+ * g_river_context_run() connects on its own.
+ *
+ * Returns: %TRUE on success
+ **/
+gboolean
+g_river_context_connect (GriverContext *ctx, GError **err)
+{
+	g_return_val_if_fail(GRIVER_IS_CONTEXT(ctx), false);
+
+	GriverContextPrivate *priv = g_river_context_get_instance_private(ctx);
+	GriverConnection *conn = priv->conn;
+
+	g_return_val_if_fail(!priv->connected, false);
+
+	priv->loop = true;
+	priv->exitcode = true;
+	priv->connected = true;
+	conn->contexts = g_list_append(conn->contexts, ctx);
+
+	if (conn->display == NULL && !connection_open(conn, err)) {
+		g_river_context_disconnect(ctx);
+		return false;
+	}
+
+	if (priv->parallel_workers > 0) {
+		priv->pool = griver_layout_pool_new(conn->display,
+				priv->parallel_workers, pool_dispatched, ctx);
+	} else if (priv->use_layout_thread) {
+		priv->thread = griver_layout_thread_new(conn->display, priv->thread_cpu,
+				priv->thread_policy, priv->thread_priority, thread_dispatched, ctx);
+	}
+
+	if (!conn->initialized) {
+		if (!connection_init(conn, err)) {
+			g_river_context_disconnect(ctx);
+			return false;
+		}
+	} else {
+		/* Another namespace already set up the connection, just create our
+		 * outputs */
+		GHashTableIter iter;
+		gpointer key, value;
+
+		g_hash_table_iter_init(&iter, conn->wl_outputs);
+		while (g_hash_table_iter_next(&iter, &key, &value)) {
+			add_output(ctx, value, GPOINTER_TO_UINT(key));
+		}
+	}
+
+	if (priv->thread != NULL && !griver_layout_thread_start(priv->thread, err)) {
+		g_river_context_disconnect(ctx);
+		return false;
+	}
+	if (priv->pool != NULL && !griver_layout_pool_start(priv->pool, err)) {
+		g_river_context_disconnect(ctx);
+		return false;
+	}
+	update_control(ctx);
+	return true;
+}
+
+/**
+ * g_river_context_disconnect:
+ * @ctx: The context to disconnect
+ *
+ * Destroy all outputs of the context. The connection to the compositor is
+ * closed when the last context using it disconnects.
+ *
+ **/
+void
+g_river_context_disconnect (GriverContext *ctx)
+{
+	g_return_if_fail(GRIVER_IS_CONTEXT(ctx));
+
+	GriverContextPrivate *priv = g_river_context_get_instance_private(ctx);
+	GriverConnection *conn = priv->conn;
+
+	if (!priv->connected) {
+		return;
+	}
+
+	priv->connected = false;
+	conn->contexts = g_list_remove(conn->contexts, ctx);
+	update_control(ctx);
+
+	if (priv->thread != NULL) {
+		griver_layout_thread_stop(priv->thread);
+	}
+	if (priv->pool != NULL) {
+		griver_layout_pool_stop(priv->pool);
+	}
+	g_hash_table_remove_all(priv->outputs);
+	if (priv->thread != NULL) {
+		griver_layout_thread_free(priv->thread);
+		priv->thread = NULL;
+	}
+	if (priv->pool != NULL) {
+		griver_layout_pool_free(priv->pool);
+		priv->pool = NULL;
+	}
+
+	if (conn->contexts == NULL) {
+		connection_close(conn);
+	}
+}
+
+/**
+ * g_river_context_create_source:
+ * @ctx: A connected context
+ *
+ * Creates a #GSource that dispatches events for the context whenever the
+ * compositor sends something. Attach it to any #GMainContext to run the
+ * layout generator as part of that main loop.
+ *
+ * If the connection is lost the source removes itself, the error is
+ * available through g_river_context_get_error().
+ *
+ * Returns: (transfer full): a new #GSource
+ **/
+GSource *
+g_river_context_create_source (GriverContext *ctx)
+{
+	g_return_val_if_fail(GRIVER_IS_CONTEXT(ctx), NULL);
+	struct wl_display *display = get_display(ctx);
+	g_return_val_if_fail(display != NULL, NULL);
+
+	GSource *source = g_source_new(&source_funcs, sizeof(GriverSource));
+	GriverSource *gsource = (GriverSource *) source;
+
+	gsource->ctx = g_object_ref(ctx);
+	gsource->reading = false;
+	gsource->fd_tag = g_source_add_unix_fd(source, wl_display_get_fd(display),
+			G_IO_IN | G_IO_ERR | G_IO_HUP);
+	g_source_set_name(source, "griver");
+
+	return source;
+}
+
+/**
+ * g_river_context_attach:
+ * @ctx: A connected context
+ * @context: (nullable): A #GMainContext or %NULL for the default one
+ *
+ * Convenience function to create a source with
+ * g_river_context_create_source() and attach it to @context.
+ *
+ * Returns: the id of the source in @context
+ **/
+guint
+g_river_context_attach (GriverContext *ctx, GMainContext *context)
+{
+	g_return_val_if_fail(GRIVER_IS_CONTEXT(ctx), 0);
+
+	GSource *source = g_river_context_create_source(ctx);
+	if (source == NULL) {
+		return 0;
+	}
+
+	guint id = g_source_attach(source, context);
+	g_source_unref(source);
+	return id;
+}
+
+/**
+ * g_river_context_get_fd:
+ * @ctx: A connected context
+ *
+ * Get the file descriptor of the wayland connection, for use in your own
+ * poll or epoll loop together with g_river_context_prepare_read(),
+ * g_river_context_read_events() and g_river_context_dispatch_pending().
+ *
+ * Returns: the fd, or -1 if not connected
+ **/
+int
+g_river_context_get_fd (GriverContext *ctx)
+{
+	g_return_val_if_fail(GRIVER_IS_CONTEXT(ctx), -1);
+	struct wl_display *display = get_display(ctx);
+
+	if (display == NULL) {
+		return -1;
+	}
+	return wl_display_get_fd(display);
+}
+
+/**
+ * g_river_context_prepare_read:
+ * @ctx: A connected context
+ * @err: a #GError
+ *
+ * Dispatch already queued events, announce that we are about to read from
+ * the fd and flush outgoing requests. After this returns %TRUE, wait for the
+ * fd to become readable and call g_river_context_read_events(), or
+ * g_river_context_cancel_read() if you decide not to read.
+ *
+ * Returns: %TRUE if the context is ready to read
+ **/
+gboolean
+g_river_context_prepare_read (GriverContext *ctx, GError **err)
+{
+	g_return_val_if_fail(GRIVER_IS_CONTEXT(ctx), false);
+	struct wl_display *display = get_display(ctx);
+	g_return_val_if_fail(display != NULL, false);
+
+	while (wl_display_prepare_read(display) != 0) {
+		if (!g_river_context_dispatch_pending(ctx, err)) {
+			return false;
+		}
+	}
+	wl_display_flush(display);
+	return true;
+}
+
+/**
+ * g_river_context_cancel_read:
+ * @ctx: A connected context
+ *
+ * Cancel a read announced by g_river_context_prepare_read().
+ *
+ **/
+void
+g_river_context_cancel_read (GriverContext *ctx)
+{
+	g_return_if_fail(GRIVER_IS_CONTEXT(ctx));
+	struct wl_display *display = get_display(ctx);
+	g_return_if_fail(display != NULL);
+
+	wl_display_cancel_read(display);
+}
+
+/**
+ * g_river_context_read_events:
+ * @ctx: A connected context
+ * @err: a #GError
+ *
+ * Read events from the fd into the queue, without dispatching them.
+ * Must be preceded by g_river_context_prepare_read().
+ *
+ * Returns: %TRUE on success
+ **/
+gboolean
+g_river_context_read_events (GriverContext *ctx, GError **err)
+{
+	g_return_val_if_fail(GRIVER_IS_CONTEXT(ctx), false);
+	struct wl_display *display = get_display(ctx);
+	g_return_val_if_fail(display != NULL, false);
+
+	if (wl_display_read_events(display) < 0) {
+		set_dispatch_error(ctx);
+		g_set_error(err, GRIVER_ERROR, G_RIVER_ERROR_INIT,
+				"Failed to read from the Wayland server");
+		return false;
+	}
+	return true;
+}
+
+/**
+ * g_river_context_dispatch_pending:
+ * @ctx: A connected context
+ * @err: a #GError
+ *
+ * Dispatch all events that have already been read, emitting signals for
+ * them. Never blocks.
+ *
+ * Returns: %TRUE on success
+ **/
+gboolean
+g_river_context_dispatch_pending (GriverContext *ctx, GError **err)
+{
+	g_return_val_if_fail(GRIVER_IS_CONTEXT(ctx), false);
+	struct wl_display *display = get_display(ctx);
+	g_return_val_if_fail(display != NULL, false);
+	GriverContextPrivate *priv = g_river_context_get_instance_private(ctx);
+
+	if (wl_display_dispatch_pending(display) < 0) {
+		set_dispatch_error(ctx);
+		g_set_error(err, GRIVER_ERROR, G_RIVER_ERROR_INIT,
+				"Failed to dispatch Wayland events");
+		return false;
+	}
+	connection_flush_demands(priv->conn);
+	return true;
+}
+
+/**
+ * g_river_context_get_error:
+ * @ctx: The context
+ *
+ * Get the error that stopped the context, if any.
+ *
+ * Returns: (transfer none) (nullable): the error
+ **/
+const GError *
+g_river_context_get_error (GriverContext *ctx)
+{
+	g_return_val_if_fail(GRIVER_IS_CONTEXT(ctx), NULL);
+	GriverContextPrivate *priv = g_river_context_get_instance_private(ctx);
+
+	return priv->error;
+}
+
+/**
+ * g_river_context_run:
+ * @ctx: The context to run
+ * @err: a #GError
+ *
+ * Run the river context, until the compositor stops.
+ *
+ * No #GMainContext of the application is iterated meanwhile. The results
+ * of g_river_control_run_command_async() called from the handlers, on
+ * this thread, the layout thread or the workers, and from any other
+ * thread without a thread-default main context still come in. Commands
+ * sent from a thread with a main context of its own complete there. Use
+ * g_river_context_attach() to run griver on a main loop of your own
+ * instead.
+ *
+ **/
+gboolean 
+g_river_context_run (GriverContext *ctx, GError **error) {
+	g_return_val_if_fail(GRIVER_IS_CONTEXT(ctx), false);
+	
+	return GRIVER_CONTEXT_GET_CLASS(ctx)->run(ctx, error);
+}
+
+/**
+ * g_river_context_new:
+ *
+ * Creates a new river context object.
+ *
+ * Returns: (transfer full): a new river context object.
+ **/
+GObject *g_river_context_new(const char *namespace) {
+	g_return_val_if_fail(namespace, NULL);
+
+	griver_trace_start_from_env();
+
+	GriverContext *ctx = g_object_new(GRIVER_TYPE_CONTEXT, NULL);
+	GriverContextPrivate *priv = g_river_context_get_instance_private(ctx);
+	
+	priv->namespace = strdup(namespace);
+	return (GObject *)ctx;
+}
+
+/**
+ * g_river_context_register_command:
+ * @ctx: The context
+ * @name: The name of the command, the first word of what the user sends
+ * @type: The type of the argument
+ * @values: (array zero-terminated=1) (nullable): The allowed words if
+ *   @type is %GRIVER_ARG_ENUM
+ *
+ * Register a command so griver parses it for you. When the user sends the
+ * command, it is emitted as #GriverOutput::command with @name as detail
+ * instead of as #GriverOutput::user-command. Commands that fail to parse
+ * are still emitted as #GriverOutput::user-command.
+ *
+ * The commands are parsed on the layout thread or the workers when those
+ * are used, so they have to be registered before g_river_context_connect()
+ * or g_river_context_run().
+ *
+ **/
+void g_river_context_register_command(GriverContext *ctx, const char *name,
+		GriverArgType type, const char * const *values)
+{
+	g_return_if_fail(GRIVER_IS_CONTEXT(ctx));
+	g_return_if_fail(name != NULL);
+	g_return_if_fail(type != GRIVER_ARG_ENUM || values != NULL);
+
+	GriverContextPrivate *priv = g_river_context_get_instance_private(ctx);
+	g_return_if_fail(!priv->connected);
+
+	griver_command_table_add(priv->commands, name, type, values, GRIVER_BUILTIN_NONE);
+}
+
+/**
+ * g_river_context_register_tag_commands:
+ * @ctx: The context
+ *
+ * Register the rivertile style commands, main-count, main-ratio,
+ * view-padding, outer-padding, main-location, plus layout, reset and
+ * reload, which reloads the plugin of the tag, see
+ * g_river_layout_spec_reload().
+ * These are applied to the tag state of the output (see
+ * g_river_output_get_tag_state()) by the default handler of
+ * #GriverOutput::command, so together with g_river_output_arrange()
+ * no script code has to run at all.
+ *
+ * Like g_river_context_register_command(), call this before
+ * g_river_context_connect() or g_river_context_run().
+ *
+ **/
+void g_river_context_register_tag_commands(GriverContext *ctx)
+{
+	g_return_if_fail(GRIVER_IS_CONTEXT(ctx));
+
+	GriverContextPrivate *priv = g_river_context_get_instance_private(ctx);
+	g_return_if_fail(!priv->connected);
+
+	griver_command_table_add_builtins(priv->commands);
+}
+
+/**
+ * g_river_context_set_layout_thread:
+ * @ctx: A context that isn't connected yet
+ * @enable: Whether to use a layout thread
+ * @cpu: The cpu to pin the thread to, or -1 to not pin it
+ * @policy: The scheduling policy of the thread, as for
+ *   pthread_setschedparam() (for example 1 for SCHED_FIFO), or -1 to
+ *   keep the default
+ * @priority: The scheduling priority used with @policy
+ *
+ * Handle layout demands and user commands on a dedicated thread, with a
+ * private event queue, so they are never delayed by whatever else runs on
+ * the main loop. Output add and remove are still dispatched by the main
+ * loop, but #GriverOutput::layout-demand, #GriverOutput::user-command and
+ * #GriverOutput::command are emitted on the layout thread, so the
+ * handlers must be thread safe.
+ *
+ * Failing to set the affinity or the scheduling (for example because of
+ * missing privileges) only gives a warning.
+ *
+ **/
+void g_river_context_set_layout_thread(GriverContext *ctx, gboolean enable,
+		int cpu, int policy, int priority)
+{
+	g_return_if_fail(GRIVER_IS_CONTEXT(ctx));
+
+	GriverContextPrivate *priv = g_river_context_get_instance_private(ctx);
+	g_return_if_fail(!priv->connected);
+
+	priv->use_layout_thread = enable;
+	priv->thread_cpu = cpu;
+	priv->thread_policy = policy;
+	priv->thread_priority = priority;
+}
+
+/**
+ * g_river_context_set_parallel_outputs:
+ * @ctx: A context that isn't connected yet
+ * @n_workers: The number of worker threads, 0 to handle every output on
+ *   the main loop again, or -1 for one per processor
+ *
+ * Give every output its own event queue and dispatch the queues on a pool
+ * of worker threads, the outputs being spread over the workers. When
+ * river asks every output for a layout at once, after a mode change or on
+ * a setup with many monitors, the outputs on different workers are laid
+ * out at the same time, and each commit is sent as soon as the layout of
+ * its output is done.
+ *
+ * Like with g_river_context_set_layout_thread(), which this replaces,
+ * #GriverOutput::layout-demand, #GriverOutput::user-command and
+ * #GriverOutput::command are emitted on the workers, so the handlers must
+ * be thread safe. The handlers of one output are never run concurrently.
+ *
+ **/
+void g_river_context_set_parallel_outputs(GriverContext *ctx, int n_workers)
+{
+	g_return_if_fail(GRIVER_IS_CONTEXT(ctx));
+
+	GriverContextPrivate *priv = g_river_context_get_instance_private(ctx);
+	g_return_if_fail(!priv->connected);
+
+	if (n_workers < 0) {
+		n_workers = g_get_num_processors();
+	}
+	priv->parallel_workers = n_workers;
+}
+
+/**
+ * g_river_context_set_coalesce_demands:
+ * @ctx: A context
+ * @coalesce: Whether to coalesce layout demands
+ *
+ * When river sends several layout demands for an output faster than they
+ * are answered, only the newest one matters: river ignores commits with
+ * an older serial. With coalescing, all queued events are dispatched
+ * first and only the newest demand of every output is emitted as
+ * #GriverOutput::layout-demand; the others are counted by
+ * g_river_output_get_skipped_demands(). It is off by default, since a
+ * handler then no longer sees every demand river sends.
+ *
+ **/
+void g_river_context_set_coalesce_demands(GriverContext *ctx, gboolean coalesce)
+{
+	g_return_if_fail(GRIVER_IS_CONTEXT(ctx));
+	GriverContextPrivate *priv = g_river_context_get_instance_private(ctx);
+	GHashTableIter iter;
+	gpointer value;
+
+	priv->coalesce = coalesce;
+	lock_outputs(ctx);
+	g_hash_table_iter_init(&iter, priv->outputs);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		griver_output_set_coalesce(GRIVER_OUTPUT(value), coalesce);
+	}
+	unlock_outputs(ctx);
+}
+
+/**
+ * g_river_context_set_state_file:
+ * @ctx: The context
+ * @path: (type filename) (nullable): Where to keep the state, %NULL for
+ *   griver/tag-state in the user cache directory
+ * @error: a #GError
+ *
+ * Keep the tag states of every output, see g_river_output_get_tag_state(),
+ * in a memory-mapped file, so a restarted layout generator continues with
+ * the ratios and main counts it had. The states are keyed by the name of
+ * the output and the namespace of the context, and restored as soon as
+ * river tells the name of an output, before its first layout demand.
+ *
+ * Changing a tag state writes to the file without any system call. Call
+ * this before g_river_context_connect() or g_river_context_run(); outputs
+ * that already exist start using the file right away.
+ *
+ * Returns: %TRUE if the file could be opened
+ **/
+gboolean g_river_context_set_state_file(GriverContext *ctx, const char *path,
+		GError **error)
+{
+	g_return_val_if_fail(GRIVER_IS_CONTEXT(ctx), false);
+	GriverContextPrivate *priv = g_river_context_get_instance_private(ctx);
+	char *default_path = NULL;
+
+	if (path == NULL) {
+		char *dir = g_build_filename(g_get_user_cache_dir(), "griver", NULL);
+		g_mkdir_with_parents(dir, 0700);
+		path = default_path = g_build_filename(dir, "tag-state", NULL);
+		g_free(dir);
+	}
+
+	GriverStateFile *file = griver_state_file_open(path, error);
+	g_free(default_path);
+	if (file == NULL) {
+		return false;
+	}
+	g_clear_pointer(&priv->state_file, griver_state_file_unref);
+	priv->state_file = file;
+
+	GHashTableIter iter;
+	gpointer value;
+
+	g_hash_table_iter_init(&iter, priv->outputs);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		GriverOutput *output = GRIVER_OUTPUT(value);
+		attach_state(ctx, output, g_river_output_get_name(output));
+	}
+	return true;
+}
+
+/**
+ * g_river_context_record_session:
+ * @ctx: The context
+ * @path: (type filename) (nullable): Where to write the session, %NULL to
+ *   stop recording
+ * @error: a #GError
+ *
+ * Record what river sends to the outputs of the context: the outputs
+ * coming and going, every layout demand and every user command, along
+ * with what was committed in answer. The log is compact and written in
+ * batches, once per dispatch.
+ *
+ * g_river_context_replay_session() plays it back without a compositor,
+ * which turns a real session into a benchmark or a regression test for a
+ * layout.
+ *
+ * Returns: %TRUE if the file could be opened
+ **/
+gboolean g_river_context_record_session(GriverContext *ctx, const char *path,
+		GError **error)
+{
+	g_return_val_if_fail(GRIVER_IS_CONTEXT(ctx), false);
+	GriverContextPrivate *priv = g_river_context_get_instance_private(ctx);
+	GriverSession *session = NULL;
+
+	if (path != NULL) {
+		session = griver_session_new(path, error);
+		if (session == NULL) {
+			return false;
+		}
+	}
+
+	GHashTableIter iter;
+	gpointer value;
+
+	lock_outputs(ctx);
+	g_hash_table_iter_init(&iter, priv->outputs);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		griver_output_set_session(GRIVER_OUTPUT(value), NULL);
+	}
+	unlock_outputs(ctx);
+
+	g_clear_pointer(&priv->session, griver_session_unref);
+	priv->session = session;
+
+	/* the log starts with the outputs that are already there */
+	g_hash_table_iter_init(&iter, priv->outputs);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		record_output_add(ctx, GRIVER_OUTPUT(value));
+	}
+	return true;
+}
+
+static bool commit_matches (GriverOutput *output, const GriverRecord *record)
+{
+	uint32_t serial;
+	const char *layout_name;
+	const uint32_t *dimensions;
+	guint n_dimensions;
+
+	if (!griver_output_get_last_commit(output, &serial, &layout_name,
+				&dimensions, &n_dimensions)) {
+		return false;
+	}
+	return serial == record->serial &&
+		g_strcmp0(layout_name, record->text) == 0 &&
+		n_dimensions == record->n_dimensions &&
+		memcmp(dimensions, record->dimensions,
+				n_dimensions * sizeof(uint32_t)) == 0;
+}
+
+static void replay_output_add (GriverContext *ctx, const GriverRecord *record)
+{
+	GriverContextPrivate *priv = g_river_context_get_instance_private (ctx);
+
+	/* without a layout manager the output commits to itself */
+	GriverOutput *output = GRIVER_OUTPUT(g_river_output_new(NULL, NULL,
+			record->uid, priv->namespace, false));
+	griver_output_set_command_table(output, priv->commands);
+	griver_output_set_name(output, record->text);
+	g_hash_table_replace(priv->outputs, GUINT_TO_POINTER(record->uid), output);
+	record_output_add(ctx, output);
+
+	g_signal_emit (ctx, griver_signals[GRIVER_ADD_OUTPUT], 0, output);
+}
+
+/**
+ * g_river_context_replay_session:
+ * @ctx: A context that isn't connected
+ * @path: (type filename): A session written by
+ *   g_river_context_record_session()
+ * @mismatches: (out) (optional): How many commits differ from the ones
+ *   in the session
+ * @error: a #GError
+ *
+ * Play a recorded session back, as fast as possible and without a
+ * compositor. Outputs are announced through #GriverContext::output-add,
+ * and the demands and commands go through the same signals as when
+ * connected to river, so the layout code can't tell the difference.
+ *
+ * What the outputs commit is compared to what was committed when the
+ * session was recorded: a commit for a recorded demand that is missing or
+ * has other dimensions counts as a mismatch. Demands are answered as they
+ * come, whether coalescing was on when recording or not. Recording while
+ * replaying writes the new commits to another session.
+ *
+ * Layouts that answer asynchronously have to commit before the call that
+ * handles the demand returns to be compared.
+ *
+ * Returns: %TRUE if the whole session could be read
+ **/
+gboolean g_river_context_replay_session(GriverContext *ctx, const char *path,
+		guint *mismatches, GError **error)
+{
+	g_return_val_if_fail(GRIVER_IS_CONTEXT(ctx), false);
+	g_return_val_if_fail(path != NULL, false);
+	GriverContextPrivate *priv = g_river_context_get_instance_private(ctx);
+	g_return_val_if_fail(!priv->connected, false);
+
+	GriverSessionReader *reader = griver_session_reader_new(path, error);
+	GError *read_error = NULL;
+	GriverRecord record;
+	guint differing = 0;
+
+	if (reader == NULL) {
+		return false;
+	}
+
+	while (griver_session_reader_next(reader, &record, &read_error)) {
+		GriverOutput *output = g_hash_table_lookup(priv->outputs,
+				GUINT_TO_POINTER(record.uid));
+
+		if (record.type == GRIVER_RECORD_OUTPUT_ADD) {
+			replay_output_add(ctx, &record);
+			continue;
+		}
+		if (output == NULL) {
+			continue;
+		}
+
+		switch (record.type) {
+			case GRIVER_RECORD_OUTPUT_REMOVE:
+				remove_output(ctx, record.uid);
+				break;
+			case GRIVER_RECORD_DEMAND:
+				griver_output_replay_demand(output, record.view_count,
+						record.width, record.height, record.tags, record.serial);
+				break;
+			case GRIVER_RECORD_COMMAND:
+				griver_output_replay_command(output, record.tags, record.text);
+				break;
+			case GRIVER_RECORD_COMMIT:
+				if (!commit_matches(output, &record)) {
+					differing++;
+				}
+				break;
+			default:
+				break;
+		}
+	}
+
+	griver_session_reader_free(reader);
+	/* like g_river_context_disconnect() */
+	g_hash_table_remove_all(priv->outputs);
+	if (priv->session != NULL) {
+		griver_session_flush(priv->session);
+	}
+
+	if (mismatches != NULL) {
+		*mismatches = differing;
+	}
+	if (read_error != NULL) {
+		g_propagate_error(error, read_error);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * g_river_context_get_control:
+ * @ctx: The context
+ *
+ * Get the object that runs river commands, like riverctl does, on the
+ * connection of the context. Commands only work while the context is
+ * connected and when river supports river-control.
+ *
+ * Returns: (transfer none): the control of the context
+ **/
+GriverControl *g_river_context_get_control(GriverContext *ctx)
+{
+	g_return_val_if_fail(GRIVER_IS_CONTEXT(ctx), NULL);
+	GriverContextPrivate *priv = g_river_context_get_instance_private(ctx);
+
+	if (priv->control == NULL) {
+		priv->control = griver_control_new();
+		update_control(ctx);
+	}
+	return priv->control;
+}
+
+/**
+ * g_river_context_get_stats:
+ * @ctx: A context
+ *
+ * The counters of all the outputs of the context added together, see
+ * g_river_output_get_stats(). Outputs that were removed aren't counted
+ * anymore.
+ *
+ * Returns: (transfer full): a snapshot of the counters
+ **/
+GriverStats *g_river_context_get_stats(GriverContext *ctx)
+{
+	g_return_val_if_fail(GRIVER_IS_CONTEXT(ctx), NULL);
+	GriverContextPrivate *priv = g_river_context_get_instance_private(ctx);
+	GriverCounters *counters = g_new(GriverCounters, 1);
+	GHashTableIter iter;
+	gpointer value;
+
+	griver_counters_reset(counters);
+	lock_outputs(ctx);
+	g_hash_table_iter_init(&iter, priv->outputs);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		griver_counters_merge(counters,
+				griver_output_get_counters(GRIVER_OUTPUT(value)));
+	}
+	unlock_outputs(ctx);
+
+	GriverStats *stats = griver_counters_to_stats(counters);
+	g_free(counters);
+	return stats;
+}
+
+/**
+ * g_river_context_reset_stats:
+ * @ctx: A context
+ *
+ * Sets the counters of every output of the context back to zero.
+ **/
+void g_river_context_reset_stats(GriverContext *ctx)
+{
+	g_return_if_fail(GRIVER_IS_CONTEXT(ctx));
+	GriverContextPrivate *priv = g_river_context_get_instance_private(ctx);
+	GHashTableIter iter;
+	gpointer value;
+
+	lock_outputs(ctx);
+	g_hash_table_iter_init(&iter, priv->outputs);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		g_river_output_reset_stats(GRIVER_OUTPUT(value));
+	}
+	unlock_outputs(ctx);
+}
+
+/**
+ * g_river_context_new_shared:
+ * @ctx: A context to share the connection with
+ * @namespace: The namespace of the new context
+ *
+ * Creates a new river context for another layout namespace that uses the
+ * same Wayland connection as @ctx. Each context gets its own outputs and
+ * signals, but dispatching any of them (for example with
+ * g_river_context_run()) dispatches all of them. Every context needs to
+ * be connected with g_river_context_connect() or g_river_context_run().
+ *
+ * Returns: (transfer full): a new river context object.
+ **/
+GObject *g_river_context_new_shared(GriverContext *ctx, const char *namespace) {
+	g_return_val_if_fail(GRIVER_IS_CONTEXT(ctx), NULL);
+	g_return_val_if_fail(namespace, NULL);
+
+	GriverContextPrivate *other = g_river_context_get_instance_private(ctx);
+	GriverContext *shared = GRIVER_CONTEXT(g_river_context_new(namespace));
+	GriverContextPrivate *priv = g_river_context_get_instance_private(shared);
+
+	connection_unref(priv->conn);
+	priv->conn = connection_ref(other->conn);
+	return (GObject *)shared;
+}
+
+/**
+ * g_river_first_set_bit_pos:
+ * @i: A tag bitfield
+ *
+ * Gets the position of the first (lowest) set bit, counting from 1.
  *
  * Returns: Index of position
  */
 int g_river_first_set_bit_pos(int i) {
-	g_return_val_if_fail(i > 0, 1);
+	g_return_val_if_fail(i != 0, 1);
 
-	return log2(i & -i) + 1;
+	return __builtin_ctz((unsigned int) i) + 1;
 }
 
 /**
  * g_river_last_set_bit_pos:
+ * @i: A tag bitfield
  *
- * Gets the position of the last bit.
+ * Gets the position of the last (highest) set bit, counting from 1.
  * 
  * Returns: Index of position
  */
 int g_river_last_set_bit_pos(int i) {
-	g_return_val_if_fail(i > 0, 1);
+	g_return_val_if_fail(i != 0, 1);
 
-	int pos = 0;
-	while (i >> 1) {
-		pos++;
+	return 32 - __builtin_clz((unsigned int) i);
+}
+
+/**
+ * g_river_next_set_bit_pos:
+ * @tags: A tag bitfield
+ * @pos: The position to start after, 0 to start from the beginning
+ *
+ * Gets the position of the next set bit after @pos, counting from 1.
+ * Iterate over every set tag with:
+ * |[<!-- language="C" -->
+ * for (int pos = g_river_next_set_bit_pos(tags, 0); pos; pos = g_river_next_set_bit_pos(tags, pos))
+ * ]|
+ *
+ * Returns: Index of position, or 0 if there are no more set bits.
+ */
+int g_river_next_set_bit_pos(uint32_t tags, int pos) {
+	g_return_val_if_fail(pos >= 0 && pos <= 32, 0);
+
+	if (pos == 32) {
+		return 0;
 	}
-	return pos;
+	tags &= ~0u << pos;
+	return tags ? __builtin_ctz(tags) + 1 : 0;
+}
+
+/**
+ * g_river_set_bit_count:
+ * @tags: A tag bitfield
+ *
+ * Counts the number of set bits, e.g the number of tags in @tags.
+ *
+ * Returns: Number of set bits
+ */
+int g_river_set_bit_count(uint32_t tags) {
+	return __builtin_popcount(tags);
 }
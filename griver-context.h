@@ -2,6 +2,10 @@
 #define __GRIVER_CONTEXT_H__
 
 #include <glib-object.h>
+#include <stdint.h>
+#include "griver-command.h"
+#include "griver-stats.h"
+#include "griver-control.h"
 
 G_BEGIN_DECLS
 
@@ -17,10 +21,49 @@ struct _GriverContextClass {
 
 gboolean g_river_context_run(GriverContext *ctx, GError **err);
 
+gboolean g_river_context_connect(GriverContext *ctx, GError **err);
+void g_river_context_disconnect(GriverContext *ctx);
+
+GSource *g_river_context_create_source(GriverContext *ctx);
+guint g_river_context_attach(GriverContext *ctx, GMainContext *context);
+
+int g_river_context_get_fd(GriverContext *ctx);
+gboolean g_river_context_prepare_read(GriverContext *ctx, GError **err);
+void g_river_context_cancel_read(GriverContext *ctx);
+gboolean g_river_context_read_events(GriverContext *ctx, GError **err);
+gboolean g_river_context_dispatch_pending(GriverContext *ctx, GError **err);
+
+const GError *g_river_context_get_error(GriverContext *ctx);
+
+void g_river_context_register_command(GriverContext *ctx, const char *name,
+		GriverArgType type, const char * const *values);
+void g_river_context_register_tag_commands(GriverContext *ctx);
+
+void g_river_context_set_layout_thread(GriverContext *ctx, gboolean enable,
+		int cpu, int policy, int priority);
+void g_river_context_set_parallel_outputs(GriverContext *ctx, int n_workers);
+void g_river_context_set_coalesce_demands(GriverContext *ctx, gboolean coalesce);
+
+gboolean g_river_context_set_state_file(GriverContext *ctx, const char *path,
+		GError **error);
+
+GriverControl *g_river_context_get_control(GriverContext *ctx);
+
+gboolean g_river_context_record_session(GriverContext *ctx, const char *path,
+		GError **error);
+gboolean g_river_context_replay_session(GriverContext *ctx, const char *path,
+		guint *mismatches, GError **error);
+
+GriverStats *g_river_context_get_stats(GriverContext *ctx);
+void g_river_context_reset_stats(GriverContext *ctx);
+
 GObject *g_river_context_new(const char *str);
+GObject *g_river_context_new_shared(GriverContext *ctx, const char *namespace);
 
 int g_river_first_set_bit_pos(int i);
 int g_river_last_set_bit_pos(int i);
+int g_river_next_set_bit_pos(uint32_t tags, int pos);
+int g_river_set_bit_count(uint32_t tags);
 
 G_END_DECLS
 
@@ -0,0 +1,20 @@
+#ifndef __GRIVER_CONTROL_PRIVATE_H__
+#define __GRIVER_CONTROL_PRIVATE_H__
+
+#include "griver-control.h"
+
+#include <wayland-client.h>
+#include "river-control-unstable-v1-client-protocol.h"
+
+G_BEGIN_DECLS
+
+GriverControl *griver_control_new (void);
+
+/* Where commands are sent. With a NULL manager every command still
+ * waiting for an answer fails with GRIVER_CONTROL_ERROR_DISCONNECTED */
+void griver_control_set_target (GriverControl *control, struct wl_display *display,
+		struct zriver_control_v1 *manager, struct wl_seat *seat);
+
+G_END_DECLS
+
+#endif /* __GRIVER_CONTROL_PRIVATE_H__ */
@@ -0,0 +1,307 @@
+#include "griver-control.h"
+#include "griver-control-private.h"
+
+struct _GriverControl {
+	GObject parent_instance;
+
+	struct wl_display *display;
+	struct zriver_control_v1 *manager;
+	struct wl_seat *seat;
+
+	/* Commands can be sent from the layout thread and the workers, the
+	 * answers come in on the thread dispatching the connection */
+	GMutex lock;
+	GQueue pending; // Command, in the order they were sent
+};
+
+/* A command sent to river that wasn't answered yet */
+typedef struct {
+	GriverControl *control; // a reference, like the one of the task
+
+	/* Sent from a thread with a main context of its own, the task is made
+	 * right away. Otherwise it is made when the answer comes in, on the
+	 * thread dispatching the connection, so the result is delivered in
+	 * the main context that dispatches it */
+	GTask *task;
+	GCancellable *cancellable;
+	GAsyncReadyCallback ready;
+	gpointer user_data;
+
+	/* the zriver_command_callback_v1, or a wl_callback standing in for it
+	 * when river can't run commands */
+	struct wl_proxy *proxy;
+	GList link;
+} Command;
+
+G_DEFINE_TYPE (GriverControl, g_river_control, G_TYPE_OBJECT)
+
+G_DEFINE_QUARK (griver-control-error-quark, g_river_control_error)
+
+static GTask *task_new (GriverControl *control, GCancellable *cancellable,
+		GAsyncReadyCallback callback, gpointer user_data)
+{
+	GTask *task = g_task_new(control, cancellable, callback, user_data);
+
+	g_task_set_source_tag(task, g_river_control_run_command_async);
+	return task;
+}
+
+/* Frees a command that is out of the queue, the task is left to the
+ * caller */
+static GTask *command_free (Command *command)
+{
+	GTask *task = command->task;
+
+	if (task == NULL) {
+		task = task_new(command->control, command->cancellable, command->ready,
+				command->user_data);
+	}
+	g_clear_object(&command->cancellable);
+	if (command->proxy != NULL) {
+		wl_proxy_destroy(command->proxy);
+	}
+	g_object_unref(command->control);
+	g_free(command);
+	return task;
+}
+
+/* Takes the command out of the queue */
+static GTask *command_finish (Command *command)
+{
+	GriverControl *control = command->control;
+
+	g_mutex_lock(&control->lock);
+	g_queue_unlink(&control->pending, &command->link);
+	g_mutex_unlock(&control->lock);
+	return command_free(command);
+}
+
+static void callback_handle_success (void *data,
+		struct zriver_command_callback_v1 *callback, const char *output)
+{
+	GTask *task = command_finish(data);
+
+	/* river already ran it, cancelling only drops the result */
+	if (!g_task_return_error_if_cancelled(task)) {
+		g_task_return_pointer(task, g_strdup(output), g_free);
+	}
+	g_object_unref(task);
+}
+
+static void callback_handle_failure (void *data,
+		struct zriver_command_callback_v1 *callback, const char *failure_message)
+{
+	GTask *task = command_finish(data);
+
+	if (!g_task_return_error_if_cancelled(task)) {
+		g_task_return_new_error(task, GRIVER_CONTROL_ERROR,
+				GRIVER_CONTROL_ERROR_FAILED, "%s", failure_message);
+	}
+	g_object_unref(task);
+}
+
+static const struct zriver_command_callback_v1_listener callback_listener = {
+	.success = callback_handle_success,
+	.failure = callback_handle_failure,
+};
+
+static void unsupported_handle_done (void *data, struct wl_callback *callback,
+		uint32_t callback_data)
+{
+	GTask *task = command_finish(data);
+
+	g_task_return_new_error(task, GRIVER_CONTROL_ERROR,
+			GRIVER_CONTROL_ERROR_NOT_SUPPORTED,
+			"Wayland compositor does not support river-control");
+	g_object_unref(task);
+}
+
+static const struct wl_callback_listener unsupported_listener = {
+	.done = unsupported_handle_done,
+};
+
+/* Fails the commands taken out of the queue, without holding the lock:
+ * the callbacks may send new commands */
+static void fail_pending (GQueue *pending)
+{
+	GList *link;
+
+	while ((link = g_queue_peek_head_link(pending)) != NULL) {
+		g_queue_unlink(pending, link);
+		GTask *task = command_free(link->data);
+
+		g_task_return_new_error(task, GRIVER_CONTROL_ERROR,
+				GRIVER_CONTROL_ERROR_DISCONNECTED,
+				"Disconnected before river answered");
+		g_object_unref(task);
+	}
+}
+
+static void control_dispose (GObject *object)
+{
+	GriverControl *control = GRIVER_CONTROL(object);
+
+	griver_control_set_target(control, NULL, NULL, NULL);
+
+	G_OBJECT_CLASS(g_river_control_parent_class)->dispose(object);
+}
+
+static void control_finalize (GObject *object)
+{
+	GriverControl *control = GRIVER_CONTROL(object);
+
+	g_mutex_clear(&control->lock);
+
+	G_OBJECT_CLASS(g_river_control_parent_class)->finalize(object);
+}
+
+static void g_river_control_init (GriverControl *control)
+{
+	control->display = NULL;
+	control->manager = NULL;
+	control->seat = NULL;
+	g_mutex_init(&control->lock);
+	g_queue_init(&control->pending);
+}
+
+static void g_river_control_class_init (GriverControlClass *klass)
+{
+	GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+	gobject_class->dispose = control_dispose;
+	gobject_class->finalize = control_finalize;
+}
+
+GriverControl *griver_control_new (void)
+{
+	return g_object_new(GRIVER_TYPE_CONTROL, NULL);
+}
+
+void griver_control_set_target (GriverControl *control, struct wl_display *display,
+		struct zriver_control_v1 *manager, struct wl_seat *seat)
+{
+	GQueue pending = G_QUEUE_INIT;
+
+	g_mutex_lock(&control->lock);
+	control->display = display;
+	control->manager = manager;
+	control->seat = seat;
+	if (manager == NULL) {
+		pending = control->pending;
+		g_queue_init(&control->pending);
+	}
+	g_mutex_unlock(&control->lock);
+
+	fail_pending(&pending);
+}
+
+/**
+ * g_river_control_run_command_async:
+ * @control: A #GriverControl, see g_river_context_get_control()
+ * @args: (array zero-terminated=1): The command and its arguments, like
+ *   the arguments of riverctl, for example { "focus-view", "next", NULL }
+ * @cancellable: (nullable): A #GCancellable
+ * @callback: (scope async) (closure user_data): Called when river answered
+ * @user_data: Data passed to @callback
+ *
+ * Sends a command to river without waiting for it to run. Any number of
+ * commands can be sent before the first answer comes back, river runs them
+ * in order. @callback is called from the thread-default main context of
+ * the caller once river answered, call
+ * g_river_control_run_command_finish() there to get the output.
+ *
+ * This can be called from any thread, including from the handlers on the
+ * layout thread or the workers. When the caller has no thread-default main
+ * context, like those, @callback is called from the one of the thread
+ * dispatching the connection instead, so the results keep coming in
+ * while g_river_context_run() runs.
+ *
+ * Cancelling doesn't stop a command that was sent, it only drops its
+ * result.
+ **/
+void g_river_control_run_command_async(GriverControl *control,
+		const char * const *args, GCancellable *cancellable,
+		GAsyncReadyCallback callback, gpointer user_data)
+{
+	g_return_if_fail(GRIVER_IS_CONTROL(control));
+	g_return_if_fail(args != NULL && args[0] != NULL);
+
+	Command *command = g_new0(Command, 1);
+	command->control = g_object_ref(control);
+	command->link.data = command;
+	if (g_main_context_get_thread_default() != NULL) {
+		command->task = task_new(control, cancellable, callback, user_data);
+	} else {
+		command->cancellable = cancellable ? g_object_ref(cancellable) : NULL;
+		command->ready = callback;
+		command->user_data = user_data;
+	}
+
+	g_mutex_lock(&control->lock);
+	if (control->manager != NULL && control->seat != NULL) {
+		for (const char * const *arg = args; *arg != NULL; arg++) {
+			zriver_control_v1_add_argument(control->manager, *arg);
+		}
+
+		struct zriver_command_callback_v1 *command_callback =
+			zriver_control_v1_run_command(control->manager, control->seat);
+		zriver_command_callback_v1_add_listener(command_callback,
+				&callback_listener, command);
+		command->proxy = (struct wl_proxy *) command_callback;
+	} else if (control->display != NULL && command->task == NULL) {
+		/* a roundtrip brings the error to the thread dispatching the
+		 * connection, like an answer would */
+		struct wl_callback *sync = wl_display_sync(control->display);
+		wl_callback_add_listener(sync, &unsupported_listener, command);
+		command->proxy = (struct wl_proxy *) sync;
+	} else {
+		g_mutex_unlock(&control->lock);
+
+		GTask *task = command_free(command);
+		g_task_return_new_error(task, GRIVER_CONTROL_ERROR,
+				GRIVER_CONTROL_ERROR_NOT_SUPPORTED,
+				"Wayland compositor does not support river-control");
+		g_object_unref(task);
+		return;
+	}
+	g_queue_push_tail_link(&control->pending, &command->link);
+
+	struct wl_display *display = control->display;
+	g_mutex_unlock(&control->lock);
+
+	/* doesn't block, whatever doesn't fit in the socket now goes out with
+	 * the next dispatch */
+	wl_display_flush(display);
+}
+
+/**
+ * g_river_control_run_command_finish:
+ * @control: A #GriverControl
+ * @result: The #GAsyncResult passed to the callback
+ * @error: a #GError
+ *
+ * Returns: (transfer full) (nullable): what the command printed, or %NULL
+ *   with @error set if it failed
+ **/
+char *g_river_control_run_command_finish(GriverControl *control,
+		GAsyncResult *result, GError **error)
+{
+	g_return_val_if_fail(g_task_is_valid(result, control), NULL);
+
+	return g_task_propagate_pointer(G_TASK(result), error);
+}
+
+/**
+ * g_river_control_get_pending:
+ * @control: A #GriverControl
+ *
+ * Returns: the number of commands sent that river didn't answer yet
+ **/
+guint g_river_control_get_pending(GriverControl *control)
+{
+	g_return_val_if_fail(GRIVER_IS_CONTROL(control), 0);
+
+	g_mutex_lock(&control->lock);
+	guint pending = control->pending.length;
+	g_mutex_unlock(&control->lock);
+	return pending;
+}
@@ -0,0 +1,49 @@
+#ifndef __GRIVER_CONTROL_H__
+#define __GRIVER_CONTROL_H__
+
+#include <glib-object.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define GRIVER_TYPE_CONTROL (g_river_control_get_type())
+
+G_DECLARE_FINAL_TYPE(GriverControl, g_river_control, GRIVER, CONTROL, GObject)
+
+/**
+ * GRIVER_CONTROL_ERROR:
+ *
+ * The error domain of g_river_control_run_command_finish().
+ **/
+#define GRIVER_CONTROL_ERROR (g_river_control_error_quark())
+
+/**
+ * GriverControlError:
+ * @GRIVER_CONTROL_ERROR_FAILED: River ran the command and it failed, the
+ *   message is the one river sent.
+ * @GRIVER_CONTROL_ERROR_NOT_SUPPORTED: The compositor doesn't support
+ *   river-control or has no seat.
+ * @GRIVER_CONTROL_ERROR_DISCONNECTED: The context was disconnected before
+ *   river answered.
+ *
+ * Errors of g_river_control_run_command_finish().
+ **/
+typedef enum {
+	GRIVER_CONTROL_ERROR_FAILED,
+	GRIVER_CONTROL_ERROR_NOT_SUPPORTED,
+	GRIVER_CONTROL_ERROR_DISCONNECTED,
+} GriverControlError;
+
+GQuark g_river_control_error_quark(void);
+
+void g_river_control_run_command_async(GriverControl *control,
+		const char * const *args, GCancellable *cancellable,
+		GAsyncReadyCallback callback, gpointer user_data);
+char *g_river_control_run_command_finish(GriverControl *control,
+		GAsyncResult *result, GError **error);
+
+guint g_river_control_get_pending(GriverControl *control);
+
+G_END_DECLS
+
+#endif /* __GRIVER_CONTROL_H__ */
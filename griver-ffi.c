@@ -0,0 +1,311 @@
+#include "griver-ffi.h"
+#include "griver-context.h"
+#include "griver-output.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdbool.h>
+
+struct _GriverFfi {
+	GriverContext *ctx;
+	bool connected;
+	char *error;
+
+	/* Queued by the handlers while dispatching, each holding a reference
+	 * on its output and owning its command */
+	GArray *events;
+	guint next;
+
+	GriverFfiEvent current;  // handed out last, released by the next call
+};
+
+static void event_clear (GriverFfiEvent *event)
+{
+	g_clear_object(&event->output);
+	g_free((char *) event->command);
+	event->command = NULL;
+	event->type = GRIVER_FFI_NONE;
+}
+
+static void queue_event (GriverFfi *ffi, GriverFfiEventType type,
+		GriverOutput *output)
+{
+	GriverFfiEvent event = {
+		.type = type,
+		.uid = g_river_output_get_uid(output),
+		.output = g_object_ref(output),
+	};
+
+	g_array_append_val(ffi->events, event);
+}
+
+static void on_demand (GriverOutput *output, uint32_t view_count,
+		uint32_t width, uint32_t height, uint32_t tags, uint32_t serial,
+		gpointer user_data)
+{
+	GriverFfi *ffi = user_data;
+
+	queue_event(ffi, GRIVER_FFI_DEMAND, output);
+	GriverFfiEvent *event = &g_array_index(ffi->events, GriverFfiEvent,
+			ffi->events->len - 1);
+	event->view_count = view_count;
+	event->width = width;
+	event->height = height;
+	event->tags = tags;
+	event->serial = serial;
+}
+
+static void on_user_command (GriverOutput *output, const char *command,
+		uint32_t tags, gpointer user_data)
+{
+	GriverFfi *ffi = user_data;
+
+	queue_event(ffi, GRIVER_FFI_COMMAND, output);
+	GriverFfiEvent *event = &g_array_index(ffi->events, GriverFfiEvent,
+			ffi->events->len - 1);
+	event->tags = tags;
+	event->command = g_strdup(command);
+}
+
+static void on_output_add (GriverContext *ctx, GriverOutput *output,
+		gpointer user_data)
+{
+	GriverFfi *ffi = user_data;
+
+	g_river_output_set_layout_demand_func(output, on_demand, ffi, NULL);
+	g_signal_connect(output, "user-command", G_CALLBACK(on_user_command), ffi);
+	queue_event(ffi, GRIVER_FFI_OUTPUT_ADD, output);
+}
+
+static void on_output_remove (GriverContext *ctx, GriverOutput *output,
+		gpointer user_data)
+{
+	GriverFfi *ffi = user_data;
+
+	g_signal_handlers_disconnect_by_data(output, ffi);
+	g_river_output_set_layout_demand_func(output, NULL, NULL, NULL);
+	queue_event(ffi, GRIVER_FFI_OUTPUT_REMOVE, output);
+}
+
+uint32_t griver_ffi_version (void)
+{
+	return GRIVER_FFI_VERSION;
+}
+
+GriverFfi *griver_ffi_new (const char *layout_namespace)
+{
+	g_return_val_if_fail(layout_namespace != NULL, NULL);
+	GriverFfi *ffi = g_new0(GriverFfi, 1);
+
+	ffi->ctx = GRIVER_CONTEXT(g_river_context_new(layout_namespace));
+	ffi->connected = false;
+	ffi->error = NULL;
+	ffi->events = g_array_new(false, false, sizeof(GriverFfiEvent));
+	ffi->next = 0;
+	ffi->current.type = GRIVER_FFI_NONE;
+
+	g_signal_connect(ffi->ctx, "output-add", G_CALLBACK(on_output_add), ffi);
+	g_signal_connect(ffi->ctx, "output-remove", G_CALLBACK(on_output_remove), ffi);
+	return ffi;
+}
+
+void griver_ffi_free (GriverFfi *ffi)
+{
+	if (ffi == NULL) {
+		return;
+	}
+
+	g_signal_handlers_disconnect_by_data(ffi->ctx, ffi);
+	g_river_context_disconnect(ffi->ctx);
+	g_object_unref(ffi->ctx);
+
+	event_clear(&ffi->current);
+	for (guint i = ffi->next; i < ffi->events->len; i++) {
+		event_clear(&g_array_index(ffi->events, GriverFfiEvent, i));
+	}
+	g_array_unref(ffi->events);
+	g_free(ffi->error);
+	g_free(ffi);
+}
+
+void griver_ffi_register_tag_commands (GriverFfi *ffi)
+{
+	g_river_context_register_tag_commands(ffi->ctx);
+}
+
+static bool set_error (GriverFfi *ffi, GError *error)
+{
+	g_free(ffi->error);
+	ffi->error = g_strdup(error->message);
+	g_error_free(error);
+	return false;
+}
+
+static bool has_events (GriverFfi *ffi)
+{
+	return ffi->next < ffi->events->len;
+}
+
+/* What is left of deadline for poll(), rounded up so it doesn't return
+ * early and -1 for no deadline */
+static int remaining_ms (gint64 deadline)
+{
+	if (deadline < 0) {
+		return -1;
+	}
+
+	gint64 left = deadline - g_get_monotonic_time();
+	if (left <= 0) {
+		return 0;
+	}
+	return (int) MIN((left + G_TIME_SPAN_MILLISECOND - 1) /
+			G_TIME_SPAN_MILLISECOND, G_MAXINT);
+}
+
+/* Dispatch until the handlers queued something or timeout_ms passed.
+ * Wakeups that queue nothing (signals, outputs, status or callbacks
+ * handled by the context itself) don't count, so nothing queued on
+ * return means the time is up */
+static bool wait_events (GriverFfi *ffi, int timeout_ms)
+{
+	GError *error = NULL;
+	gint64 deadline = timeout_ms < 0 ? -1 :
+		g_get_monotonic_time() + timeout_ms * G_TIME_SPAN_MILLISECOND;
+
+	for (;;) {
+		if (!g_river_context_dispatch_pending(ffi->ctx, &error)) {
+			return set_error(ffi, error);
+		}
+		if (has_events(ffi)) {
+			return true;
+		}
+
+		if (!g_river_context_prepare_read(ffi->ctx, &error)) {
+			return set_error(ffi, error);
+		}
+		if (has_events(ffi)) {
+			g_river_context_cancel_read(ffi->ctx);
+			return true;
+		}
+
+		struct pollfd fd = {
+			.fd = g_river_context_get_fd(ffi->ctx),
+			.events = POLLIN,
+		};
+		int ret = poll(&fd, 1, remaining_ms(deadline));
+		if (ret < 0) {
+			int saved_errno = errno;
+
+			g_river_context_cancel_read(ffi->ctx);
+			if (saved_errno == EINTR) {
+				continue;
+			}
+			g_free(ffi->error);
+			ffi->error = g_strdup(g_strerror(saved_errno));
+			return false;
+		}
+		if (ret == 0) {
+			g_river_context_cancel_read(ffi->ctx);
+			return true;
+		}
+
+		if (!g_river_context_read_events(ffi->ctx, &error)) {
+			return set_error(ffi, error);
+		}
+	}
+}
+
+int griver_ffi_next_event (GriverFfi *ffi, GriverFfiEvent *event,
+		int timeout_ms)
+{
+	GError *error = NULL;
+
+	event_clear(&ffi->current);
+	g_clear_pointer(&ffi->error, g_free);
+
+	if (!ffi->connected) {
+		if (!g_river_context_connect(ffi->ctx, &error)) {
+			set_error(ffi, error);
+			return -1;
+		}
+		ffi->connected = true;
+	}
+
+	if (!has_events(ffi)) {
+		g_array_set_size(ffi->events, 0);
+		ffi->next = 0;
+		if (!wait_events(ffi, timeout_ms)) {
+			return -1;
+		}
+		if (!has_events(ffi)) {
+			return 0;
+		}
+	}
+
+	ffi->current = g_array_index(ffi->events, GriverFfiEvent, ffi->next++);
+	*event = ffi->current;
+	return 1;
+}
+
+const char *griver_ffi_get_error (GriverFfi *ffi)
+{
+	return ffi->error;
+}
+
+void griver_ffi_push (GriverOutput *output, uint32_t x, uint32_t y,
+		uint32_t width, uint32_t height, uint32_t serial)
+{
+	g_river_output_push_view_dimensions(output, x, y, width, height, serial);
+}
+
+void griver_ffi_commit (GriverOutput *output, const char *layout_name,
+		uint32_t serial)
+{
+	g_river_output_commit_dimensions(output, layout_name, serial);
+}
+
+void griver_ffi_push_rects (GriverOutput *output, const uint32_t *dimensions,
+		uint32_t n_dimensions, const char *layout_name, uint32_t serial)
+{
+	g_river_output_push_view_dimensions_array(output, dimensions, n_dimensions,
+			layout_name, serial);
+}
+
+void griver_ffi_arrange (GriverOutput *output, uint32_t view_count,
+		uint32_t width, uint32_t height, uint32_t tags, uint32_t serial)
+{
+	g_river_output_arrange(output, view_count, width, height, tags, serial);
+}
+
+void griver_ffi_get_tag_state (GriverOutput *output, uint32_t tags,
+		GriverFfiTagState *state)
+{
+	const GriverTagState *tag_state = g_river_output_get_tag_state(output, tags);
+
+	state->main_count = tag_state->main_count;
+	state->view_padding = tag_state->view_padding;
+	state->outer_padding = tag_state->outer_padding;
+	state->layout = tag_state->layout;
+	state->rotation = tag_state->rotation;
+	state->ratio = tag_state->ratio;
+}
+
+void griver_ffi_set_tag_state (GriverOutput *output, uint32_t tags,
+		const GriverFfiTagState *state)
+{
+	GriverTagState tag_state = {
+		.main_count = state->main_count,
+		.view_padding = state->view_padding,
+		.outer_padding = state->outer_padding,
+		.layout = (GriverLayout) state->layout,
+		.rotation = (GriverRotation) state->rotation,
+		.ratio = state->ratio,
+	};
+
+	g_river_output_set_tag_state(output, tags, &tag_state);
+}
+
+const char *griver_ffi_output_get_name (GriverOutput *output)
+{
+	return g_river_output_get_name(output);
+}
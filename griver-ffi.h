@@ -0,0 +1,113 @@
+#ifndef __GRIVER_FFI_H__
+#define __GRIVER_FFI_H__
+
+/* A flat C ABI for foreign function interfaces like the one of LuaJIT,
+ * which can compile calls through it where it can't through GObject
+ * Introspection. Only fixed size types and opaque pointers, no GLib.
+ *
+ * Instead of callbacks, which LuaJIT can't compile, events are pulled
+ * with griver_ffi_next_event() and answered with direct calls:
+ *
+ *   GriverFfi *ffi = griver_ffi_new("my-layout");
+ *   GriverFfiEvent event;
+ *
+ *   while (griver_ffi_next_event(ffi, &event, -1) >= 0) {
+ *           if (event.type == GRIVER_FFI_DEMAND)
+ *                   griver_ffi_arrange(event.output, event.view_count,
+ *                                   event.width, event.height, event.tags,
+ *                                   event.serial);
+ *   }
+ *
+ * Everything below the version is declared again in lua/griver/ffi.lua,
+ * GRIVER_FFI_VERSION changes whenever any of it does. */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GRIVER_FFI_VERSION 1
+
+typedef struct _GriverFfi GriverFfi;
+typedef struct _GriverOutput GriverOutput;
+
+typedef enum {
+	GRIVER_FFI_NONE = 0,
+	GRIVER_FFI_OUTPUT_ADD,
+	GRIVER_FFI_OUTPUT_REMOVE,
+	GRIVER_FFI_DEMAND,
+	GRIVER_FFI_COMMAND,
+} GriverFfiEventType;
+
+/* output stays valid until the event after its GRIVER_FFI_OUTPUT_REMOVE
+ * has been pulled, command until the next event is */
+typedef struct {
+	int32_t type;
+	uint32_t uid;
+	GriverOutput *output;
+	uint32_t view_count;
+	uint32_t width;
+	uint32_t height;
+	uint32_t tags;
+	uint32_t serial;
+	const char *command;
+} GriverFfiEvent;
+
+/* The settings of a tag, see GriverTagState */
+typedef struct {
+	uint32_t main_count;
+	uint32_t view_padding;
+	uint32_t outer_padding;
+	uint32_t layout;
+	uint32_t rotation;
+	double ratio;
+} GriverFfiTagState;
+
+/* GRIVER_FFI_VERSION of the library, check it before anything else */
+uint32_t griver_ffi_version (void);
+
+GriverFfi *griver_ffi_new (const char *layout_namespace);
+void griver_ffi_free (GriverFfi *ffi);
+
+/* Apply main-count, main-ratio, layout and the other builtin commands to
+ * the tag states instead of passing them on as GRIVER_FFI_COMMAND. Call
+ * before the first griver_ffi_next_event() */
+void griver_ffi_register_tag_commands (GriverFfi *ffi);
+
+/* Fills event and returns 1, 0 when nothing came within timeout_ms and
+ * -1 on errors, see griver_ffi_get_error(). With a timeout_ms of -1 it
+ * waits for an event and never returns 0. Connects on the first call */
+int griver_ffi_next_event (GriverFfi *ffi, GriverFfiEvent *event,
+		int timeout_ms);
+
+/* Why the last call failed, NULL if it didn't */
+const char *griver_ffi_get_error (GriverFfi *ffi);
+
+/* Answering a demand, with the serial it came with */
+void griver_ffi_push (GriverOutput *output, uint32_t x, uint32_t y,
+		uint32_t width, uint32_t height, uint32_t serial);
+void griver_ffi_commit (GriverOutput *output, const char *layout_name,
+		uint32_t serial);
+
+/* Push 4 values (x, y, width, height) per view and commit, in one call */
+void griver_ffi_push_rects (GriverOutput *output, const uint32_t *dimensions,
+		uint32_t n_dimensions, const char *layout_name, uint32_t serial);
+
+/* Lay out and commit with the tag states, like g_river_output_arrange() */
+void griver_ffi_arrange (GriverOutput *output, uint32_t view_count,
+		uint32_t width, uint32_t height, uint32_t tags, uint32_t serial);
+
+void griver_ffi_get_tag_state (GriverOutput *output, uint32_t tags,
+		GriverFfiTagState *state);
+void griver_ffi_set_tag_state (GriverOutput *output, uint32_t tags,
+		const GriverFfiTagState *state);
+
+/* NULL until river told it */
+const char *griver_ffi_output_get_name (GriverOutput *output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GRIVER_FFI_H__ */
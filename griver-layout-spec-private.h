@@ -0,0 +1,19 @@
+#ifndef __GRIVER_LAYOUT_SPEC_PRIVATE_H__
+#define __GRIVER_LAYOUT_SPEC_PRIVATE_H__
+
+#include "griver-layout-spec.h"
+#include "griver-layout-program.h"
+
+G_BEGIN_DECLS
+
+/* Lay out with the program or the plugin of the spec */
+void griver_layout_spec_compute_rects (GriverLayoutSpec *spec,
+		uint32_t view_count, uint32_t width, uint32_t height,
+		const GriverLayoutParams *params, const GriverRects *rects);
+
+/* Changes whenever a plugin is reloaded */
+guint griver_layout_spec_get_generation (GriverLayoutSpec *spec);
+
+G_END_DECLS
+
+#endif /* __GRIVER_LAYOUT_SPEC_PRIVATE_H__ */
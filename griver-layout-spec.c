@@ -0,0 +1,402 @@
+#include "griver-layout-spec.h"
+#include "griver-layout-spec-private.h"
+#include "griver-layout-plugin.h"
+
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <gmodule.h>
+#include <stdbool.h>
+
+struct _GriverLayoutSpec {
+	gint ref_count;
+	char *name;
+	char *source;       // the spec, or the path of the plugin
+	GriverLayoutProgram program;
+
+	/* Plugins only, the lock is held while computing and swapping */
+	bool is_plugin;
+	GMutex lock;
+	GModule *module;
+	const GriverLayoutPlugin *plugin;
+	guint generation;   // bumped by every reload
+	GFileMonitor *monitor;
+	struct _Watch *watch; // what the monitor knows of the spec
+};
+
+/* The monitor only has a weak reference to its spec: the last unref can
+ * happen on the layout thread while the monitor reports a change on the
+ * main loop. The reference is cleared under the lock before the spec is
+ * freed */
+typedef struct _Watch {
+	GriverLayoutSpec *spec;
+} Watch;
+
+static GMutex watch_lock;
+
+G_DEFINE_BOXED_TYPE (GriverLayoutSpec, g_river_layout_spec,
+		g_river_layout_spec_ref, g_river_layout_spec_unref)
+
+G_DEFINE_QUARK (griver-layout-spec-error-quark, g_river_layout_spec_error)
+
+/**
+ * g_river_layout_spec_new:
+ * @name: What we call the layout, sent to river on commit
+ * @spec: The layout, for example "h(rows(main):ratio, rows)"
+ * @error: a #GError
+ *
+ * Compiles a layout description. A layout is a tree of containers and
+ * leaves:
+ *
+ * - `h(a, b, ...)` puts its children side by side, `v(a, b, ...)` on top
+ *   of each other.
+ * - `rows`, `cols`, `mono` and `grid` hold views, stacked, in a row, on top
+ *   of each other or in a grid. An optional count says how many:
+ *   `rows(main)` takes the main views, `rows(3)` three views, and `rows(*)`
+ *   or just `rows` shares the views that are left.
+ * - A child followed by `:0.3` gets that part of its parent, `:ratio` the
+ *   main ratio. The other children share what is left, so the weights next
+ *   to them must add up to less than 1, and children without views give
+ *   their space to their siblings.
+ *
+ * The tall layout is "h(rows(main):ratio, rows)". Main location and
+ * padding are applied the same way as for the builtin layouts.
+ *
+ * Returns: (transfer full): a new spec or %NULL if @spec isn't valid
+ **/
+GriverLayoutSpec *g_river_layout_spec_new(const char *name, const char *spec,
+		GError **error)
+{
+	g_return_val_if_fail(name != NULL, NULL);
+	g_return_val_if_fail(spec != NULL, NULL);
+	g_return_val_if_fail(error == NULL || *error == NULL, NULL);
+
+	GriverLayoutSpec *layout = g_new0(GriverLayoutSpec, 1);
+	size_t offset = 0;
+	const char *message = NULL;
+
+	if (!griver_layout_program_compile(&layout->program, spec, &offset, &message)) {
+		g_set_error(error, GRIVER_LAYOUT_SPEC_ERROR, GRIVER_LAYOUT_SPEC_ERROR_PARSE,
+				"Invalid layout spec at offset %zu: %s", offset, message);
+		g_free(layout);
+		return NULL;
+	}
+
+	layout->ref_count = 1;
+	layout->name = g_strdup(name);
+	layout->source = g_strdup(spec);
+	return layout;
+}
+
+/* dlopen() hands back the object it already has for a file, even if the
+ * file changed, so every load gets a private copy */
+static GModule *open_copy (const char *path, GError **error)
+{
+	char *contents = NULL;
+	char *copy_path = NULL;
+	gsize length = 0;
+	GModule *module = NULL;
+
+	if (!g_file_get_contents(path, &contents, &length, error)) {
+		return NULL;
+	}
+	int fd = g_file_open_tmp("griver-plugin-XXXXXX.so", &copy_path, error);
+	if (fd < 0) {
+		g_free(contents);
+		return NULL;
+	}
+	g_close(fd, NULL);
+
+	if (g_file_set_contents(copy_path, contents, length, error)) {
+		module = g_module_open(copy_path, G_MODULE_BIND_LAZY | G_MODULE_BIND_LOCAL);
+		if (module == NULL) {
+			g_set_error(error, GRIVER_LAYOUT_SPEC_ERROR,
+					GRIVER_LAYOUT_SPEC_ERROR_PLUGIN, "Can not load %s: %s",
+					path, g_module_error());
+		}
+	}
+
+	/* the mapping stays after the file is gone */
+	g_unlink(copy_path);
+	g_free(copy_path);
+	g_free(contents);
+	return module;
+}
+
+static const GriverLayoutPlugin *load_plugin (const char *path, GModule **module,
+		GError **error)
+{
+	GriverLayoutPluginFunc func = NULL;
+
+	*module = open_copy(path, error);
+	if (*module == NULL) {
+		return NULL;
+	}
+	if (!g_module_symbol(*module, GRIVER_LAYOUT_PLUGIN_SYMBOL, (gpointer *) &func) ||
+			func == NULL) {
+		g_set_error(error, GRIVER_LAYOUT_SPEC_ERROR, GRIVER_LAYOUT_SPEC_ERROR_PLUGIN,
+				"%s has no %s", path, GRIVER_LAYOUT_PLUGIN_SYMBOL);
+		goto fail;
+	}
+
+	const GriverLayoutPlugin *plugin = func();
+	if (plugin == NULL || plugin->abi != GRIVER_LAYOUT_PLUGIN_ABI ||
+			plugin->size < sizeof(GriverLayoutPlugin) ||
+			plugin->name == NULL || plugin->compute == NULL) {
+		g_set_error(error, GRIVER_LAYOUT_SPEC_ERROR, GRIVER_LAYOUT_SPEC_ERROR_PLUGIN,
+				"%s was built for another version of griver", path);
+		goto fail;
+	}
+	return plugin;
+
+fail:
+	g_module_close(*module);
+	*module = NULL;
+	return NULL;
+}
+
+/**
+ * g_river_layout_spec_new_from_plugin:
+ * @path: (type filename): A shared object implementing
+ *   griver-layout-plugin.h
+ * @error: a #GError
+ *
+ * Loads a layout written in C as a plugin. It is used like any other spec,
+ * but can be replaced while griver runs with g_river_layout_spec_reload(),
+ * keeping the connection, the namespace and the tag states.
+ *
+ * The name of the layout is the one the plugin had when it was loaded
+ * here, reloading doesn't change it.
+ *
+ * Returns: (transfer full): a new spec or %NULL if @path can't be loaded
+ **/
+GriverLayoutSpec *g_river_layout_spec_new_from_plugin(const char *path,
+		GError **error)
+{
+	g_return_val_if_fail(path != NULL, NULL);
+	g_return_val_if_fail(error == NULL || *error == NULL, NULL);
+
+	GModule *module = NULL;
+	const GriverLayoutPlugin *plugin = load_plugin(path, &module, error);
+	if (plugin == NULL) {
+		return NULL;
+	}
+
+	GriverLayoutSpec *layout = g_new0(GriverLayoutSpec, 1);
+	layout->ref_count = 1;
+	layout->name = g_strdup(plugin->name);
+	layout->source = g_strdup(path);
+	layout->is_plugin = true;
+	g_mutex_init(&layout->lock);
+	layout->module = module;
+	layout->plugin = plugin;
+	return layout;
+}
+
+/**
+ * g_river_layout_spec_reload:
+ * @spec: A #GriverLayoutSpec made by g_river_layout_spec_new_from_plugin()
+ * @error: a #GError
+ *
+ * Loads the plugin again and switches to it. If the new plugin can't be
+ * loaded the old one stays. Outputs use the new code from their next
+ * layout demand, layouts cached with the old code (see
+ * g_river_output_set_layout_cache()) aren't used again; the builtin
+ * "reload" command, see
+ * g_river_context_register_tag_commands(), makes river send one right away.
+ *
+ * Returns: %TRUE if the plugin was replaced
+ **/
+gboolean g_river_layout_spec_reload(GriverLayoutSpec *spec, GError **error)
+{
+	g_return_val_if_fail(spec != NULL, false);
+	g_return_val_if_fail(error == NULL || *error == NULL, false);
+
+	if (!spec->is_plugin) {
+		g_set_error(error, GRIVER_LAYOUT_SPEC_ERROR, GRIVER_LAYOUT_SPEC_ERROR_PLUGIN,
+				"%s is not a plugin", spec->name);
+		return false;
+	}
+
+	GModule *module = NULL;
+	const GriverLayoutPlugin *plugin = load_plugin(spec->source, &module, error);
+	if (plugin == NULL) {
+		return false;
+	}
+
+	g_mutex_lock(&spec->lock);
+	GModule *old = spec->module;
+	spec->module = module;
+	spec->plugin = plugin;
+	/* the outputs drop what they cached with the old plugin */
+	g_atomic_int_inc(&spec->generation);
+	g_mutex_unlock(&spec->lock);
+
+	g_module_close(old);
+	return true;
+}
+
+/* A new reference to the spec, unless it is already on its way out */
+static GriverLayoutSpec *watch_get (Watch *watch)
+{
+	GriverLayoutSpec *spec = NULL;
+	gint count = 0;
+
+	g_mutex_lock(&watch_lock);
+	if (watch->spec != NULL) {
+		do {
+			count = g_atomic_int_get(&watch->spec->ref_count);
+		} while (count > 0 && !g_atomic_int_compare_and_exchange(
+					&watch->spec->ref_count, count, count + 1));
+		spec = count > 0 ? watch->spec : NULL;
+	}
+	g_mutex_unlock(&watch_lock);
+	return spec;
+}
+
+static void plugin_changed (GFileMonitor *monitor, GFile *file, GFile *other_file,
+		GFileMonitorEvent event, gpointer user_data)
+{
+	GError *error = NULL;
+
+	if (event != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT &&
+			event != G_FILE_MONITOR_EVENT_CREATED) {
+		return;
+	}
+
+	GriverLayoutSpec *spec = watch_get(user_data);
+	if (spec == NULL) {
+		return;
+	}
+	if (!g_river_layout_spec_reload(spec, &error)) {
+		g_warning("%s", error->message);
+		g_error_free(error);
+	}
+	g_river_layout_spec_unref(spec);
+}
+
+/**
+ * g_river_layout_spec_set_auto_reload:
+ * @spec: A #GriverLayoutSpec made by g_river_layout_spec_new_from_plugin()
+ * @enable: Whether to reload when the plugin changes on disk
+ *
+ * Reload the plugin whenever its file is written. The file is watched from
+ * the thread-default main context, so it needs a running main loop, see
+ * g_river_context_attach().
+ **/
+void g_river_layout_spec_set_auto_reload(GriverLayoutSpec *spec, gboolean enable)
+{
+	g_return_if_fail(spec != NULL);
+	g_return_if_fail(spec->is_plugin);
+
+	if (!enable) {
+		if (spec->monitor != NULL) {
+			g_mutex_lock(&watch_lock);
+			spec->watch->spec = NULL;
+			g_mutex_unlock(&watch_lock);
+
+			g_signal_handlers_disconnect_by_data(spec->monitor, spec->watch);
+			g_file_monitor_cancel(spec->monitor);
+			g_clear_object(&spec->monitor);
+			spec->watch = NULL;
+		}
+		return;
+	}
+	if (spec->monitor != NULL) {
+		return;
+	}
+
+	GFile *file = g_file_new_for_path(spec->source);
+	spec->monitor = g_file_monitor_file(file, G_FILE_MONITOR_NONE, NULL, NULL);
+	g_object_unref(file);
+	if (spec->monitor != NULL) {
+		spec->watch = g_new0(Watch, 1);
+		spec->watch->spec = spec;
+		/* the watch goes with the handler, which may outlive the spec */
+		g_signal_connect_data(spec->monitor, "changed",
+				G_CALLBACK(plugin_changed), spec->watch,
+				(GClosureNotify) g_free, 0);
+	}
+}
+
+/**
+ * g_river_layout_spec_ref:
+ * @spec: A #GriverLayoutSpec
+ *
+ * Returns: (transfer full): @spec
+ **/
+GriverLayoutSpec *g_river_layout_spec_ref(GriverLayoutSpec *spec)
+{
+	g_return_val_if_fail(spec != NULL, NULL);
+
+	g_atomic_int_inc(&spec->ref_count);
+	return spec;
+}
+
+/**
+ * g_river_layout_spec_unref:
+ * @spec: (transfer full): A #GriverLayoutSpec
+ *
+ * Drops a reference, the spec is freed with the last one.
+ **/
+void g_river_layout_spec_unref(GriverLayoutSpec *spec)
+{
+	g_return_if_fail(spec != NULL);
+
+	if (g_atomic_int_dec_and_test(&spec->ref_count)) {
+		if (spec->is_plugin) {
+			g_river_layout_spec_set_auto_reload(spec, false);
+			g_module_close(spec->module);
+			g_mutex_clear(&spec->lock);
+		}
+		g_free(spec->name);
+		g_free(spec->source);
+		g_free(spec);
+	}
+}
+
+/**
+ * g_river_layout_spec_get_name:
+ * @spec: A #GriverLayoutSpec
+ *
+ * Returns: (transfer none): the name given to g_river_layout_spec_new()
+ **/
+const char *g_river_layout_spec_get_name(const GriverLayoutSpec *spec)
+{
+	g_return_val_if_fail(spec != NULL, NULL);
+
+	return spec->name;
+}
+
+/**
+ * g_river_layout_spec_get_source:
+ * @spec: A #GriverLayoutSpec
+ *
+ * Returns: (transfer none): the spec given to g_river_layout_spec_new(), or
+ *   the path of a plugin
+ **/
+const char *g_river_layout_spec_get_source(const GriverLayoutSpec *spec)
+{
+	g_return_val_if_fail(spec != NULL, NULL);
+
+	return spec->source;
+}
+
+void griver_layout_spec_compute_rects (GriverLayoutSpec *spec,
+		uint32_t view_count, uint32_t width, uint32_t height,
+		const GriverLayoutParams *params, const GriverRects *rects)
+{
+	if (!spec->is_plugin) {
+		griver_layout_program_compute_rects(&spec->program, view_count, width,
+				height, params, rects);
+		return;
+	}
+
+	g_mutex_lock(&spec->lock);
+	spec->plugin->compute(view_count, width, height, params, rects);
+	g_mutex_unlock(&spec->lock);
+}
+
+guint griver_layout_spec_get_generation (GriverLayoutSpec *spec)
+{
+	return g_atomic_int_get(&spec->generation);
+}
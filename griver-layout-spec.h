@@ -0,0 +1,58 @@
+#ifndef __GRIVER_LAYOUT_SPEC_H__
+#define __GRIVER_LAYOUT_SPEC_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GRIVER_TYPE_LAYOUT_SPEC (g_river_layout_spec_get_type())
+
+/**
+ * GRIVER_LAYOUT_SPEC_ERROR:
+ *
+ * The error domain of g_river_layout_spec_new().
+ **/
+#define GRIVER_LAYOUT_SPEC_ERROR (g_river_layout_spec_error_quark())
+
+/**
+ * GriverLayoutSpecError:
+ * @GRIVER_LAYOUT_SPEC_ERROR_PARSE: The spec isn't valid, the message says
+ *   where and why.
+ * @GRIVER_LAYOUT_SPEC_ERROR_PLUGIN: The plugin couldn't be loaded or was
+ *   built for another ABI.
+ *
+ * Errors of g_river_layout_spec_new().
+ **/
+typedef enum {
+	GRIVER_LAYOUT_SPEC_ERROR_PARSE,
+	GRIVER_LAYOUT_SPEC_ERROR_PLUGIN,
+} GriverLayoutSpecError;
+
+/**
+ * GriverLayoutSpec:
+ *
+ * A layout described by a string and compiled once, so laying out with it
+ * is as fast as with a builtin layout, or loaded from a plugin. See
+ * g_river_layout_spec_new() and g_river_layout_spec_new_from_plugin().
+ **/
+typedef struct _GriverLayoutSpec GriverLayoutSpec;
+
+GType g_river_layout_spec_get_type(void);
+GQuark g_river_layout_spec_error_quark(void);
+
+GriverLayoutSpec *g_river_layout_spec_new(const char *name, const char *spec,
+		GError **error);
+GriverLayoutSpec *g_river_layout_spec_new_from_plugin(const char *path,
+		GError **error);
+gboolean g_river_layout_spec_reload(GriverLayoutSpec *spec, GError **error);
+void g_river_layout_spec_set_auto_reload(GriverLayoutSpec *spec, gboolean enable);
+
+GriverLayoutSpec *g_river_layout_spec_ref(GriverLayoutSpec *spec);
+void g_river_layout_spec_unref(GriverLayoutSpec *spec);
+
+const char *g_river_layout_spec_get_name(const GriverLayoutSpec *spec);
+const char *g_river_layout_spec_get_source(const GriverLayoutSpec *spec);
+
+G_END_DECLS
+
+#endif /* __GRIVER_LAYOUT_SPEC_H__ */
@@ -0,0 +1,32 @@
+#include "griver-layout.h"
+
+/**
+ * g_river_layout_get_symbol:
+ * @layout: A #GriverLayout
+ *
+ * A short name for the layout, suitable as layout name when committing.
+ *
+ * Returns: (transfer none): the symbol
+ **/
+const char *g_river_layout_get_symbol(GriverLayout layout)
+{
+	switch (layout) {
+		case GRIVER_LAYOUT_TALL:
+			return "[]=";
+		case GRIVER_LAYOUT_MONOCLE:
+			return "[M]";
+		case GRIVER_LAYOUT_GRID:
+			return "###";
+		case GRIVER_LAYOUT_DWINDLE:
+			return "[\\]";
+		case GRIVER_LAYOUT_SPIRAL:
+			return "[@]";
+		case GRIVER_LAYOUT_CENTERED_MASTER:
+			return "|M|";
+		case GRIVER_LAYOUT_MULTI_COLUMN:
+			return "|||";
+		case GRIVER_LAYOUT_DECK:
+			return "[D]";
+	}
+	return "";
+}
@@ -0,0 +1,13 @@
+#ifndef __GRIVER_LAYOUT_H__
+#define __GRIVER_LAYOUT_H__
+
+#include <glib-object.h>
+#include "griver-layout-types.h"
+
+G_BEGIN_DECLS
+
+const char *g_river_layout_get_symbol(GriverLayout layout);
+
+G_END_DECLS
+
+#endif /* __GRIVER_LAYOUT_H__ */
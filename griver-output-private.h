@@ -0,0 +1,55 @@
+#ifndef __GRIVER_OUTPUT_PRIVATE_H__
+#define __GRIVER_OUTPUT_PRIVATE_H__
+
+#include "griver-output.h"
+#include "griver-stats-private.h"
+#include "griver-status-private.h"
+#include "griver-state-file-private.h"
+#include "griver-session-private.h"
+
+G_BEGIN_DECLS
+
+/* The commands registered on the context, shared by all its outputs */
+void griver_output_set_command_table (GriverOutput *out, GHashTable *commands);
+
+/* When coalescing, demands are only recorded when dispatched and handled
+ * by flush, once all queued events have been dispatched */
+void griver_output_set_coalesce (GriverOutput *out, gboolean coalesce);
+void griver_output_flush_demand (GriverOutput *out);
+
+const GriverCounters *griver_output_get_counters (GriverOutput *out);
+
+/* Copy what river-status reported and return what changed. The setter can
+ * run under the layout thread lock, notify must not */
+GriverStatusChange griver_output_set_status (GriverOutput *out,
+		const GriverOutputStatus *status);
+void griver_output_notify_status (GriverOutput *out, GriverStatusChange changed);
+
+void griver_output_set_name (GriverOutput *out, const char *name);
+
+/* Keep the tag states in storage, a part of file, or in the output again
+ * with NULL. Unless restore is set, the current states are copied over */
+void griver_output_set_tag_storage (GriverOutput *out, GriverStateFile *file,
+		GriverTagState *storage, bool restore);
+
+/* Write the demands and commands of the output and what it commits to
+ * session, or stop with NULL */
+void griver_output_set_session (GriverOutput *out, GriverSession *session);
+
+/* Feed a recorded event through the same path as the ones from river.
+ * Outputs without a river_layout keep what they commit instead of sending
+ * it */
+void griver_output_replay_demand (GriverOutput *out, uint32_t view_count,
+		uint32_t width, uint32_t height, uint32_t tags, uint32_t serial);
+void griver_output_replay_command (GriverOutput *out, uint32_t tags,
+		const char *command);
+
+/* The last commit, while recording or without a river_layout. The
+ * dimensions are valid until the next commit */
+bool griver_output_get_last_commit (GriverOutput *out, uint32_t *serial,
+		const char **layout_name, const uint32_t **dimensions,
+		guint *n_dimensions);
+
+G_END_DECLS
+
+#endif /* __GRIVER_OUTPUT_PRIVATE_H__ */
@@ -1,10 +1,17 @@
 #include "griver-output.h"
+#include "griver-output-private.h"
+#include "griver-command-private.h"
+#include "griver-layout-kernel.h"
+#include "griver-layout-spec-private.h"
+#include "griver-stats-private.h"
+#include "griver-trace-private.h"
 #include "glibconfig.h"
 
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <wayland-client-core.h>
 #include <wayland-client.h>
 #include <wayland-client-protocol.h>
@@ -14,17 +21,149 @@
 enum {
   GRIVER_LAYOUT_DEMAND,
   GRIVER_USER_COMMAND,
+  GRIVER_COMMAND,
   GRIVER_OUTPUT_LAST_SIGNAL
 };
 
 static guint griver_signals[GRIVER_OUTPUT_LAST_SIGNAL] = { 0 };
 
+enum {
+  PROP_0,
+  PROP_FOCUSED_TAGS,
+  PROP_URGENT_TAGS,
+  PROP_OCCUPIED_TAGS,
+  PROP_VIEW_COUNT,
+  PROP_FOCUSED,
+  N_PROPERTIES
+};
+
+static GParamSpec *griver_properties[N_PROPERTIES] = { NULL, };
+
+/* A layout is cached for what river demanded it for and the parameters it
+ * was made with */
+typedef struct {
+	uint32_t tags;
+	uint32_t view_count;
+	uint32_t width;
+	uint32_t height;
+	guint64 params_hash;
+} LayoutCacheKey;
+
+/* Switching between view counts, sizes or parameter sets keeps every one
+ * cached, up to a point */
+#define LAYOUT_CACHE_MAX 256
+
+/* The last layout committed for a demand and parameters */
+typedef struct {
+	LayoutCacheKey key;
+	bool valid;
+	guint spec_generation; // of the plugin of the tags, when cached
+
+	char *layout_name;
+	GArray *dimensions;
+} LayoutCacheEntry;
+
+/* Views as a structure of arrays, the way libgriver-layout writes them */
+typedef struct {
+	GArray *x;
+	GArray *y;
+	GArray *width;
+	GArray *height;
+} RectBuffer;
+
+/* The last layout computed for a tag, for incremental layouts */
+typedef struct {
+	bool valid;
+	GriverLayout layout;
+	uint32_t view_count;
+	uint32_t width;
+	uint32_t height;
+	GriverLayoutParams params;
+	RectBuffer rects;
+} LayoutGeometry;
+
+/* The layout g_river_output_arrange() is expected to produce for the next
+ * demand, computed when river-status reports a change */
+typedef struct {
+	bool valid;
+	uint32_t tags;
+	uint32_t view_count;
+	uint32_t width;
+	uint32_t height;
+	GriverTagState state;
+	GriverLayoutSpec *spec;
+	guint spec_generation;
+	RectBuffer rects;
+} Speculation;
+
 typedef struct {
 	int cmd_tags;
     bool initialized;
 
 	uint32_t uid;
 
+	/* The demand we are currently answering */
+	uint32_t demand_view_count;
+	uint32_t demand_width;
+	uint32_t demand_height;
+	uint32_t demand_tags;
+	uint32_t demand_serial;
+	gint64 demand_time;       // when the demand was received
+	bool demand_answered;
+	uint32_t latest_serial;   // of the newest demand received
+
+	GriverTagState *tag_states;      // own_tag_states or in state_file
+	GriverTagState own_tag_states[GRIVER_TAG_COUNT];
+	GriverStateFile *state_file;
+	char *name;                      // of the wl_output, once known
+	GriverLayoutSpec *tag_specs[GRIVER_TAG_COUNT]; // overrides the layout
+	GHashTable *commands;
+
+	GriverLayoutDemandFunc demand_func;
+	gpointer demand_data;
+	GDestroyNotify demand_notify;
+
+	/* The newest demand not yet answered, when coalescing */
+	bool coalesce;
+	bool has_pending;
+	uint32_t pending_view_count;
+	uint32_t pending_width;
+	uint32_t pending_height;
+	uint32_t pending_tags;
+	uint32_t pending_serial;
+	gint64 pending_time;
+
+	GriverCounters counters;
+
+	/* From river-status, see griver_output_set_status() */
+	uint32_t focused_tags;
+	uint32_t urgent_tags;
+	uint32_t occupied_tags;
+	GArray *view_tags;
+	bool focused;
+
+	bool cache_enabled;
+	bool replaying;
+	GHashTable *layout_cache;  // LayoutCacheKey -> LayoutCacheEntry
+	GHashTable *layout_params; // tags -> guint64, the current params hash
+	GArray *recording;        // dimensions pushed for demand_serial
+
+	RectBuffer rects;  // scratch space for the layouts
+	bool incremental;
+	LayoutGeometry geometry[GRIVER_TAG_COUNT];
+
+	bool speculative;
+	Speculation speculation;
+
+	/* What was pushed and committed, kept while recording a session or
+	 * when replaying one without a river_layout */
+	GriverSession *session;
+	GArray *pushed;
+	GArray *committed;
+	char *committed_name;
+	uint32_t committed_serial;
+	bool has_committed;
+
 	struct wl_output       *output;
 	struct river_layout_v3 *layout;
 } GriverOutputPrivate;
@@ -37,15 +176,112 @@ static void push_view_dimensions (GriverOutput *out,
 			uint32_t x, uint32_t y, uint32_t width, uint32_t height,
 			uint32_t serial);
 
+static void push_view_dimensions_array (GriverOutput *out,
+			const uint32_t *dimensions, guint n_dimensions,
+			const char *layout_name, uint32_t serial);
+
+static void command (GriverOutput *out, const GriverCommand *cmd, uint32_t tags);
+static void layout_demand (GriverOutput *out, uint32_t view_count, uint32_t width,
+		uint32_t height, uint32_t tags, uint32_t serial);
+
 static void output_finalize (GObject *object);
+static bool answer_speculation (GriverOutput *out, uint32_t view_count,
+		uint32_t width, uint32_t height, uint32_t tags, uint32_t serial);
+static void speculate (GriverOutput *out);
+
+static void rect_buffer_init (RectBuffer *buf)
+{
+	buf->x = g_array_new(false, false, sizeof(uint32_t));
+	buf->y = g_array_new(false, false, sizeof(uint32_t));
+	buf->width = g_array_new(false, false, sizeof(uint32_t));
+	buf->height = g_array_new(false, false, sizeof(uint32_t));
+}
+
+static void rect_buffer_clear (RectBuffer *buf)
+{
+	g_array_unref(buf->x);
+	g_array_unref(buf->y);
+	g_array_unref(buf->width);
+	g_array_unref(buf->height);
+}
+
+/* Keeps the views that were there already */
+static GriverRects rect_buffer_resize (RectBuffer *buf, guint len)
+{
+	g_array_set_size(buf->x, len);
+	g_array_set_size(buf->y, len);
+	g_array_set_size(buf->width, len);
+	g_array_set_size(buf->height, len);
+
+	return (GriverRects) {
+		.x = (uint32_t *) buf->x->data,
+		.y = (uint32_t *) buf->y->data,
+		.width = (uint32_t *) buf->width->data,
+		.height = (uint32_t *) buf->height->data,
+	};
+}
+
+static guint cache_key_hash (gconstpointer data)
+{
+	const LayoutCacheKey *key = data;
+	guint hash = key->tags;
+
+	hash = hash * 31 + key->view_count;
+	hash = hash * 31 + key->width;
+	hash = hash * 31 + key->height;
+	return hash ^ (guint) key->params_hash ^ (guint) (key->params_hash >> 32);
+}
+
+static gboolean cache_key_equal (gconstpointer a, gconstpointer b)
+{
+	const LayoutCacheKey *ka = a;
+	const LayoutCacheKey *kb = b;
+
+	return ka->tags == kb->tags && ka->view_count == kb->view_count &&
+		ka->width == kb->width && ka->height == kb->height &&
+		ka->params_hash == kb->params_hash;
+}
+
+static void cache_entry_free (gpointer data)
+{
+	LayoutCacheEntry *entry = data;
+
+	g_free(entry->layout_name);
+	g_array_unref(entry->dimensions);
+	g_free(entry);
+}
 
 static void output_finalize (GObject *object) {
 	GriverOutput *output = GRIVER_OUTPUT(object);
 	GriverOutputPrivate *priv = g_river_output_get_instance_private(output);
 
+	if ( priv->demand_notify != NULL )
+		priv->demand_notify(priv->demand_data);
+	g_hash_table_destroy(priv->layout_cache);
+	g_hash_table_destroy(priv->layout_params);
+	g_array_unref(priv->recording);
+	g_array_unref(priv->view_tags);
+	for (int i = 0; i < GRIVER_TAG_COUNT; i++) {
+		rect_buffer_clear(&priv->geometry[i].rects);
+		g_clear_pointer(&priv->tag_specs[i], g_river_layout_spec_unref);
+	}
+	rect_buffer_clear(&priv->rects);
+	rect_buffer_clear(&priv->speculation.rects);
+	g_clear_pointer(&priv->state_file, griver_state_file_unref);
+	g_free(priv->name);
+	g_clear_pointer(&priv->speculation.spec, g_river_layout_spec_unref);
+	g_clear_pointer(&priv->session, griver_session_unref);
+	g_array_unref(priv->pushed);
+	g_array_unref(priv->committed);
+	g_free(priv->committed_name);
+	if ( priv->commands != NULL )
+		g_hash_table_unref(priv->commands);
+
+	/* the wl_output belongs to the connection */
 	if ( priv->layout != NULL )
 		river_layout_v3_destroy(priv->layout);
-	wl_output_destroy(priv->output);
+
+	G_OBJECT_CLASS(g_river_output_parent_class)->finalize(object);
 }
 
 static void g_river_output_init(GriverOutput *output) {
@@ -58,6 +294,92 @@ static void g_river_output_init(GriverOutput *output) {
 	
 	priv->cmd_tags = 0;
 
+	priv->demand_view_count = 0;
+	priv->demand_width = 0;
+	priv->demand_height = 0;
+	priv->demand_tags = 0;
+	priv->demand_serial = 0;
+	priv->demand_time = 0;
+	priv->demand_answered = true;
+	priv->latest_serial = 0;
+
+	priv->tag_states = priv->own_tag_states;
+	priv->state_file = NULL;
+	priv->name = NULL;
+	for (int i = 0; i < GRIVER_TAG_COUNT; i++) {
+		g_river_tag_state_reset(&priv->tag_states[i]);
+		priv->tag_specs[i] = NULL;
+	}
+	priv->commands = NULL;
+
+	priv->demand_func = NULL;
+	priv->demand_data = NULL;
+	priv->demand_notify = NULL;
+
+	priv->coalesce = false;
+	priv->has_pending = false;
+	griver_counters_reset(&priv->counters);
+
+	priv->focused_tags = 0;
+	priv->urgent_tags = 0;
+	priv->occupied_tags = 0;
+	priv->view_tags = g_array_new(false, false, sizeof(uint32_t));
+	priv->focused = false;
+
+	priv->cache_enabled = false;
+	priv->replaying = false;
+	priv->layout_cache = g_hash_table_new_full(cache_key_hash, cache_key_equal,
+			NULL, cache_entry_free);
+	priv->layout_params = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+			NULL, g_free);
+	priv->recording = g_array_new(false, false, sizeof(uint32_t));
+
+	rect_buffer_init(&priv->rects);
+	priv->incremental = false;
+	for (int i = 0; i < GRIVER_TAG_COUNT; i++) {
+		priv->geometry[i].valid = false;
+		rect_buffer_init(&priv->geometry[i].rects);
+	}
+
+	priv->speculative = false;
+	priv->speculation.valid = false;
+	priv->speculation.spec = NULL;
+	rect_buffer_init(&priv->speculation.rects);
+
+	priv->session = NULL;
+	priv->pushed = g_array_new(false, false, sizeof(uint32_t));
+	priv->committed = g_array_new(false, false, sizeof(uint32_t));
+	priv->committed_name = NULL;
+	priv->committed_serial = 0;
+	priv->has_committed = false;
+}
+
+static void output_get_property (GObject *object, guint property_id,
+		GValue *value, GParamSpec *pspec)
+{
+	GriverOutput *output = GRIVER_OUTPUT(object);
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(output);
+
+	switch (property_id) {
+		case PROP_FOCUSED_TAGS:
+			g_value_set_uint(value, priv->focused_tags);
+			break;
+		case PROP_URGENT_TAGS:
+			g_value_set_uint(value, priv->urgent_tags);
+			break;
+		case PROP_OCCUPIED_TAGS:
+			g_value_set_uint(value, priv->occupied_tags);
+			break;
+		case PROP_VIEW_COUNT:
+			g_value_set_uint(value, priv->view_tags->len);
+			break;
+		case PROP_FOCUSED:
+			g_value_set_boolean(value, priv->focused);
+			break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+			break;
+	}
 }
 
 	//River wants us to arrange views.
@@ -65,8 +387,12 @@ static void g_river_output_class_init(GriverOutputClass *klass)
 {
 	GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
 	gobject_class->finalize = output_finalize;
+	gobject_class->get_property = output_get_property;
 	klass->push_view_dimensions = push_view_dimensions;
 	klass->commit_dimensions = commit_dimensions;
+	klass->push_view_dimensions_array = push_view_dimensions_array;
+	klass->command = command;
+	klass->layout_demand = layout_demand;
 
 	/**
 	 * GriverOutput::layout-demand:
@@ -79,11 +405,16 @@ static void g_river_output_class_init(GriverOutputClass *klass)
 	 *
 	 * River wants us to arrange views.
 	 *
+	 * When nothing is connected to the signal, the class handler is called
+	 * directly without emitting it. From C, prefer
+	 * g_river_output_set_layout_demand_func() or overriding the
+	 * layout_demand vfunc, which skip the marshalling of the arguments.
+	 *
 	 **/
 	griver_signals[GRIVER_LAYOUT_DEMAND] = g_signal_new ("layout-demand",
 			G_TYPE_FROM_CLASS (klass),
 			G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
-			0,
+			G_STRUCT_OFFSET (GriverOutputClass, layout_demand),
 			NULL,
 			NULL,
 			NULL,
@@ -116,6 +447,291 @@ static void g_river_output_class_init(GriverOutputClass *klass)
 			2,
 			G_TYPE_STRING,
 			G_TYPE_UINT);
+
+	/**
+	 * GriverOutput::command:
+	 * @out: The [class@Griver.GriverOutput] instance.
+	 * @cmd: The parsed command.
+	 * @tags: Tags are effected by the command.
+	 *
+	 * A user ran a command registered with
+	 * g_river_context_register_command(). The command has already been
+	 * parsed, connect to "command::main-ratio" to only get one command.
+	 * Registered commands are not emitted as #GriverOutput::user-command.
+	 *
+	 * The default handler applies the commands registered with
+	 * g_river_context_register_tag_commands() to the tag state.
+	 *
+	 **/
+	griver_signals[GRIVER_COMMAND] = g_signal_new ("command",
+			G_TYPE_FROM_CLASS (klass),
+			G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS | G_SIGNAL_DETAILED,
+			G_STRUCT_OFFSET (GriverOutputClass, command),
+			NULL,
+			NULL,
+			NULL,
+			G_TYPE_NONE,
+			2,
+			GRIVER_TYPE_COMMAND | G_SIGNAL_TYPE_STATIC_SCOPE,
+			G_TYPE_UINT);
+
+	/**
+	 * GriverOutput:focused-tags:
+	 *
+	 * The tags focused on the output, as reported by river-status. Stays 0
+	 * if the compositor doesn't support river-status.
+	 **/
+	griver_properties[PROP_FOCUSED_TAGS] = g_param_spec_uint("focused-tags",
+			"Focused tags", "The tags focused on the output",
+			0, G_MAXUINT32, 0,
+			G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+	/**
+	 * GriverOutput:urgent-tags:
+	 *
+	 * The tags of the output with an urgent view.
+	 **/
+	griver_properties[PROP_URGENT_TAGS] = g_param_spec_uint("urgent-tags",
+			"Urgent tags", "The tags of the output with an urgent view",
+			0, G_MAXUINT32, 0,
+			G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+	/**
+	 * GriverOutput:occupied-tags:
+	 *
+	 * The tags of the output with at least one view, see
+	 * g_river_output_get_view_tags() for the tags of every view.
+	 **/
+	griver_properties[PROP_OCCUPIED_TAGS] = g_param_spec_uint("occupied-tags",
+			"Occupied tags", "The tags of the output with at least one view",
+			0, G_MAXUINT32, 0,
+			G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+	/**
+	 * GriverOutput:view-count:
+	 *
+	 * The number of views on the output, on any tag.
+	 **/
+	griver_properties[PROP_VIEW_COUNT] = g_param_spec_uint("view-count",
+			"View count", "The number of views on the output",
+			0, G_MAXUINT, 0,
+			G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+	/**
+	 * GriverOutput:focused:
+	 *
+	 * Whether the output has the focus of the seat.
+	 **/
+	griver_properties[PROP_FOCUSED] = g_param_spec_boolean("focused",
+			"Focused", "Whether the output has the focus of the seat",
+			FALSE,
+			G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+	g_object_class_install_properties(gobject_class, N_PROPERTIES,
+			griver_properties);
+}
+
+static void apply_uint (uint32_t *field, const GriverCommand *cmd)
+{
+	gint64 value = cmd->int_value;
+	if (cmd->relative) {
+		value += *field;
+	}
+	*field = (uint32_t) CLAMP(value, 0, G_MAXUINT32);
+}
+
+/* The default handler for the command signal, applies the builtin tag
+ * commands */
+static void command (GriverOutput *out, const GriverCommand *cmd, uint32_t tags)
+{
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+	const GriverCommandSpec *spec;
+
+	if (priv->commands == NULL) {
+		return;
+	}
+	spec = g_hash_table_lookup(priv->commands, cmd->name);
+	if (spec == NULL || spec->builtin == GRIVER_BUILTIN_NONE) {
+		return;
+	}
+
+	GriverTagState *state = g_river_output_get_tag_state(out, tags);
+
+	switch (spec->builtin) {
+		case GRIVER_BUILTIN_NONE:
+			return;
+		case GRIVER_BUILTIN_MAIN_COUNT:
+			apply_uint(&state->main_count, cmd);
+			break;
+		case GRIVER_BUILTIN_VIEW_PADDING:
+			apply_uint(&state->view_padding, cmd);
+			break;
+		case GRIVER_BUILTIN_OUTER_PADDING:
+			apply_uint(&state->outer_padding, cmd);
+			break;
+		case GRIVER_BUILTIN_MAIN_RATIO: {
+			double ratio = cmd->float_value;
+			if (cmd->relative) {
+				ratio += state->ratio;
+			}
+			state->ratio = CLAMP(ratio, 0.1, 0.9);
+			break;
+		}
+		case GRIVER_BUILTIN_MAIN_LOCATION:
+			state->rotation = (GriverRotation) cmd->enum_value;
+			break;
+		case GRIVER_BUILTIN_LAYOUT:
+			state->layout = (GriverLayout) cmd->enum_value;
+			g_river_output_set_tag_layout_spec(out, tags, NULL);
+			break;
+		case GRIVER_BUILTIN_RESET:
+			g_river_tag_state_reset(state);
+			g_river_output_set_tag_layout_spec(out, tags, NULL);
+			break;
+		case GRIVER_BUILTIN_RELOAD: {
+			GriverLayoutSpec *layout_spec = g_river_output_get_tag_layout_spec(out, tags);
+			GError *error = NULL;
+			if (layout_spec != NULL && !g_river_layout_spec_reload(layout_spec, &error)) {
+				g_warning("%s", error->message);
+				g_error_free(error);
+			}
+			break;
+		}
+	}
+
+	g_river_output_invalidate_layout_cache(out, tags);
+}
+
+/* Called for every commit sent to river */
+static void count_commit (GriverOutputPrivate *priv, uint32_t serial)
+{
+	priv->counters.commits++;
+	GRIVER_TRACE_INSTANT("commit", "river", NULL, "serial", serial, NULL, 0);
+	if (serial != priv->latest_serial) {
+		priv->counters.stale++;
+	}
+	if (serial == priv->demand_serial && !priv->demand_answered) {
+		priv->demand_answered = true;
+		/* from the demand coming in to its answer going out */
+		GRIVER_TRACE_SPAN("demand", "latency", priv->demand_time,
+				"serial", serial, "views", priv->demand_view_count);
+		griver_counters_add_latency(&priv->counters,
+				g_get_monotonic_time() - priv->demand_time);
+	}
+}
+
+static bool should_record (GriverOutputPrivate *priv, uint32_t serial)
+{
+	return priv->cache_enabled && !priv->replaying &&
+		serial == priv->demand_serial;
+}
+
+static bool capturing (GriverOutputPrivate *priv)
+{
+	return priv->session != NULL || priv->layout == NULL;
+}
+
+/* The pushed dimensions become the last commit */
+static void capture_commit (GriverOutput *out, const char *layout_name,
+		uint32_t serial)
+{
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+	GArray *committed = priv->committed;
+
+	priv->committed = priv->pushed;
+	priv->pushed = committed;
+	g_array_set_size(priv->pushed, 0);
+	g_free(priv->committed_name);
+	priv->committed_name = g_strdup(layout_name);
+	priv->committed_serial = serial;
+	priv->has_committed = true;
+
+	if (priv->session != NULL) {
+		GriverRecord record = {
+			.type = GRIVER_RECORD_COMMIT,
+			.uid = priv->uid,
+			.serial = serial,
+			.text = layout_name,
+			.dimensions = (const uint32_t *) priv->committed->data,
+			.n_dimensions = priv->committed->len,
+		};
+		griver_session_write(priv->session, &record);
+	}
+}
+
+/* A reloaded plugin lays out differently, so cached layouts made by the
+ * old one are no good */
+static guint spec_generation (GriverOutputPrivate *priv, uint32_t tags)
+{
+	GriverLayoutSpec *spec = priv->tag_specs[tags ? __builtin_ctz(tags) : 0];
+
+	return spec != NULL ? griver_layout_spec_get_generation(spec) : 0;
+}
+
+/* The key for a demand with the parameters its tags use now */
+static LayoutCacheKey cache_key (GriverOutputPrivate *priv, uint32_t view_count,
+		uint32_t width, uint32_t height, uint32_t tags)
+{
+	guint64 *params_hash = g_hash_table_lookup(priv->layout_params,
+			GUINT_TO_POINTER(tags));
+
+	return (LayoutCacheKey) {
+		.tags = tags,
+		.view_count = view_count,
+		.width = width,
+		.height = height,
+		.params_hash = params_hash != NULL ? *params_hash : 0,
+	};
+}
+
+static LayoutCacheEntry *cache_entry_get (GriverOutputPrivate *priv)
+{
+	LayoutCacheKey key = cache_key(priv, priv->demand_view_count,
+			priv->demand_width, priv->demand_height, priv->demand_tags);
+	LayoutCacheEntry *entry = g_hash_table_lookup(priv->layout_cache, &key);
+	if (entry == NULL) {
+		if (g_hash_table_size(priv->layout_cache) >= LAYOUT_CACHE_MAX) {
+			g_hash_table_remove_all(priv->layout_cache);
+		}
+		entry = g_new0(LayoutCacheEntry, 1);
+		entry->key = key;
+		entry->dimensions = g_array_new(false, false, sizeof(uint32_t));
+		g_hash_table_insert(priv->layout_cache, &entry->key, entry);
+	}
+	return entry;
+}
+
+/* Remember what we committed for the current demand, so we can replay it
+ * the next time the same demand comes in */
+static void cache_store (GriverOutputPrivate *priv, const char *layout_name)
+{
+	if (priv->recording->len != priv->demand_view_count * 4) {
+		return;
+	}
+
+	LayoutCacheEntry *entry = cache_entry_get(priv);
+	entry->valid = true;
+	entry->spec_generation = spec_generation(priv, priv->demand_tags);
+
+	g_free(entry->layout_name);
+	entry->layout_name = g_strdup(layout_name);
+
+	g_array_set_size(entry->dimensions, 0);
+	g_array_append_vals(entry->dimensions, priv->recording->data,
+			priv->recording->len);
+}
+
+static LayoutCacheEntry *cache_lookup (GriverOutputPrivate *priv, uint32_t view_count,
+		uint32_t width, uint32_t height, uint32_t tags)
+{
+	LayoutCacheKey key = cache_key(priv, view_count, width, height, tags);
+	LayoutCacheEntry *entry = g_hash_table_lookup(priv->layout_cache, &key);
+
+	if (entry == NULL || !entry->valid ||
+			entry->spec_generation != spec_generation(priv, tags)) {
+		return NULL;
+	}
+	return entry;
 }
 
 static void push_view_dimensions (GriverOutput *out, 
@@ -124,14 +740,67 @@ static void push_view_dimensions (GriverOutput *out,
 {
 	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
 
-	river_layout_v3_push_view_dimensions(priv->layout, x, y,  width, height,
-			serial);
+	if (should_record(priv, serial)) {
+		uint32_t dims[4] = { x, y, width, height };
+		g_array_append_vals(priv->recording, dims, 4);
+	}
+
+	if (capturing(priv)) {
+		uint32_t dims[4] = { x, y, width, height };
+		g_array_append_vals(priv->pushed, dims, 4);
+	}
+
+	GRIVER_TRACE_INSTANT("push", "river", NULL, "serial", serial, NULL, 0);
+	if (priv->layout != NULL) {
+		river_layout_v3_push_view_dimensions(priv->layout, x, y,  width, height,
+				serial);
+	}
 }
 
 static void commit_dimensions (GriverOutput *out, const char *layout_name, uint32_t serial)
 {
 	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
-	river_layout_v3_commit(priv->layout, layout_name, serial);
+
+	if (should_record(priv, serial)) {
+		cache_store(priv, layout_name);
+	}
+	if (capturing(priv)) {
+		capture_commit(out, layout_name, serial);
+	}
+
+	if (priv->layout != NULL) {
+		river_layout_v3_commit(priv->layout, layout_name, serial);
+	}
+	count_commit(priv, serial);
+}
+
+static void push_view_dimensions_array (GriverOutput *out,
+			const uint32_t *dimensions, guint n_dimensions,
+			const char *layout_name, uint32_t serial)
+{
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	if (should_record(priv, serial)) {
+		g_array_append_vals(priv->recording, dimensions, n_dimensions);
+		cache_store(priv, layout_name);
+	}
+
+	if (capturing(priv)) {
+		g_array_append_vals(priv->pushed, dimensions, n_dimensions);
+		capture_commit(out, layout_name, serial);
+	}
+
+	if (priv->layout != NULL) {
+		for (guint i = 0; i + 3 < n_dimensions; i += 4) {
+			GRIVER_TRACE_INSTANT("push", "river", NULL, "serial", serial, NULL, 0);
+			river_layout_v3_push_view_dimensions(priv->layout,
+					dimensions[i], dimensions[i + 1],
+					dimensions[i + 2], dimensions[i + 3],
+					serial);
+		}
+		river_layout_v3_commit(priv->layout, layout_name, serial);
+	}
+	count_commit(priv, serial);
 }
 
 /**
@@ -173,58 +842,718 @@ g_river_output_commit_dimensions (GriverOutput *out, const char *layout_name, ui
 			out, layout_name, serial);
 }
 
+/**
+ * g_river_output_push_view_dimensions_array:
+ * @out: A #GriverOut to push dimensions.
+ * @dimensions: (array length=n_dimensions): Packed view dimensions, four
+ *   values (x, y, width, height) per view, in view order.
+ * @n_dimensions: Number of elements in @dimensions, four times the number of views.
+ * @layout_name: What we call the layout, for example "[]="
+ * @serial: A serial used to identify the roundtrip.
+ *
+ * Push the dimensions of every view and commit them in one go.
+ * This is the same as calling g_river_output_push_view_dimensions() for
+ * each view followed by g_river_output_commit_dimensions(), but bindings
+ * only have to marshal a single call for the whole layout.
+ *
+ **/
+void
+g_river_output_push_view_dimensions_array (GriverOutput *out,
+			const uint32_t *dimensions, guint n_dimensions,
+			const char *layout_name, uint32_t serial)
+{
+	g_return_if_fail(GRIVER_IS_OUTPUT(out));
+	g_return_if_fail(n_dimensions % 4 == 0);
+	g_return_if_fail(dimensions != NULL || n_dimensions == 0);
+
+	GRIVER_OUTPUT_GET_CLASS(out)->push_view_dimensions_array(
+			out, dimensions, n_dimensions, layout_name, serial);
+}
+
 static void layout_handle_namespace_in_use (void *data, struct river_layout_v3 *river_layout_v3)
 {
 	fprintf(stderr, "Namespace already in use");
 	exit(EXIT_FAILURE);
 }
 
-static void layout_handle_layout_demand (void *data, struct river_layout_v3 *river_layout_v3,
-		uint32_t view_count, uint32_t width, uint32_t height, uint32_t tags, uint32_t serial)
+/* The demand func set by g_river_output_arrange_on_demand() */
+static void arrange_demand (GriverOutput *out, uint32_t view_count, uint32_t width,
+		uint32_t height, uint32_t tags, uint32_t serial, gpointer user_data)
 {
-	g_return_if_fail(GRIVER_IS_OUTPUT(data));
-	GriverOutput *output = GRIVER_OUTPUT(data);
-	g_object_ref(output);
-
-	g_signal_emit (output, griver_signals[GRIVER_LAYOUT_DEMAND], 0,
-			view_count, width, height, tags, serial);
+	g_river_output_arrange(out, view_count, width, height, tags, serial);
 }
 
-static void layout_handle_user_command (void *data, 
-		struct river_layout_v3 *river_layout_manager_v3, const char *command)
+/* Whether nothing but g_river_output_arrange() answers the demands, only
+ * then can a speculated layout stand in for them */
+static bool arranges_only (GriverOutput *out)
 {
-	GriverOutput *output = GRIVER_OUTPUT(data);
-	GriverOutputPrivate *priv = g_river_output_get_instance_private(output);
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
 
-	g_signal_emit (output, griver_signals[GRIVER_USER_COMMAND], 0, command, priv->cmd_tags);
+	return priv->demand_func == arrange_demand &&
+		GRIVER_OUTPUT_GET_CLASS(out)->layout_demand == layout_demand &&
+		!g_signal_has_handler_pending(out, griver_signals[GRIVER_LAYOUT_DEMAND],
+				0, true);
 }
 
-void layout_handle_command_tags(void *data,
-		struct river_layout_v3 *river_layout_v3,
-		uint32_t tags)
+static void handle_demand (GriverOutput *output, uint32_t view_count, uint32_t width,
+		uint32_t height, uint32_t tags, uint32_t serial, gint64 received)
 {
-	GriverOutput *output = GRIVER_OUTPUT(data);
 	GriverOutputPrivate *priv = g_river_output_get_instance_private(output);
-	priv->cmd_tags = tags;
-}
+	gint64 start = GRIVER_TRACE_BEGIN();
 
-static const struct river_layout_v3_listener layout_listener = {
-	.namespace_in_use = layout_handle_namespace_in_use,
-	.layout_demand    = layout_handle_layout_demand,
-	.user_command     = layout_handle_user_command,
-	.user_command_tags = layout_handle_command_tags,
-};
+	priv->demand_view_count = view_count;
+	priv->demand_width = width;
+	priv->demand_height = height;
+	priv->demand_tags = tags;
+	priv->demand_serial = serial;
+	priv->demand_time = received;
+	priv->demand_answered = false;
+	g_array_set_size(priv->recording, 0);
 
-uint32_t g_river_output_get_uid(GriverOutput *out)
-{
-	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
-	
-	return priv->uid;
-}
+	if (priv->speculative && arranges_only(output) &&
+			answer_speculation(output, view_count, width, height, tags, serial)) {
+		GRIVER_TRACE_SPAN("speculated", "demand", start, "serial", serial,
+				"views", view_count);
+		return;
+	}
 
-void g_river_output_configure (GriverOutput *out, struct river_layout_manager_v3 *layout_manager,
-		const char *namespace)
-{
+	if (priv->cache_enabled) {
+		LayoutCacheEntry *entry = cache_lookup(priv, view_count, width, height, tags);
+		if (entry != NULL) {
+			priv->replaying = true;
+			GRIVER_OUTPUT_GET_CLASS(output)->push_view_dimensions_array(output,
+					(const uint32_t *) entry->dimensions->data,
+					entry->dimensions->len, entry->layout_name, serial);
+			priv->replaying = false;
+			GRIVER_TRACE_SPAN("cached", "demand", start, "serial", serial,
+					"views", view_count);
+			return;
+		}
+	}
+
+	/* the signal is only worth its marshalling when someone listens */
+	g_object_ref(output);
+	if (g_signal_has_handler_pending(output, griver_signals[GRIVER_LAYOUT_DEMAND],
+				0, true)) {
+		gint64 emit_start = GRIVER_TRACE_BEGIN();
+		g_signal_emit (output, griver_signals[GRIVER_LAYOUT_DEMAND], 0,
+				view_count, width, height, tags, serial);
+		GRIVER_TRACE_SPAN("layout-demand", "signal", emit_start,
+				"serial", serial, NULL, 0);
+	} else {
+		GRIVER_OUTPUT_GET_CLASS(output)->layout_demand(output, view_count,
+				width, height, tags, serial);
+	}
+	g_object_unref(output);
+	GRIVER_TRACE_SPAN("handle_demand", "demand", start, "serial", serial,
+			"views", view_count);
+}
+
+static void layout_demand (GriverOutput *out, uint32_t view_count, uint32_t width,
+		uint32_t height, uint32_t tags, uint32_t serial)
+{
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	if (priv->demand_func != NULL) {
+		priv->demand_func(out, view_count, width, height, tags, serial,
+				priv->demand_data);
+	}
+}
+
+static void layout_handle_layout_demand (void *data, struct river_layout_v3 *river_layout_v3,
+		uint32_t view_count, uint32_t width, uint32_t height, uint32_t tags, uint32_t serial)
+{
+	g_return_if_fail(GRIVER_IS_OUTPUT(data));
+	GriverOutput *output = GRIVER_OUTPUT(data);
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(output);
+	gint64 received = g_get_monotonic_time();
+
+	priv->counters.demands++;
+	priv->latest_serial = serial;
+	GRIVER_TRACE_INSTANT("layout_demand", "river", NULL, "serial", serial,
+			"views", view_count);
+	if (priv->session != NULL) {
+		GriverRecord record = {
+			.type = GRIVER_RECORD_DEMAND,
+			.uid = priv->uid,
+			.view_count = view_count,
+			.width = width,
+			.height = height,
+			.tags = tags,
+			.serial = serial,
+		};
+		griver_session_write(priv->session, &record);
+	}
+
+	if (!priv->coalesce) {
+		handle_demand(output, view_count, width, height, tags, serial, received);
+		return;
+	}
+
+	/* River only cares about the answer to the newest demand, so hold on to
+	 * it until every queued event has been dispatched, see
+	 * griver_output_flush_demand() */
+	if (priv->has_pending) {
+		priv->counters.skipped++;
+	}
+	priv->has_pending = true;
+	priv->pending_view_count = view_count;
+	priv->pending_width = width;
+	priv->pending_height = height;
+	priv->pending_tags = tags;
+	priv->pending_serial = serial;
+	priv->pending_time = received;
+}
+
+void griver_output_flush_demand (GriverOutput *out)
+{
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	if (!priv->has_pending) {
+		return;
+	}
+	priv->has_pending = false;
+	handle_demand(out, priv->pending_view_count, priv->pending_width,
+			priv->pending_height, priv->pending_tags, priv->pending_serial,
+			priv->pending_time);
+}
+
+void griver_output_set_coalesce (GriverOutput *out, gboolean coalesce)
+{
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	priv->coalesce = coalesce;
+	if (!coalesce) {
+		griver_output_flush_demand(out);
+	}
+}
+
+static void layout_handle_user_command (void *data, 
+		struct river_layout_v3 *river_layout_manager_v3, const char *command)
+{
+	GriverOutput *output = GRIVER_OUTPUT(data);
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(output);
+	GriverCommand cmd;
+
+	priv->counters.commands++;
+	GRIVER_TRACE_INSTANT("user_command", "river", command, "tags",
+			priv->cmd_tags, NULL, 0);
+	if (priv->session != NULL) {
+		GriverRecord record = {
+			.type = GRIVER_RECORD_COMMAND,
+			.uid = priv->uid,
+			.tags = priv->cmd_tags,
+			.text = command,
+		};
+		griver_session_write(priv->session, &record);
+	}
+	gint64 start = GRIVER_TRACE_BEGIN();
+	const GriverCommandSpec *spec = griver_command_parse(priv->commands, command, &cmd);
+	if (spec != NULL) {
+		g_signal_emit (output, griver_signals[GRIVER_COMMAND], spec->detail,
+				&cmd, priv->cmd_tags);
+		GRIVER_TRACE_SPAN("command", "signal", start, "tags", priv->cmd_tags,
+				NULL, 0);
+		return;
+	}
+
+	g_signal_emit (output, griver_signals[GRIVER_USER_COMMAND], 0, command, priv->cmd_tags);
+	GRIVER_TRACE_SPAN("user-command", "signal", start, "tags", priv->cmd_tags,
+			NULL, 0);
+}
+
+void layout_handle_command_tags(void *data,
+		struct river_layout_v3 *river_layout_v3,
+		uint32_t tags)
+{
+	GriverOutput *output = GRIVER_OUTPUT(data);
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(output);
+	priv->cmd_tags = tags;
+}
+
+static const struct river_layout_v3_listener layout_listener = {
+	.namespace_in_use = layout_handle_namespace_in_use,
+	.layout_demand    = layout_handle_layout_demand,
+	.user_command     = layout_handle_user_command,
+	.user_command_tags = layout_handle_command_tags,
+};
+
+void griver_output_replay_demand (GriverOutput *out, uint32_t view_count,
+		uint32_t width, uint32_t height, uint32_t tags, uint32_t serial)
+{
+	layout_handle_layout_demand(out, NULL, view_count, width, height, tags,
+			serial);
+	griver_output_flush_demand(out);
+}
+
+void griver_output_replay_command (GriverOutput *out, uint32_t tags,
+		const char *command)
+{
+	layout_handle_command_tags(out, NULL, tags);
+	layout_handle_user_command(out, NULL, command);
+}
+
+void griver_output_set_session (GriverOutput *out, GriverSession *session)
+{
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	if (session != NULL) {
+		griver_session_ref(session);
+	}
+	g_clear_pointer(&priv->session, griver_session_unref);
+	priv->session = session;
+	g_array_set_size(priv->pushed, 0);
+}
+
+bool griver_output_get_last_commit (GriverOutput *out, uint32_t *serial,
+		const char **layout_name, const uint32_t **dimensions,
+		guint *n_dimensions)
+{
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	if (!priv->has_committed) {
+		return false;
+	}
+	*serial = priv->committed_serial;
+	*layout_name = priv->committed_name;
+	*dimensions = (const uint32_t *) priv->committed->data;
+	*n_dimensions = priv->committed->len;
+	return true;
+}
+
+/**
+ * g_river_output_set_layout_demand_func:
+ * @out: A #GriverOutput
+ * @func: (nullable) (scope notified) (closure user_data) (destroy notify): The
+ *   function to call for every layout demand, or %NULL to remove it
+ * @user_data: Data passed to @func
+ * @notify: (nullable): Frees @user_data when @func is replaced or the
+ *   output goes away
+ *
+ * Handle the layout demands of the output with a plain function. It is
+ * called by the default handler of #GriverOutput::layout-demand, after
+ * the connected handlers if there are any, or directly when there are
+ * none, so the arguments don't have to go through GValues.
+ *
+ **/
+void g_river_output_set_layout_demand_func(GriverOutput *out,
+		GriverLayoutDemandFunc func, gpointer user_data, GDestroyNotify notify)
+{
+	g_return_if_fail(GRIVER_IS_OUTPUT(out));
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	if (priv->demand_notify != NULL) {
+		priv->demand_notify(priv->demand_data);
+	}
+	priv->demand_func = func;
+	priv->demand_data = user_data;
+	priv->demand_notify = notify;
+}
+
+/**
+ * g_river_output_arrange_on_demand:
+ * @out: A #GriverOutput
+ *
+ * Answer every layout demand with g_river_output_arrange(), without
+ * calling back into your code. This is the same as a layout demand func
+ * that only calls g_river_output_arrange(), except that griver knows no
+ * other code runs, which g_river_output_set_speculative_layout() needs.
+ *
+ **/
+void g_river_output_arrange_on_demand(GriverOutput *out)
+{
+	g_river_output_set_layout_demand_func(out, arrange_demand, NULL, NULL);
+}
+
+/**
+ * g_river_output_set_layout_cache:
+ * @out: A #GriverOutput
+ * @enable: Whether to cache committed layouts
+ *
+ * When enabled, the output remembers the layout committed for each view
+ * count, width, height and set of tags it was demanded for. If river
+ * demands one of them again, the layout is replayed and committed
+ * directly, without emitting #GriverOutput::layout-demand.
+ *
+ * The cache knows nothing about your layout parameters, so whenever a
+ * command changes them you need to call
+ * g_river_output_invalidate_layout_cache() or
+ * g_river_output_set_layout_params_hash().
+ *
+ **/
+void g_river_output_set_layout_cache(GriverOutput *out, gboolean enable)
+{
+	g_return_if_fail(GRIVER_IS_OUTPUT(out));
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	priv->cache_enabled = enable;
+	if (!enable) {
+		g_hash_table_remove_all(priv->layout_cache);
+	}
+}
+
+/**
+ * g_river_output_set_layout_params_hash:
+ * @out: A #GriverOutput
+ * @tags: The tags the parameters belong to.
+ * @params_hash: A hash of the layout parameters used for @tags.
+ *
+ * Tell the cache which parameters the layout for @tags is computed with.
+ * Layouts are cached per @tags and @params_hash, so switching back to
+ * parameters used before finds the layout made with them again.
+ *
+ **/
+void g_river_output_set_layout_params_hash(GriverOutput *out, uint32_t tags,
+		guint64 params_hash)
+{
+	g_return_if_fail(GRIVER_IS_OUTPUT(out));
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	guint64 *current = g_hash_table_lookup(priv->layout_params,
+			GUINT_TO_POINTER(tags));
+	if (current == NULL) {
+		current = g_new(guint64, 1);
+		g_hash_table_insert(priv->layout_params, GUINT_TO_POINTER(tags), current);
+	}
+	*current = params_hash;
+}
+
+/**
+ * g_river_output_invalidate_layout_cache:
+ * @out: A #GriverOutput
+ * @tags: Tags to invalidate, every cached layout sharing a tag with @tags
+ *   is dropped.
+ *
+ * Drop cached layouts, call this when a user command changes the layout
+ * parameters. Use 0xffffffff to drop everything.
+ *
+ **/
+void g_river_output_invalidate_layout_cache(GriverOutput *out, uint32_t tags)
+{
+	g_return_if_fail(GRIVER_IS_OUTPUT(out));
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	GHashTableIter iter;
+	gpointer key, value;
+
+	g_hash_table_iter_init(&iter, priv->layout_cache);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		LayoutCacheEntry *entry = value;
+		if (tags == G_MAXUINT32 || (entry->key.tags & tags)) {
+			entry->valid = false;
+		}
+	}
+}
+
+void griver_output_set_command_table (GriverOutput *out, GHashTable *commands)
+{
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	if (priv->commands != NULL) {
+		g_hash_table_unref(priv->commands);
+	}
+	priv->commands = commands ? g_hash_table_ref(commands) : NULL;
+}
+
+/**
+ * g_river_output_set_incremental_layout:
+ * @out: A #GriverOutput
+ * @enable: Whether to recompute layouts incrementally
+ *
+ * Keep the last layout computed by g_river_output_layout() (and so
+ * g_river_output_arrange()) for every tag, and when a demand differs from
+ * it only by the number of views, recompute only the views that move, for
+ * example the secondary stack of the tall layout. All views are still
+ * pushed, river needs every one of them.
+ *
+ * Only layouts answering the current demand are computed incrementally.
+ *
+ **/
+void g_river_output_set_incremental_layout(GriverOutput *out, gboolean enable)
+{
+	g_return_if_fail(GRIVER_IS_OUTPUT(out));
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	priv->incremental = enable;
+	if (!enable) {
+		for (int i = 0; i < GRIVER_TAG_COUNT; i++) {
+			priv->geometry[i].valid = false;
+			rect_buffer_resize(&priv->geometry[i].rects, 0);
+		}
+	}
+}
+
+/**
+ * g_river_output_get_stats:
+ * @out: A #GriverOutput
+ *
+ * Get the counters of the output, how many demands and commands it got,
+ * how many layouts were committed and how long it took from a demand to
+ * its commit.
+ *
+ * Returns: (transfer full): a snapshot of the counters
+ **/
+GriverStats *g_river_output_get_stats(GriverOutput *out)
+{
+	g_return_val_if_fail(GRIVER_IS_OUTPUT(out), NULL);
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	return griver_counters_to_stats(&priv->counters);
+}
+
+/**
+ * g_river_output_reset_stats:
+ * @out: A #GriverOutput
+ *
+ * Sets all the counters of the output back to zero.
+ **/
+void g_river_output_reset_stats(GriverOutput *out)
+{
+	g_return_if_fail(GRIVER_IS_OUTPUT(out));
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	griver_counters_reset(&priv->counters);
+}
+
+const GriverCounters *griver_output_get_counters (GriverOutput *out)
+{
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	return &priv->counters;
+}
+
+/**
+ * g_river_output_get_skipped_demands:
+ * @out: A #GriverOutput
+ *
+ * The number of layout demands that were dropped without being
+ * answered because a newer demand for the output arrived at the same time.
+ * See g_river_context_set_coalesce_demands().
+ *
+ * Returns: the number of skipped demands
+ **/
+guint64 g_river_output_get_skipped_demands(GriverOutput *out)
+{
+	g_return_val_if_fail(GRIVER_IS_OUTPUT(out), 0);
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	return priv->counters.skipped;
+}
+
+GriverStatusChange griver_output_set_status (GriverOutput *out,
+		const GriverOutputStatus *status)
+{
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+	GriverStatusChange changed = 0;
+
+	if (priv->focused_tags != status->focused_tags) {
+		priv->focused_tags = status->focused_tags;
+		changed |= GRIVER_STATUS_FOCUSED_TAGS;
+	}
+	if (priv->urgent_tags != status->urgent_tags) {
+		priv->urgent_tags = status->urgent_tags;
+		changed |= GRIVER_STATUS_URGENT_TAGS;
+	}
+	if (priv->focused != status->focused) {
+		priv->focused = status->focused;
+		changed |= GRIVER_STATUS_FOCUSED;
+	}
+
+	GArray *view_tags = status->view_tags;
+	if (priv->view_tags->len != view_tags->len) {
+		changed |= GRIVER_STATUS_VIEW_COUNT;
+	}
+	if (priv->view_tags->len != view_tags->len ||
+			memcmp(priv->view_tags->data, view_tags->data,
+				view_tags->len * sizeof(uint32_t)) != 0) {
+		g_array_set_size(priv->view_tags, view_tags->len);
+		memcpy(priv->view_tags->data, view_tags->data,
+				view_tags->len * sizeof(uint32_t));
+		changed |= GRIVER_STATUS_VIEW_TAGS;
+	}
+	if (priv->occupied_tags != status->occupied_tags) {
+		priv->occupied_tags = status->occupied_tags;
+		changed |= GRIVER_STATUS_OCCUPIED_TAGS;
+	}
+
+	if (priv->speculative && arranges_only(out) &&
+			(changed & (GRIVER_STATUS_FOCUSED_TAGS | GRIVER_STATUS_VIEW_TAGS))) {
+		speculate(out);
+	}
+	return changed;
+}
+
+void griver_output_notify_status (GriverOutput *out, GriverStatusChange changed)
+{
+	GObject *object = G_OBJECT(out);
+
+	if (changed == 0) {
+		return;
+	}
+
+	gint64 start = GRIVER_TRACE_BEGIN();
+	g_object_freeze_notify(object);
+	if (changed & GRIVER_STATUS_FOCUSED_TAGS) {
+		g_object_notify_by_pspec(object, griver_properties[PROP_FOCUSED_TAGS]);
+	}
+	if (changed & GRIVER_STATUS_URGENT_TAGS) {
+		g_object_notify_by_pspec(object, griver_properties[PROP_URGENT_TAGS]);
+	}
+	if (changed & GRIVER_STATUS_OCCUPIED_TAGS) {
+		g_object_notify_by_pspec(object, griver_properties[PROP_OCCUPIED_TAGS]);
+	}
+	if (changed & GRIVER_STATUS_VIEW_COUNT) {
+		g_object_notify_by_pspec(object, griver_properties[PROP_VIEW_COUNT]);
+	}
+	if (changed & GRIVER_STATUS_FOCUSED) {
+		g_object_notify_by_pspec(object, griver_properties[PROP_FOCUSED]);
+	}
+	g_object_thaw_notify(object);
+	GRIVER_TRACE_SPAN("notify", "signal", start, "changed", changed, NULL, 0);
+}
+
+/**
+ * g_river_output_get_focused_tags:
+ * @out: A #GriverOutput
+ *
+ * Returns: the tags focused on the output, see #GriverOutput:focused-tags
+ **/
+uint32_t g_river_output_get_focused_tags(GriverOutput *out)
+{
+	g_return_val_if_fail(GRIVER_IS_OUTPUT(out), 0);
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	return priv->focused_tags;
+}
+
+/**
+ * g_river_output_get_urgent_tags:
+ * @out: A #GriverOutput
+ *
+ * Returns: the tags of the output with an urgent view
+ **/
+uint32_t g_river_output_get_urgent_tags(GriverOutput *out)
+{
+	g_return_val_if_fail(GRIVER_IS_OUTPUT(out), 0);
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	return priv->urgent_tags;
+}
+
+/**
+ * g_river_output_get_occupied_tags:
+ * @out: A #GriverOutput
+ *
+ * Returns: the tags of the output with at least one view
+ **/
+uint32_t g_river_output_get_occupied_tags(GriverOutput *out)
+{
+	g_return_val_if_fail(GRIVER_IS_OUTPUT(out), 0);
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	return priv->occupied_tags;
+}
+
+/**
+ * g_river_output_get_view_tags:
+ * @out: A #GriverOutput
+ * @n_views: (out): The number of views on the output
+ *
+ * The tags of every view on the output, in the order river sent them.
+ * Changes are announced by #GObject::notify for
+ * #GriverOutput:occupied-tags.
+ *
+ * Returns: (array length=n_views) (transfer none): the tags of each view,
+ *   valid until the status of the output changes
+ **/
+const uint32_t *g_river_output_get_view_tags(GriverOutput *out, guint *n_views)
+{
+	g_return_val_if_fail(GRIVER_IS_OUTPUT(out), NULL);
+	g_return_val_if_fail(n_views != NULL, NULL);
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	*n_views = priv->view_tags->len;
+	return (const uint32_t *) priv->view_tags->data;
+}
+
+/**
+ * g_river_output_get_focused:
+ * @out: A #GriverOutput
+ *
+ * Returns: whether the output has the focus of the seat
+ **/
+gboolean g_river_output_get_focused(GriverOutput *out)
+{
+	g_return_val_if_fail(GRIVER_IS_OUTPUT(out), FALSE);
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	return priv->focused;
+}
+
+void griver_output_set_name (GriverOutput *out, const char *name)
+{
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	g_free(priv->name);
+	priv->name = g_strdup(name);
+}
+
+void griver_output_set_tag_storage (GriverOutput *out, GriverStateFile *file,
+		GriverTagState *storage, bool restore)
+{
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+	GriverTagState *target = storage != NULL ? storage : priv->own_tag_states;
+
+	if (target == priv->tag_states) {
+		return;
+	}
+	if (!restore) {
+		memcpy(target, priv->tag_states, sizeof(GriverTagState) * GRIVER_TAG_COUNT);
+	}
+	priv->tag_states = target;
+
+	/* the file has to outlive the states we point into */
+	if (storage != NULL) {
+		griver_state_file_ref(file);
+	}
+	g_clear_pointer(&priv->state_file, griver_state_file_unref);
+	priv->state_file = storage != NULL ? file : NULL;
+
+	priv->speculation.valid = false;
+	for (int i = 0; i < GRIVER_TAG_COUNT; i++) {
+		priv->geometry[i].valid = false;
+	}
+	g_river_output_invalidate_layout_cache(out, G_MAXUINT32);
+}
+
+/**
+ * g_river_output_get_name:
+ * @out: A #GriverOutput
+ *
+ * The name of the output, like "DP-1". River sends it shortly after the
+ * output appears, but before the first layout demand. On the layout
+ * thread or the workers, the name stays valid until the handler returns.
+ *
+ * Returns: (transfer none) (nullable): the name of the output
+ **/
+const char *g_river_output_get_name(GriverOutput *out)
+{
+	g_return_val_if_fail(GRIVER_IS_OUTPUT(out), NULL);
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	return priv->name;
+}
+
+uint32_t g_river_output_get_uid(GriverOutput *out)
+{
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+	
+	return priv->uid;
+}
+
+void g_river_output_configure (GriverOutput *out, struct river_layout_manager_v3 *layout_manager,
+		const char *namespace)
+{
 	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
 	if (!priv->initialized) {
 		priv->initialized = true;
@@ -235,9 +1564,160 @@ void g_river_output_configure (GriverOutput *out, struct river_layout_manager_v3
 	}
 }
 
+/* Only the view count changed since the last layout of these tags */
+static bool geometry_matches (const LayoutGeometry *geometry, GriverLayout layout,
+		uint32_t width, uint32_t height, const GriverLayoutParams *params)
+{
+	return geometry->valid && geometry->layout == layout &&
+		geometry->width == width && geometry->height == height &&
+		geometry->params.main_count == params->main_count &&
+		geometry->params.view_padding == params->view_padding &&
+		geometry->params.outer_padding == params->outer_padding &&
+		geometry->params.ratio == params->ratio &&
+		geometry->params.rotation == params->rotation;
+}
+
+static void push_rects (GriverOutput *out, const RectBuffer *rects, uint32_t serial)
+{
+	const uint32_t *x = (const uint32_t *) rects->x->data;
+	const uint32_t *y = (const uint32_t *) rects->y->data;
+	const uint32_t *width = (const uint32_t *) rects->width->data;
+	const uint32_t *height = (const uint32_t *) rects->height->data;
+
+	for (guint i = 0; i < rects->x->len; i++) {
+		g_river_output_push_view_dimensions(out, x[i], y[i], width[i],
+				height[i], serial);
+	}
+}
+
+/* Compute what g_river_output_arrange() would for the focused tags, with
+ * the size of the last demand. River doesn't count floating views, so
+ * the view count is a guess and checked when the demand comes in */
+static void speculate (GriverOutput *out)
+{
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+	Speculation *speculation = &priv->speculation;
+	uint32_t tags = priv->focused_tags;
+	uint32_t view_count = 0;
+
+	speculation->valid = false;
+	if (tags == 0 || priv->demand_width == 0 || priv->demand_height == 0) {
+		return;
+	}
+	for (guint i = 0; i < priv->view_tags->len; i++) {
+		if (g_array_index(priv->view_tags, uint32_t, i) & tags) {
+			view_count++;
+		}
+	}
+	if (view_count == 0) {
+		return;
+	}
+
+	const GriverTagState *state = g_river_output_get_tag_state(out, tags);
+	GriverLayoutSpec *spec = g_river_output_get_tag_layout_spec(out, tags);
+	GriverLayoutParams params = {
+		.main_count = state->main_count,
+		.view_padding = state->view_padding,
+		.outer_padding = state->outer_padding,
+		.ratio = state->ratio,
+		.rotation = state->rotation,
+	};
+
+	GriverRects rects = rect_buffer_resize(&speculation->rects, view_count);
+	gint64 start = GRIVER_TRACE_BEGIN();
+	if (spec != NULL) {
+		griver_layout_spec_compute_rects(spec, view_count, priv->demand_width,
+				priv->demand_height, &params, &rects);
+	} else {
+		griver_layout_compute_rects(state->layout, view_count,
+				priv->demand_width, priv->demand_height, &params, 0, &rects);
+	}
+	GRIVER_TRACE_SPAN("speculate", "kernel", start, "views", view_count,
+			"tags", tags);
+
+	if (spec != NULL) {
+		g_river_layout_spec_ref(spec);
+	}
+	g_clear_pointer(&speculation->spec, g_river_layout_spec_unref);
+	speculation->spec = spec;
+	speculation->spec_generation = spec != NULL ?
+		griver_layout_spec_get_generation(spec) : 0;
+	speculation->state = *state;
+	speculation->tags = tags;
+	speculation->view_count = view_count;
+	speculation->width = priv->demand_width;
+	speculation->height = priv->demand_height;
+	speculation->valid = true;
+}
+
+/* Commit the speculated layout if the demand is the one we expected and
+ * nothing changed the tag since */
+static bool answer_speculation (GriverOutput *out, uint32_t view_count,
+		uint32_t width, uint32_t height, uint32_t tags, uint32_t serial)
+{
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+	const Speculation *speculation = &priv->speculation;
+
+	if (!speculation->valid || speculation->tags != tags ||
+			speculation->view_count != view_count ||
+			speculation->width != width || speculation->height != height) {
+		return false;
+	}
+
+	const GriverTagState *state = g_river_output_get_tag_state(out, tags);
+	if (g_river_output_get_tag_layout_spec(out, tags) != speculation->spec ||
+			(speculation->spec != NULL && speculation->spec_generation !=
+			 griver_layout_spec_get_generation(speculation->spec)) ||
+			state->main_count != speculation->state.main_count ||
+			state->view_padding != speculation->state.view_padding ||
+			state->outer_padding != speculation->state.outer_padding ||
+			state->ratio != speculation->state.ratio ||
+			state->rotation != speculation->state.rotation ||
+			state->layout != speculation->state.layout) {
+		return false;
+	}
+
+	const char *name = speculation->spec != NULL ?
+		g_river_layout_spec_get_name(speculation->spec) :
+		g_river_layout_get_symbol(speculation->state.layout);
+
+	priv->counters.speculated++;
+	push_rects(out, &speculation->rects, serial);
+	g_river_output_commit_dimensions(out, name, serial);
+	return true;
+}
+
 /**
- * g_river_output_tall_layout:
+ * g_river_output_set_speculative_layout:
+ * @out: A #GriverOutput
+ * @enable: Whether to compute layouts ahead of their demand
+ *
+ * For outputs laid out with g_river_output_arrange_on_demand(). When
+ * river-status reports new focused tags or views, the layout for the
+ * focused tags is computed right away, while river is still getting ready
+ * to send the demand. If the demand matches the guess and the tag state
+ * didn't change in between, the layout is committed right away. Other
+ * demands are handled as usual.
+ *
+ * As long as a #GriverOutput::layout-demand handler is connected or
+ * another layout demand func is set, nothing is speculated, so no code of
+ * yours is ever skipped.
+ *
+ **/
+void g_river_output_set_speculative_layout(GriverOutput *out, gboolean enable)
+{
+	g_return_if_fail(GRIVER_IS_OUTPUT(out));
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	priv->speculative = enable;
+	priv->speculation.valid = false;
+	g_clear_pointer(&priv->speculation.spec, g_river_layout_spec_unref);
+}
+
+/**
+ * g_river_output_layout:
  * @out: A #GriverOut to tile.
+ * @layout: Which layout to use
  * @view_count: number of views
  * @width: width of the usable area
  * @height: height of the usable area
@@ -248,135 +1728,290 @@ void g_river_output_configure (GriverOutput *out, struct river_layout_manager_v3
  * @rotation: Where the master should be.
  * @serial: A serial used to push and commit dimensions
  * 
- * Tiles the output in the classic dwm style but with different rations.
+ * Tiles the output using one of the builtin layouts. Layouts without a
+ * main area ignore @main_count and @ratio.
  * Doesn't call commit.
  *
+ * With g_river_output_set_incremental_layout() only the views that moved
+ * since the last layout of the demanded tags are recomputed.
+ *
  **/
-void g_river_output_tall_layout(GriverOutput *out, uint32_t view_count, uint32_t width,
-		uint32_t height, uint32_t main_count, uint32_t view_padding, uint32_t outer_padding, 
-		double ratio, GriverRotation rotation, uint32_t serial) {
+void g_river_output_layout(GriverOutput *out, GriverLayout layout, uint32_t view_count,
+		uint32_t width, uint32_t height, uint32_t main_count, uint32_t view_padding,
+		uint32_t outer_padding, double ratio, GriverRotation rotation, uint32_t serial)
+{
+	g_return_if_fail(GRIVER_IS_OUTPUT(out));
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
 
 	if (view_count <= 0) {
 		return;
 	}
 
-	uint32_t lmain_count = MIN(main_count, view_count);
-	uint32_t secondary_count = view_count - lmain_count;
+	GriverLayoutParams params = {
+		.main_count = main_count,
+		.view_padding = view_padding,
+		.outer_padding = outer_padding,
+		.ratio = ratio,
+		.rotation = rotation,
+	};
 
-	uint32_t usable_width;
-	switch (rotation) {
-		case GRIVER_LEFT:
-		case GRIVER_RIGHT:
-			usable_width = width - 2 * outer_padding;
-			break;
-		case GRIVER_TOP:
-		case GRIVER_BOTTOM:
-			usable_width = height - 2 * outer_padding;
-			break;
+	if (!priv->incremental || serial != priv->demand_serial) {
+		GriverRects rects = rect_buffer_resize(&priv->rects, view_count);
+		gint64 start = GRIVER_TRACE_BEGIN();
+		griver_layout_compute_rects(layout, view_count, width, height, &params,
+				0, &rects);
+		GRIVER_TRACE_SPAN("layout", "kernel", start, "views", view_count,
+				"first", 0);
+		push_rects(out, &priv->rects, serial);
+		return;
 	}
 
-	uint32_t usable_height;
-	switch (rotation) {
-		case GRIVER_LEFT:
-		case GRIVER_RIGHT:
-			usable_height = height - 2 * outer_padding;
-			break;
-		case GRIVER_TOP:
-		case GRIVER_BOTTOM:
-			usable_height = width - 2 * outer_padding;
-			break;
+	/* recompute the views that moved since the last layout of the demanded
+	 * tags, but push all of them */
+	uint32_t slot = priv->demand_tags ? __builtin_ctz(priv->demand_tags) : 0;
+	LayoutGeometry *geometry = &priv->geometry[slot];
+	uint32_t first = 0;
+
+	if (geometry_matches(geometry, layout, width, height, &params)) {
+		first = griver_layout_stable_views(layout, geometry->view_count,
+				view_count, main_count);
 	}
 
-	uint32_t main_width, main_height, main_height_rem;
-	uint32_t secondary_width, secondary_height, secondary_height_rem;
+	GriverRects rects = rect_buffer_resize(&geometry->rects, view_count);
+	gint64 start = GRIVER_TRACE_BEGIN();
+	griver_layout_compute_rects(layout, view_count, width, height, &params,
+			first, &rects);
+	GRIVER_TRACE_SPAN("layout", "kernel", start, "views", view_count,
+			"first", first);
 
-	if (secondary_count > 0 ) {
-		main_width = (uint32_t) (ratio * usable_width);
-		main_height = usable_height / main_count;
-		main_height_rem = usable_height % main_count;
+	geometry->valid = true;
+	geometry->layout = layout;
+	geometry->view_count = view_count;
+	geometry->width = width;
+	geometry->height = height;
+	geometry->params = params;
 
-		secondary_width = usable_width - main_width;
-		secondary_height = usable_height / secondary_count;
-		secondary_height_rem = usable_height % secondary_count;
-	} else {
-		main_width = usable_width;
-		main_height = usable_height / main_count;
-		main_height_rem = usable_height % main_count;
+	push_rects(out, &geometry->rects, serial);
+}
+
+/**
+ * g_river_output_layout_spec:
+ * @out: A #GriverOut to tile.
+ * @spec: The layout, see g_river_layout_spec_new()
+ * @view_count: number of views
+ * @width: width of the usable area
+ * @height: height of the usable area
+ * @main_count: number of views in the main
+ * @view_padding: the padding between views.
+ * @outer_padding: the outer padding
+ * @ratio: ratio between master and secondary
+ * @rotation: Where the master should be.
+ * @serial: A serial used to push and commit dimensions
+ *
+ * Tiles the output using a compiled layout spec.
+ * Doesn't call commit.
+ *
+ **/
+void g_river_output_layout_spec(GriverOutput *out, GriverLayoutSpec *spec,
+		uint32_t view_count, uint32_t width, uint32_t height, uint32_t main_count,
+		uint32_t view_padding, uint32_t outer_padding, double ratio,
+		GriverRotation rotation, uint32_t serial)
+{
+	g_return_if_fail(GRIVER_IS_OUTPUT(out));
+	g_return_if_fail(spec != NULL);
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	if (view_count <= 0) {
+		return;
 	}
 
-	for (int i = 0; i < view_count; i++) {
-		uint32_t x, y, lwidth, lheight;
+	GriverLayoutParams params = {
+		.main_count = main_count,
+		.view_padding = view_padding,
+		.outer_padding = outer_padding,
+		.ratio = ratio,
+		.rotation = rotation,
+	};
 
-		if (i < main_count) {
-			x = 0;
-			y = i * main_height; 
-			if (i > 0) { 
-				y += main_height_rem;
-			}
-			lwidth = main_width;
-			lheight = main_height; 
-			if (i == 0) {
-				lheight += main_height_rem;
-			}
-		} else {
-			x = main_width;
-			y = (i - main_count) * secondary_height; 
-			if (i > main_count) {
-				y += secondary_height_rem;
-			}
-			lwidth = secondary_width;
-			lheight = secondary_height;
-			if (i == main_count) {
-				lheight += secondary_height_rem;
-			}
-		}
+	GriverRects rects = rect_buffer_resize(&priv->rects, view_count);
+	gint64 start = GRIVER_TRACE_BEGIN();
+	griver_layout_spec_compute_rects(spec, view_count, width, height, &params,
+			&rects);
+	GRIVER_TRACE_SPAN("layout_spec", "kernel", start, "views", view_count,
+			NULL, 0);
+	push_rects(out, &priv->rects, serial);
+}
 
-		x += view_padding;
-		y += view_padding;
-		lwidth -= 2 * view_padding;
-		lheight -= 2 * view_padding;
-
-		switch (rotation) {
-			case GRIVER_LEFT:
-				g_river_output_push_view_dimensions(out,
-						x + outer_padding,
-						y + outer_padding,
-						lwidth,
-						lheight,
-						serial
-						);
-				break;
-			case GRIVER_RIGHT:
-				g_river_output_push_view_dimensions(out,
-						width - lwidth - x + outer_padding,
-						y + outer_padding,
-						lwidth,
-						lheight,
-						serial
-						);
-				break;
-			case GRIVER_TOP:
-				g_river_output_push_view_dimensions(out,
-						y + outer_padding,
-						x + outer_padding,
-						lheight,
-						lwidth,
-						serial
-						);
-				break;
-			case GRIVER_BOTTOM:
-				g_river_output_push_view_dimensions(out,
-						y + outer_padding,
-						usable_width - lwidth - x + outer_padding,
-						lheight,
-						lwidth,
-						serial
-						);
-				break;
-		}
+/**
+ * g_river_output_tall_layout:
+ * @out: A #GriverOut to tile.
+ * @view_count: number of views
+ * @width: width of the usable area
+ * @height: height of the usable area
+ * @main_count: number of views in the main
+ * @view_padding: the padding between views.
+ * @outer_padding: the outer padding
+ * @ratio: ratio between master and secondary
+ * @rotation: Where the master should be.
+ * @serial: A serial used to push and commit dimensions
+ * 
+ * Tiles the output in the classic dwm style but with different rations.
+ * Doesn't call commit.
+ *
+ **/
+void g_river_output_tall_layout(GriverOutput *out, uint32_t view_count, uint32_t width,
+		uint32_t height, uint32_t main_count, uint32_t view_padding, uint32_t outer_padding, 
+		double ratio, GriverRotation rotation, uint32_t serial) {
+
+	g_river_output_layout(out, GRIVER_LAYOUT_TALL, view_count, width, height,
+			main_count, view_padding, outer_padding, ratio, rotation, serial);
+}
+
+/**
+ * g_river_output_get_tag_state:
+ * @out: A #GriverOutput
+ * @tags: A tag bitfield, as passed to #GriverOutput::layout-demand
+ *
+ * Get the settings for the first (lowest) tag set in @tags. Every output
+ * has one state for each of the 32 tags. In C, and in bindings that hand
+ * out the struct itself like lgi, changes to the returned state are seen
+ * by g_river_output_arrange(). Bindings that copy boxed values, like
+ * PyGObject, only change their copy, use g_river_output_set_tag_state()
+ * there.
+ *
+ * Returns: (transfer none): The state of the tag
+ **/
+GriverTagState *g_river_output_get_tag_state(GriverOutput *out, uint32_t tags)
+{
+	g_return_val_if_fail(GRIVER_IS_OUTPUT(out), NULL);
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	uint32_t slot = tags ? __builtin_ctz(tags) : 0;
+	return &priv->tag_states[slot];
+}
+
+/**
+ * g_river_output_set_tag_state:
+ * @out: A #GriverOutput
+ * @tags: A tag bitfield, as passed to #GriverOutput::layout-demand
+ * @state: The new settings
+ *
+ * Replace the settings for the first (lowest) tag set in @tags with
+ * @state, and drop the layouts cached for @tags.
+ **/
+void g_river_output_set_tag_state(GriverOutput *out, uint32_t tags,
+		const GriverTagState *state)
+{
+	g_return_if_fail(GRIVER_IS_OUTPUT(out));
+	g_return_if_fail(state != NULL);
+
+	*g_river_output_get_tag_state(out, tags) = *state;
+	g_river_output_invalidate_layout_cache(out, tags);
+}
+
+/**
+ * g_river_output_reset_tag_states:
+ * @out: A #GriverOutput
+ *
+ * Resets the settings of every tag to the default.
+ **/
+void g_river_output_reset_tag_states(GriverOutput *out)
+{
+	g_return_if_fail(GRIVER_IS_OUTPUT(out));
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	for (int i = 0; i < GRIVER_TAG_COUNT; i++) {
+		g_river_tag_state_reset(&priv->tag_states[i]);
+		g_clear_pointer(&priv->tag_specs[i], g_river_layout_spec_unref);
 	}
 }
 
+/**
+ * g_river_output_set_tag_layout_spec:
+ * @out: A #GriverOutput
+ * @tags: A tag bitfield, as passed to #GriverOutput::layout-demand
+ * @spec: (nullable): The layout to use, or %NULL for the layout of the tag
+ *   state
+ *
+ * Makes g_river_output_arrange() lay out the first (lowest) tag set in
+ * @tags with @spec instead of a builtin layout. The builtin "layout" and
+ * "reset" commands go back to the builtin layouts.
+ **/
+void g_river_output_set_tag_layout_spec(GriverOutput *out, uint32_t tags,
+		GriverLayoutSpec *spec)
+{
+	g_return_if_fail(GRIVER_IS_OUTPUT(out));
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	uint32_t slot = tags ? __builtin_ctz(tags) : 0;
+	if (priv->tag_specs[slot] == spec) {
+		return;
+	}
+	if (spec != NULL) {
+		g_river_layout_spec_ref(spec);
+	}
+	g_clear_pointer(&priv->tag_specs[slot], g_river_layout_spec_unref);
+	priv->tag_specs[slot] = spec;
+
+	g_river_output_invalidate_layout_cache(out, tags);
+}
+
+/**
+ * g_river_output_get_tag_layout_spec:
+ * @out: A #GriverOutput
+ * @tags: A tag bitfield, as passed to #GriverOutput::layout-demand
+ *
+ * Returns: (transfer none) (nullable): the spec set with
+ *   g_river_output_set_tag_layout_spec() for the first tag in @tags
+ **/
+GriverLayoutSpec *g_river_output_get_tag_layout_spec(GriverOutput *out, uint32_t tags)
+{
+	g_return_val_if_fail(GRIVER_IS_OUTPUT(out), NULL);
+	GriverOutputPrivate *priv = g_river_output_get_instance_private(out);
+
+	uint32_t slot = tags ? __builtin_ctz(tags) : 0;
+	return priv->tag_specs[slot];
+}
+
+/**
+ * g_river_output_arrange:
+ * @out: A #GriverOutput
+ * @view_count: number of views
+ * @width: width of the usable area
+ * @height: height of the usable area
+ * @tags: Which tags are visible.
+ * @serial: A serial used to push and commit dimensions
+ *
+ * Lay out the views using the state of @tags, see
+ * g_river_output_get_tag_state(), and commit using the symbol of the layout.
+ * If a spec was set for @tags with g_river_output_set_tag_layout_spec(), it
+ * is used instead of the builtin layout and its name is committed.
+ * The arguments are the same as for #GriverOutput::layout-demand.
+ *
+ **/
+void g_river_output_arrange(GriverOutput *out, uint32_t view_count, uint32_t width,
+		uint32_t height, uint32_t tags, uint32_t serial)
+{
+	g_return_if_fail(GRIVER_IS_OUTPUT(out));
+	const GriverTagState *state = g_river_output_get_tag_state(out, tags);
+	GriverLayoutSpec *spec = g_river_output_get_tag_layout_spec(out, tags);
+
+	if (spec != NULL) {
+		g_river_output_layout_spec(out, spec, view_count, width, height,
+				state->main_count, state->view_padding, state->outer_padding,
+				state->ratio, state->rotation, serial);
+		g_river_output_commit_dimensions(out, g_river_layout_spec_get_name(spec),
+				serial);
+		return;
+	}
+
+	g_river_output_layout(out, state->layout, view_count, width, height,
+			state->main_count, state->view_padding, state->outer_padding,
+			state->ratio, state->rotation, serial);
+	g_river_output_commit_dimensions(out, g_river_layout_get_symbol(state->layout),
+			serial);
+}
+
 /**
  * g_river_output_new: (skip)
  * @layout_manager: A layout manager to get the layout from
@@ -5,6 +5,11 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "river-layout-v3-client-protocol.h"
+#include "griver-layout.h"
+#include "griver-layout-spec.h"
+#include "griver-tag-state.h"
+#include "griver-command.h"
+#include "griver-stats.h"
 
 G_BEGIN_DECLS
 
@@ -13,20 +18,20 @@ G_BEGIN_DECLS
 G_DECLARE_DERIVABLE_TYPE(GriverOutput, g_river_output, GRIVER, OUTPUT, GObject);
 
 /**
- * GriverRotation:
- * @GRIVER_LEFT: Put the master to the left
- * @GRIVER_RIGHT: Put the master to the right
- * @GRIVER_TOP: Put the master to at the top
- * @GRIVER_BOT: Put the master to at the bot
+ * GriverLayoutDemandFunc:
+ * @out: The output that needs a layout
+ * @view_count: Number of views.
+ * @width: The width of the output.
+ * @height: The height of the output.
+ * @tags: Which tags are visible.
+ * @serial: A serial used to push and commit dimensions
+ * @user_data: The data passed to g_river_output_set_layout_demand_func()
  *
- * A type to represents the orientation of tiling
+ * Called for every layout demand, see #GriverOutput::layout-demand.
  **/
-typedef enum {
-	GRIVER_LEFT,
-	GRIVER_RIGHT,
-	GRIVER_TOP,
-	GRIVER_BOTTOM,
-} GriverRotation;
+typedef void (*GriverLayoutDemandFunc) (GriverOutput *out, uint32_t view_count,
+		uint32_t width, uint32_t height, uint32_t tags, uint32_t serial,
+		gpointer user_data);
 
 struct _GriverOutputClass {
 	GObjectClass parent_class;
@@ -34,7 +39,13 @@ struct _GriverOutputClass {
 			uint32_t x, uint32_t y, uint32_t width, uint32_t height,
 			uint32_t serial);
 	void (*commit_dimensions) (GriverOutput *out, const char *layout_name, uint32_t serial);
-	gpointer padding[12];
+	void (*push_view_dimensions_array) (GriverOutput *out,
+			const uint32_t *dimensions, guint n_dimensions,
+			const char *layout_name, uint32_t serial);
+	void (*command) (GriverOutput *out, const GriverCommand *cmd, uint32_t tags);
+	void (*layout_demand) (GriverOutput *out, uint32_t view_count, uint32_t width,
+			uint32_t height, uint32_t tags, uint32_t serial);
+	gpointer padding[9];
 };
 
 void
@@ -45,10 +56,63 @@ g_river_output_push_view_dimensions (GriverOutput *out,
 void
 g_river_output_commit_dimensions (GriverOutput *out, const char *layout_name, uint32_t serial);
 
+void
+g_river_output_push_view_dimensions_array (GriverOutput *out,
+			const uint32_t *dimensions, guint n_dimensions,
+			const char *layout_name, uint32_t serial);
+
+void g_river_output_layout(GriverOutput *out, GriverLayout layout, uint32_t view_count,
+		uint32_t width, uint32_t height, uint32_t main_count, uint32_t view_padding,
+		uint32_t outer_padding, double ratio, GriverRotation rotation, uint32_t serial);
+
+void g_river_output_layout_spec(GriverOutput *out, GriverLayoutSpec *spec,
+		uint32_t view_count, uint32_t width, uint32_t height, uint32_t main_count,
+		uint32_t view_padding, uint32_t outer_padding, double ratio,
+		GriverRotation rotation, uint32_t serial);
+
 void g_river_output_tall_layout(GriverOutput *out, uint32_t view_count, uint32_t width,
 		uint32_t height, uint32_t main_count, uint32_t view_padding, uint32_t outer_padding, 
 		double ratio, GriverRotation rotation, uint32_t serial);
 
+void g_river_output_set_layout_demand_func(GriverOutput *out,
+		GriverLayoutDemandFunc func, gpointer user_data, GDestroyNotify notify);
+
+void g_river_output_set_layout_cache(GriverOutput *out, gboolean enable);
+
+void g_river_output_set_layout_params_hash(GriverOutput *out, uint32_t tags,
+		guint64 params_hash);
+
+void g_river_output_invalidate_layout_cache(GriverOutput *out, uint32_t tags);
+
+GriverTagState *g_river_output_get_tag_state(GriverOutput *out, uint32_t tags);
+void g_river_output_set_tag_state(GriverOutput *out, uint32_t tags,
+		const GriverTagState *state);
+
+void g_river_output_reset_tag_states(GriverOutput *out);
+
+void g_river_output_set_tag_layout_spec(GriverOutput *out, uint32_t tags,
+		GriverLayoutSpec *spec);
+GriverLayoutSpec *g_river_output_get_tag_layout_spec(GriverOutput *out, uint32_t tags);
+
+void g_river_output_arrange(GriverOutput *out, uint32_t view_count, uint32_t width,
+		uint32_t height, uint32_t tags, uint32_t serial);
+
+void g_river_output_arrange_on_demand(GriverOutput *out);
+
+void g_river_output_set_incremental_layout(GriverOutput *out, gboolean enable);
+void g_river_output_set_speculative_layout(GriverOutput *out, gboolean enable);
+
+GriverStats *g_river_output_get_stats(GriverOutput *out);
+void g_river_output_reset_stats(GriverOutput *out);
+guint64 g_river_output_get_skipped_demands(GriverOutput *out);
+
+uint32_t g_river_output_get_focused_tags(GriverOutput *out);
+uint32_t g_river_output_get_urgent_tags(GriverOutput *out);
+uint32_t g_river_output_get_occupied_tags(GriverOutput *out);
+const uint32_t *g_river_output_get_view_tags(GriverOutput *out, guint *n_views);
+gboolean g_river_output_get_focused(GriverOutput *out);
+
+const char *g_river_output_get_name(GriverOutput *out);
 uint32_t g_river_output_get_uid(GriverOutput *out);
 
 void g_river_output_configure (GriverOutput *out, struct river_layout_manager_v3 *layout_manager,
@@ -0,0 +1,44 @@
+#ifndef __GRIVER_POOL_PRIVATE_H__
+#define __GRIVER_POOL_PRIVATE_H__
+
+#include <glib.h>
+#include <wayland-client.h>
+
+#include "river-layout-v3-client-protocol.h"
+
+G_BEGIN_DECLS
+
+/* Worker threads for the outputs of a context. Every output gets its own
+ * event queue, the queues are spread over the workers, so outputs on
+ * different workers lay out at the same time */
+typedef struct _GriverLayoutPool GriverLayoutPool;
+
+/* Called on a worker, with its lock held, after events of the output
+ * with uid were dispatched */
+typedef void (*GriverPoolDispatched) (uint32_t uid, gpointer user_data);
+
+GriverLayoutPool *griver_layout_pool_new (struct wl_display *display,
+		guint n_workers, GriverPoolDispatched dispatched, gpointer user_data);
+
+/* A layout manager whose new river_layout_v3 objects end up on the queue
+ * of the output with uid. Call with the pool locked */
+struct river_layout_manager_v3 *griver_layout_pool_wrap_manager (
+		GriverLayoutPool *pool, struct river_layout_manager_v3 *manager,
+		uint32_t uid);
+
+gboolean griver_layout_pool_start (GriverLayoutPool *pool, GError **error);
+
+/* Stops and joins the workers, events still queued are dropped */
+void griver_layout_pool_stop (GriverLayoutPool *pool);
+
+/* Takes the lock of every worker, for touching outputs from another
+ * thread */
+void griver_layout_pool_lock (GriverLayoutPool *pool);
+void griver_layout_pool_unlock (GriverLayoutPool *pool);
+
+/* Must be stopped and all proxies on the queues destroyed */
+void griver_layout_pool_free (GriverLayoutPool *pool);
+
+G_END_DECLS
+
+#endif /* __GRIVER_POOL_PRIVATE_H__ */
@@ -0,0 +1,307 @@
+#define _GNU_SOURCE
+#include "griver-pool-private.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+/* The queue of one output, kept until the pool is freed since the
+ * river_layout_v3 on it can outlive the output */
+typedef struct {
+	uint32_t uid;
+	struct wl_event_queue *queue;
+	struct river_layout_manager_v3 *manager;
+} PoolSlot;
+
+typedef struct {
+	GriverLayoutPool *pool;
+	GThread *thread;
+	GMutex lock;
+	GPtrArray *slots;  // PoolSlot, changed with the lock held
+	int wakeup[2];
+	gint stopping;
+} PoolWorker;
+
+struct _GriverLayoutPool {
+	struct wl_display *display;
+	PoolWorker *workers;
+	guint n_workers;
+	guint next_worker;
+	GHashTable *slots;  // uid -> PoolSlot
+
+	GriverPoolDispatched dispatched;
+	gpointer user_data;
+};
+
+static void slot_free (gpointer data)
+{
+	PoolSlot *slot = data;
+
+	if (slot->manager != NULL) {
+		wl_proxy_wrapper_destroy(slot->manager);
+	}
+	wl_event_queue_destroy(slot->queue);
+	g_free(slot);
+}
+
+GriverLayoutPool *griver_layout_pool_new (struct wl_display *display,
+		guint n_workers, GriverPoolDispatched dispatched, gpointer user_data)
+{
+	GriverLayoutPool *pool = g_new0(GriverLayoutPool, 1);
+
+	pool->display = display;
+	pool->n_workers = MAX(n_workers, 1);
+	pool->workers = g_new0(PoolWorker, pool->n_workers);
+	pool->next_worker = 0;
+	pool->slots = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+			NULL, slot_free);
+	pool->dispatched = dispatched;
+	pool->user_data = user_data;
+
+	for (guint i = 0; i < pool->n_workers; i++) {
+		PoolWorker *worker = &pool->workers[i];
+
+		worker->pool = pool;
+		worker->thread = NULL;
+		g_mutex_init(&worker->lock);
+		worker->slots = g_ptr_array_new();
+		worker->wakeup[0] = worker->wakeup[1] = -1;
+		worker->stopping = false;
+	}
+	return pool;
+}
+
+static void wake_worker (PoolWorker *worker)
+{
+	char c = 0;
+
+	if (worker->wakeup[1] < 0) {
+		return;
+	}
+	while (write(worker->wakeup[1], &c, 1) < 0 && errno == EINTR)
+		;
+}
+
+struct river_layout_manager_v3 *griver_layout_pool_wrap_manager (
+		GriverLayoutPool *pool, struct river_layout_manager_v3 *manager,
+		uint32_t uid)
+{
+	if (manager == NULL) {
+		return NULL;
+	}
+
+	PoolSlot *slot = g_hash_table_lookup(pool->slots, GUINT_TO_POINTER(uid));
+	if (slot == NULL) {
+		PoolWorker *worker = &pool->workers[pool->next_worker];
+
+		pool->next_worker = (pool->next_worker + 1) % pool->n_workers;
+		slot = g_new0(PoolSlot, 1);
+		slot->uid = uid;
+		slot->queue = wl_display_create_queue(pool->display);
+		g_hash_table_insert(pool->slots, GUINT_TO_POINTER(uid), slot);
+		g_ptr_array_add(worker->slots, slot);
+		/* it may be polling without this queue */
+		wake_worker(worker);
+	}
+	if (slot->manager == NULL) {
+		slot->manager = wl_proxy_create_wrapper(manager);
+		wl_proxy_set_queue((struct wl_proxy *) slot->manager, slot->queue);
+	}
+	return slot->manager;
+}
+
+/* Dispatch what is queued for the outputs of the worker */
+static bool dispatch_pending (PoolWorker *worker)
+{
+	GriverLayoutPool *pool = worker->pool;
+	bool ok = true;
+
+	g_mutex_lock(&worker->lock);
+	for (guint i = 0; i < worker->slots->len; i++) {
+		PoolSlot *slot = g_ptr_array_index(worker->slots, i);
+		int ret = wl_display_dispatch_queue_pending(pool->display, slot->queue);
+
+		if (ret < 0) {
+			ok = false;
+			break;
+		}
+		if (ret > 0 && pool->dispatched != NULL) {
+			pool->dispatched(slot->uid, pool->user_data);
+		}
+		/* send the commit of this output before laying out the next */
+		if (ret > 0) {
+			wl_display_flush(pool->display);
+		}
+	}
+	g_mutex_unlock(&worker->lock);
+
+	return ok;
+}
+
+/* The first queue of the worker, NULL while it has none */
+static struct wl_event_queue *first_queue (PoolWorker *worker)
+{
+	struct wl_event_queue *queue = NULL;
+
+	g_mutex_lock(&worker->lock);
+	if (worker->slots->len > 0) {
+		queue = ((PoolSlot *) g_ptr_array_index(worker->slots, 0))->queue;
+	}
+	g_mutex_unlock(&worker->lock);
+
+	return queue;
+}
+
+/* Empties the wakeup pipe, returns whether the worker has to stop */
+static bool handle_wakeup (PoolWorker *worker)
+{
+	char buf[16];
+
+	while (read(worker->wakeup[0], buf, sizeof(buf)) > 0)
+		;
+	return g_atomic_int_get(&worker->stopping);
+}
+
+static gpointer worker_main (gpointer data)
+{
+	PoolWorker *worker = data;
+	struct wl_display *display = worker->pool->display;
+	struct pollfd fds[2] = {
+		{ .fd = wl_display_get_fd(display), .events = POLLIN },
+		{ .fd = worker->wakeup[0], .events = POLLIN },
+	};
+
+	for (;;) {
+		struct wl_event_queue *queue = first_queue(worker);
+
+		/* nothing to read for yet, wait for a queue */
+		if (queue == NULL) {
+			if (poll(&fds[1], 1, -1) < 0 && errno != EINTR) {
+				return NULL;
+			}
+			if (handle_wakeup(worker)) {
+				return NULL;
+			}
+			continue;
+		}
+
+		/* Once prepared, no other thread can read events until this one
+		 * reads or cancels, so after emptying the other queues as well
+		 * nothing can arrive unnoticed while polling */
+		while (wl_display_prepare_read_queue(display, queue) != 0) {
+			if (!dispatch_pending(worker)) {
+				return NULL;
+			}
+		}
+		if (!dispatch_pending(worker)) {
+			wl_display_cancel_read(display);
+			return NULL;
+		}
+		wl_display_flush(display);
+
+		if (poll(fds, G_N_ELEMENTS(fds), -1) < 0) {
+			wl_display_cancel_read(display);
+			if (errno == EINTR) {
+				continue;
+			}
+			return NULL;
+		}
+
+		if (fds[1].revents) {
+			wl_display_cancel_read(display);
+			if (handle_wakeup(worker)) {
+				return NULL;
+			}
+			continue;
+		}
+
+		if (fds[0].revents & POLLIN) {
+			if (wl_display_read_events(display) < 0) {
+				return NULL;
+			}
+		} else {
+			wl_display_cancel_read(display);
+			if (fds[0].revents & (POLLERR | POLLHUP)) {
+				return NULL;
+			}
+		}
+
+		if (!dispatch_pending(worker)) {
+			return NULL;
+		}
+	}
+}
+
+gboolean griver_layout_pool_start (GriverLayoutPool *pool, GError **error)
+{
+	for (guint i = 0; i < pool->n_workers; i++) {
+		PoolWorker *worker = &pool->workers[i];
+
+		g_return_val_if_fail(worker->thread == NULL, false);
+		if (pipe2(worker->wakeup, O_CLOEXEC | O_NONBLOCK) < 0) {
+			g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errno),
+					"Can't create layout worker pipe: %s", strerror(errno));
+			griver_layout_pool_stop(pool);
+			return false;
+		}
+
+		worker->stopping = false;
+		worker->thread = g_thread_try_new("griver-worker", worker_main,
+				worker, error);
+		if (worker->thread == NULL) {
+			griver_layout_pool_stop(pool);
+			return false;
+		}
+	}
+	return true;
+}
+
+void griver_layout_pool_stop (GriverLayoutPool *pool)
+{
+	for (guint i = 0; i < pool->n_workers; i++) {
+		PoolWorker *worker = &pool->workers[i];
+
+		if (worker->thread != NULL) {
+			g_atomic_int_set(&worker->stopping, true);
+			wake_worker(worker);
+			g_thread_join(worker->thread);
+			worker->thread = NULL;
+		}
+		if (worker->wakeup[0] >= 0) {
+			close(worker->wakeup[0]);
+			close(worker->wakeup[1]);
+			worker->wakeup[0] = worker->wakeup[1] = -1;
+		}
+	}
+}
+
+/* Always in the same order, the workers only ever take their own lock */
+void griver_layout_pool_lock (GriverLayoutPool *pool)
+{
+	for (guint i = 0; i < pool->n_workers; i++) {
+		g_mutex_lock(&pool->workers[i].lock);
+	}
+}
+
+void griver_layout_pool_unlock (GriverLayoutPool *pool)
+{
+	for (guint i = pool->n_workers; i > 0; i--) {
+		g_mutex_unlock(&pool->workers[i - 1].lock);
+	}
+}
+
+void griver_layout_pool_free (GriverLayoutPool *pool)
+{
+	griver_layout_pool_stop(pool);
+
+	for (guint i = 0; i < pool->n_workers; i++) {
+		g_ptr_array_unref(pool->workers[i].slots);
+		g_mutex_clear(&pool->workers[i].lock);
+	}
+	g_hash_table_destroy(pool->slots);
+	g_free(pool->workers);
+	g_free(pool);
+}
@@ -0,0 +1,63 @@
+#ifndef __GRIVER_SESSION_PRIVATE_H__
+#define __GRIVER_SESSION_PRIVATE_H__
+
+#include <glib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+G_BEGIN_DECLS
+
+/* A log of what river sent and what was committed, written by
+ * g_river_context_record_session() and read back by
+ * g_river_context_replay_session(). After a magic, every record is a type
+ * byte followed by varints: the µs since the previous record, the uid of
+ * the output and the fields of the record. Strings are their length and
+ * bytes. */
+typedef struct _GriverSession GriverSession;
+
+typedef enum {
+	GRIVER_RECORD_OUTPUT_ADD = 1, // text: the name of the output
+	GRIVER_RECORD_OUTPUT_REMOVE,
+	GRIVER_RECORD_DEMAND,
+	GRIVER_RECORD_COMMAND,        // text: the command
+	GRIVER_RECORD_COMMIT,         // text: the layout name
+} GriverRecordType;
+
+typedef struct {
+	GriverRecordType type;
+	guint64 time;            // µs since the first record
+	uint32_t uid;
+	uint32_t view_count;
+	uint32_t width;
+	uint32_t height;
+	uint32_t tags;
+	uint32_t serial;
+	const char *text;        // NULL or in the reader, until the next record
+	const uint32_t *dimensions; // 4 per view, also in the reader
+	guint n_dimensions;
+} GriverRecord;
+
+/* Writing, the records can come from any thread */
+GriverSession *griver_session_new (const char *path, GError **error);
+GriverSession *griver_session_ref (GriverSession *session);
+void griver_session_unref (GriverSession *session);
+
+void griver_session_write (GriverSession *session, const GriverRecord *record);
+
+/* Records are buffered, flush writes them out */
+void griver_session_flush (GriverSession *session);
+
+/* Reading */
+typedef struct _GriverSessionReader GriverSessionReader;
+
+GriverSessionReader *griver_session_reader_new (const char *path, GError **error);
+void griver_session_reader_free (GriverSessionReader *reader);
+
+/* Returns false at the end of the log, or with error set when it is
+ * broken */
+bool griver_session_reader_next (GriverSessionReader *reader,
+		GriverRecord *record, GError **error);
+
+G_END_DECLS
+
+#endif /* __GRIVER_SESSION_PRIVATE_H__ */
@@ -0,0 +1,330 @@
+#include "griver-session-private.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Bump when the records change, older logs are refused */
+#define SESSION_VERSION 1
+#define SESSION_MAGIC "GRIVERSL"
+#define SESSION_MAGIC_SIZE 8
+
+/* Written out once this much is buffered, and by griver_session_flush() */
+#define SESSION_BUFFER_SIZE 65536
+
+struct _GriverSession {
+	gint ref_count;
+	GMutex lock;
+	FILE *file;
+	GByteArray *buffer;
+	gint64 last_time;
+};
+
+struct _GriverSessionReader {
+	char *path;
+	guint8 *data;
+	gsize size;
+	gsize offset;
+	guint64 time;
+
+	char *text;
+	GArray *dimensions;
+};
+
+static void write_varint (GByteArray *buffer, guint64 value)
+{
+	guint8 bytes[10];
+	guint len = 0;
+
+	do {
+		bytes[len] = value & 0x7f;
+		value >>= 7;
+		if (value != 0) {
+			bytes[len] |= 0x80;
+		}
+		len++;
+	} while (value != 0);
+	g_byte_array_append(buffer, bytes, len);
+}
+
+static void write_string (GByteArray *buffer, const char *str)
+{
+	gsize len = str != NULL ? strlen(str) : 0;
+
+	write_varint(buffer, len);
+	g_byte_array_append(buffer, (const guint8 *) str, len);
+}
+
+/* Call with the lock held */
+static void flush_buffer (GriverSession *session)
+{
+	if (session->buffer->len == 0) {
+		return;
+	}
+	if (fwrite(session->buffer->data, 1, session->buffer->len,
+				session->file) != session->buffer->len) {
+		g_warning("Can not write the session log: %s", g_strerror(errno));
+	}
+	fflush(session->file);
+	g_byte_array_set_size(session->buffer, 0);
+}
+
+GriverSession *griver_session_new (const char *path, GError **error)
+{
+	FILE *file = fopen(path, "we");
+	if (file == NULL) {
+		int saved_errno = errno;
+		g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+				"Can not open %s: %s", path, g_strerror(saved_errno));
+		return NULL;
+	}
+
+	GriverSession *session = g_new0(GriverSession, 1);
+
+	session->ref_count = 1;
+	g_mutex_init(&session->lock);
+	session->file = file;
+	session->buffer = g_byte_array_sized_new(SESSION_BUFFER_SIZE);
+	session->last_time = 0;
+
+	g_byte_array_append(session->buffer, (const guint8 *) SESSION_MAGIC,
+			SESSION_MAGIC_SIZE);
+	write_varint(session->buffer, SESSION_VERSION);
+	return session;
+}
+
+GriverSession *griver_session_ref (GriverSession *session)
+{
+	g_atomic_int_inc(&session->ref_count);
+	return session;
+}
+
+void griver_session_unref (GriverSession *session)
+{
+	if (!g_atomic_int_dec_and_test(&session->ref_count)) {
+		return;
+	}
+	flush_buffer(session);
+	fclose(session->file);
+	g_byte_array_unref(session->buffer);
+	g_mutex_clear(&session->lock);
+	g_free(session);
+}
+
+void griver_session_write (GriverSession *session, const GriverRecord *record)
+{
+	GByteArray *buffer = session->buffer;
+	guint8 type = record->type;
+
+	/* read under the lock, so the times of concurrent writers only go up */
+	g_mutex_lock(&session->lock);
+	gint64 now = g_get_monotonic_time();
+	if (session->last_time == 0) {
+		session->last_time = now;
+	}
+
+	g_byte_array_append(buffer, &type, 1);
+	write_varint(buffer, now - session->last_time);
+	write_varint(buffer, record->uid);
+	session->last_time = now;
+
+	switch (record->type) {
+		case GRIVER_RECORD_OUTPUT_ADD:
+			write_string(buffer, record->text);
+			break;
+		case GRIVER_RECORD_OUTPUT_REMOVE:
+			break;
+		case GRIVER_RECORD_DEMAND:
+			write_varint(buffer, record->view_count);
+			write_varint(buffer, record->width);
+			write_varint(buffer, record->height);
+			write_varint(buffer, record->tags);
+			write_varint(buffer, record->serial);
+			break;
+		case GRIVER_RECORD_COMMAND:
+			write_varint(buffer, record->tags);
+			write_string(buffer, record->text);
+			break;
+		case GRIVER_RECORD_COMMIT:
+			write_varint(buffer, record->serial);
+			write_string(buffer, record->text);
+			write_varint(buffer, record->n_dimensions);
+			for (guint i = 0; i < record->n_dimensions; i++) {
+				write_varint(buffer, record->dimensions[i]);
+			}
+			break;
+	}
+
+	if (buffer->len >= SESSION_BUFFER_SIZE) {
+		flush_buffer(session);
+	}
+	g_mutex_unlock(&session->lock);
+}
+
+void griver_session_flush (GriverSession *session)
+{
+	g_mutex_lock(&session->lock);
+	flush_buffer(session);
+	g_mutex_unlock(&session->lock);
+}
+
+static bool read_varint (GriverSessionReader *reader, guint64 *value)
+{
+	guint64 result = 0;
+
+	for (guint shift = 0; shift < 64; shift += 7) {
+		if (reader->offset >= reader->size) {
+			return false;
+		}
+		guint8 byte = reader->data[reader->offset++];
+		result |= (guint64) (byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0) {
+			*value = result;
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool read_uint32 (GriverSessionReader *reader, uint32_t *value)
+{
+	guint64 wide;
+
+	if (!read_varint(reader, &wide) || wide > G_MAXUINT32) {
+		return false;
+	}
+	*value = (uint32_t) wide;
+	return true;
+}
+
+static bool read_string (GriverSessionReader *reader, const char **str)
+{
+	guint64 len;
+
+	if (!read_varint(reader, &len) || len > reader->size - reader->offset) {
+		return false;
+	}
+	g_free(reader->text);
+	reader->text = g_strndup((const char *) reader->data + reader->offset, len);
+	reader->offset += len;
+	*str = reader->text;
+	return true;
+}
+
+static bool read_dimensions (GriverSessionReader *reader, GriverRecord *record)
+{
+	uint32_t n_dimensions;
+
+	/* every dimension takes at least a byte */
+	if (!read_uint32(reader, &n_dimensions) ||
+			n_dimensions > reader->size - reader->offset ||
+			n_dimensions % 4 != 0) {
+		return false;
+	}
+	g_array_set_size(reader->dimensions, n_dimensions);
+	uint32_t *dimensions = (uint32_t *) reader->dimensions->data;
+	for (guint i = 0; i < n_dimensions; i++) {
+		if (!read_uint32(reader, &dimensions[i])) {
+			return false;
+		}
+	}
+	record->dimensions = dimensions;
+	record->n_dimensions = n_dimensions;
+	return true;
+}
+
+static bool set_broken (GriverSessionReader *reader, GError **error)
+{
+	g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+			"%s is broken at byte %" G_GSIZE_FORMAT, reader->path, reader->offset);
+	return false;
+}
+
+GriverSessionReader *griver_session_reader_new (const char *path, GError **error)
+{
+	GriverSessionReader *reader = g_new0(GriverSessionReader, 1);
+	guint64 version = 0;
+
+	reader->path = g_strdup(path);
+	reader->dimensions = g_array_new(false, false, sizeof(uint32_t));
+	if (!g_file_get_contents(path, (char **) &reader->data, &reader->size, error)) {
+		griver_session_reader_free(reader);
+		return NULL;
+	}
+
+	if (reader->size < SESSION_MAGIC_SIZE ||
+			memcmp(reader->data, SESSION_MAGIC, SESSION_MAGIC_SIZE) != 0) {
+		g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+				"%s is not a griver session log", path);
+		griver_session_reader_free(reader);
+		return NULL;
+	}
+	reader->offset = SESSION_MAGIC_SIZE;
+	if (!read_varint(reader, &version) || version != SESSION_VERSION) {
+		g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+				"%s was written by another version of griver", path);
+		griver_session_reader_free(reader);
+		return NULL;
+	}
+	return reader;
+}
+
+void griver_session_reader_free (GriverSessionReader *reader)
+{
+	g_free(reader->path);
+	g_free(reader->data);
+	g_free(reader->text);
+	g_array_unref(reader->dimensions);
+	g_free(reader);
+}
+
+bool griver_session_reader_next (GriverSessionReader *reader,
+		GriverRecord *record, GError **error)
+{
+	guint64 delta;
+	bool valid = true;
+
+	if (reader->offset >= reader->size) {
+		return false;
+	}
+
+	memset(record, 0, sizeof(*record));
+	record->type = reader->data[reader->offset++];
+	if (!read_varint(reader, &delta) || !read_uint32(reader, &record->uid)) {
+		return set_broken(reader, error);
+	}
+	reader->time += delta;
+	record->time = reader->time;
+
+	switch (record->type) {
+		case GRIVER_RECORD_OUTPUT_ADD:
+			valid = read_string(reader, &record->text);
+			break;
+		case GRIVER_RECORD_OUTPUT_REMOVE:
+			break;
+		case GRIVER_RECORD_DEMAND:
+			valid = read_uint32(reader, &record->view_count) &&
+				read_uint32(reader, &record->width) &&
+				read_uint32(reader, &record->height) &&
+				read_uint32(reader, &record->tags) &&
+				read_uint32(reader, &record->serial);
+			break;
+		case GRIVER_RECORD_COMMAND:
+			valid = read_uint32(reader, &record->tags) &&
+				read_string(reader, &record->text);
+			break;
+		case GRIVER_RECORD_COMMIT:
+			valid = read_uint32(reader, &record->serial) &&
+				read_string(reader, &record->text) &&
+				read_dimensions(reader, record);
+			break;
+		default:
+			valid = false;
+			break;
+	}
+
+	if (!valid) {
+		return set_broken(reader, error);
+	}
+	return true;
+}
@@ -0,0 +1,27 @@
+#ifndef __GRIVER_STATE_FILE_PRIVATE_H__
+#define __GRIVER_STATE_FILE_PRIVATE_H__
+
+#include <glib.h>
+#include <stdbool.h>
+#include "griver-tag-state.h"
+
+G_BEGIN_DECLS
+
+/* The tag states of every output, mapped from a file so they survive a
+ * restart. Changes are plain stores into the mapping, the kernel writes
+ * them back */
+typedef struct _GriverStateFile GriverStateFile;
+
+GriverStateFile *griver_state_file_open (const char *path, GError **error);
+GriverStateFile *griver_state_file_ref (GriverStateFile *file);
+void griver_state_file_unref (GriverStateFile *file);
+
+/* The GRIVER_TAG_COUNT states of an output in a namespace, valid as long as
+ * the file. restored tells whether they were saved by an earlier run, NULL
+ * when the file has no room left or can't be locked */
+GriverTagState *griver_state_file_lookup (GriverStateFile *file,
+		const char *namespace, const char *output_name, bool *restored);
+
+G_END_DECLS
+
+#endif /* __GRIVER_STATE_FILE_PRIVATE_H__ */
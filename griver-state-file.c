@@ -0,0 +1,295 @@
+#include "griver-state-file-private.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <glib/gstdio.h>
+#include <math.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Bump when the layout of the file or of GriverTagState changes, older
+ * files are started over */
+#define STATE_FILE_VERSION 1
+#define STATE_FILE_MAGIC "GRIVERTS"
+#define STATE_FILE_SLOTS 64
+#define STATE_KEY_SIZE 256
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t slot_size;
+	uint32_t n_slots;
+	uint32_t reserved;
+} StateHeader;
+
+/* One output in one namespace */
+typedef struct {
+	char key[STATE_KEY_SIZE]; // namespace, '\0', output name, '\0'
+	uint32_t used;
+	uint32_t reserved;
+	GriverTagState tags[GRIVER_TAG_COUNT];
+} StateSlot;
+
+typedef struct {
+	StateHeader header;
+	StateSlot slots[STATE_FILE_SLOTS];
+} StateMap;
+
+struct _GriverStateFile {
+	gint ref_count;
+	int fd;
+	StateMap *map;
+};
+
+static bool header_valid (const StateHeader *header)
+{
+	return memcmp(header->magic, STATE_FILE_MAGIC, sizeof(header->magic)) == 0 &&
+		header->version == STATE_FILE_VERSION &&
+		header->slot_size == sizeof(StateSlot) &&
+		header->n_slots == STATE_FILE_SLOTS;
+}
+
+/* Another version or a crash in the middle of a write can leave anything */
+static bool tag_state_valid (const GriverTagState *state)
+{
+	return (unsigned) state->layout <= GRIVER_LAYOUT_DECK &&
+		(unsigned) state->rotation <= GRIVER_BOTTOM &&
+		isfinite(state->ratio) && state->ratio >= 0.0 && state->ratio <= 1.0;
+}
+
+static void set_errno_error (GError **error, const char *path, const char *what)
+{
+	int saved_errno = errno;
+
+	g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+			"Can not %s %s: %s", what, path, g_strerror(saved_errno));
+}
+
+/* flock() can be interrupted by a signal while it waits */
+static int lock_file (int fd, int operation)
+{
+	int ret;
+
+	do {
+		ret = flock(fd, operation);
+	} while (ret < 0 && errno == EINTR);
+	return ret;
+}
+
+static void unlock_file (int fd)
+{
+	if (lock_file(fd, LOCK_UN) < 0) {
+		g_warning("Can not unlock the state file: %s", g_strerror(errno));
+	}
+}
+
+/* Opens and locks path. Another process may have replaced the file while
+ * we waited for the lock, then the new one is opened */
+static int open_locked (const char *path, GError **error)
+{
+	for (;;) {
+		struct stat st_fd, st_path;
+		int fd = g_open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+		if (fd < 0) {
+			set_errno_error(error, path, "open");
+			return -1;
+		}
+		if (lock_file(fd, LOCK_EX) < 0) {
+			set_errno_error(error, path, "lock");
+			close(fd);
+			return -1;
+		}
+		if (fstat(fd, &st_fd) < 0) {
+			set_errno_error(error, path, "stat");
+			close(fd);
+			return -1;
+		}
+		if (g_stat(path, &st_path) == 0 && st_path.st_dev == st_fd.st_dev &&
+				st_path.st_ino == st_fd.st_ino) {
+			return fd;
+		}
+		close(fd);
+	}
+}
+
+static StateMap *map_file (int fd, const char *path, GError **error)
+{
+	StateMap *map = mmap(NULL, sizeof(StateMap), PROT_READ | PROT_WRITE,
+			MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		set_errno_error(error, path, "map");
+		return NULL;
+	}
+	return map;
+}
+
+static void header_init (StateHeader *header)
+{
+	memcpy(header->magic, STATE_FILE_MAGIC, sizeof(header->magic));
+	header->version = STATE_FILE_VERSION;
+	header->slot_size = sizeof(StateSlot);
+	header->n_slots = STATE_FILE_SLOTS;
+}
+
+/* A file of another version may still be mapped by the process that made
+ * it, which would get a SIGBUS if it shrank or garbage if it was cleared.
+ * So a new file is set up next to it and renamed over it, the other
+ * process keeps the old one to itself */
+static int replace_file (const char *path, StateMap **map, GError **error)
+{
+	char *tmp_path = g_strdup_printf("%s.XXXXXX", path);
+	int fd = g_mkstemp_full(tmp_path, O_RDWR | O_CLOEXEC, 0600);
+
+	if (fd < 0) {
+		set_errno_error(error, path, "create a new");
+		g_free(tmp_path);
+		return -1;
+	}
+	if (ftruncate(fd, sizeof(StateMap)) < 0) {
+		set_errno_error(error, tmp_path, "resize");
+		goto fail;
+	}
+	if ((*map = map_file(fd, tmp_path, error)) == NULL) {
+		goto fail;
+	}
+	/* the new file is all zeros */
+	header_init(&(*map)->header);
+	if (g_rename(tmp_path, path) < 0) {
+		set_errno_error(error, path, "replace");
+		munmap(*map, sizeof(StateMap));
+		goto fail;
+	}
+	g_free(tmp_path);
+	return fd;
+
+fail:
+	g_unlink(tmp_path);
+	g_free(tmp_path);
+	close(fd);
+	return -1;
+}
+
+GriverStateFile *griver_state_file_open (const char *path, GError **error)
+{
+	StateMap *map = NULL;
+	struct stat st;
+
+	/* only one process sets up the file */
+	int fd = open_locked(path, error);
+	if (fd < 0) {
+		return NULL;
+	}
+	if (fstat(fd, &st) < 0) {
+		set_errno_error(error, path, "stat");
+		goto fail;
+	}
+
+	if (st.st_size == 0) {
+		/* just created, nobody else can have it mapped */
+		if (ftruncate(fd, sizeof(StateMap)) < 0) {
+			set_errno_error(error, path, "resize");
+			goto fail;
+		}
+		if ((map = map_file(fd, path, error)) == NULL) {
+			goto fail;
+		}
+		header_init(&map->header);
+	} else if ((size_t) st.st_size == sizeof(StateMap)) {
+		if ((map = map_file(fd, path, error)) == NULL) {
+			goto fail;
+		}
+		if (!header_valid(&map->header)) {
+			munmap(map, sizeof(StateMap));
+			map = NULL;
+		}
+	}
+
+	if (map == NULL) {
+		int new_fd = replace_file(path, &map, error);
+		if (new_fd < 0) {
+			goto fail;
+		}
+		/* waiting processes notice the rename and open the new file */
+		unlock_file(fd);
+		close(fd);
+		fd = new_fd;
+	} else {
+		unlock_file(fd);
+	}
+
+	GriverStateFile *file = g_new0(GriverStateFile, 1);
+	file->ref_count = 1;
+	file->fd = fd;
+	file->map = map;
+	return file;
+
+fail:
+	close(fd);
+	return NULL;
+}
+
+GriverStateFile *griver_state_file_ref (GriverStateFile *file)
+{
+	file->ref_count++;
+	return file;
+}
+
+void griver_state_file_unref (GriverStateFile *file)
+{
+	if (--file->ref_count > 0) {
+		return;
+	}
+	munmap(file->map, sizeof(StateMap));
+	close(file->fd);
+	g_free(file);
+}
+
+GriverTagState *griver_state_file_lookup (GriverStateFile *file,
+		const char *namespace, const char *output_name, bool *restored)
+{
+	char key[STATE_KEY_SIZE] = { 0 };
+	size_t namespace_len = strlen(namespace);
+	size_t name_len = strlen(output_name);
+	StateSlot *found = NULL;
+
+	if (namespace_len + name_len + 2 > sizeof(key)) {
+		return NULL;
+	}
+	memcpy(key, namespace, namespace_len);
+	memcpy(key + namespace_len + 1, output_name, name_len);
+
+	if (lock_file(file->fd, LOCK_EX) < 0) {
+		g_warning("Can not lock the state file: %s", g_strerror(errno));
+		return NULL;
+	}
+	for (int i = 0; i < STATE_FILE_SLOTS; i++) {
+		StateSlot *slot = &file->map->slots[i];
+		if (slot->used && memcmp(slot->key, key, sizeof(key)) == 0) {
+			found = slot;
+			*restored = true;
+			break;
+		}
+		if (!slot->used && found == NULL) {
+			found = slot;
+		}
+	}
+	if (found != NULL && !found->used) {
+		memcpy(found->key, key, sizeof(key));
+		found->used = true;
+		*restored = false;
+	}
+	unlock_file(file->fd);
+
+	if (found == NULL) {
+		return NULL;
+	}
+	for (int i = 0; *restored && i < GRIVER_TAG_COUNT; i++) {
+		if (!tag_state_valid(&found->tags[i])) {
+			g_river_tag_state_reset(&found->tags[i]);
+		}
+	}
+	return found->tags;
+}
@@ -0,0 +1,35 @@
+#ifndef __GRIVER_STATS_PRIVATE_H__
+#define __GRIVER_STATS_PRIVATE_H__
+
+#include "griver-stats.h"
+
+G_BEGIN_DECLS
+
+/* 8 buckets for every power of two of µs, values below 8 get their own */
+#define GRIVER_HISTOGRAM_SUB_BITS 3
+#define GRIVER_HISTOGRAM_BUCKETS ((64 - GRIVER_HISTOGRAM_SUB_BITS + 1) << GRIVER_HISTOGRAM_SUB_BITS)
+
+typedef struct {
+	guint64 demands;
+	guint64 commits;
+	guint64 skipped;
+	guint64 stale;
+	guint64 commands;
+	guint64 speculated;
+
+	guint64 latency_count;
+	guint64 latency_max;
+	guint64 latency[GRIVER_HISTOGRAM_BUCKETS];
+} GriverCounters;
+
+void griver_counters_reset (GriverCounters *counters);
+void griver_counters_add_latency (GriverCounters *counters, guint64 usec);
+
+/* Add everything counted in from to into */
+void griver_counters_merge (GriverCounters *into, const GriverCounters *from);
+
+GriverStats *griver_counters_to_stats (const GriverCounters *counters);
+
+G_END_DECLS
+
+#endif /* __GRIVER_STATS_PRIVATE_H__ */
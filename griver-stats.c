@@ -0,0 +1,131 @@
+#include "griver-stats.h"
+#include "griver-stats-private.h"
+
+#include <string.h>
+
+G_DEFINE_BOXED_TYPE (GriverStats, g_river_stats,
+		g_river_stats_copy, g_river_stats_free)
+
+#define SUB_BUCKETS (1 << GRIVER_HISTOGRAM_SUB_BITS)
+
+static guint bucket_index (guint64 usec)
+{
+	if (usec < SUB_BUCKETS) {
+		return (guint) usec;
+	}
+
+	/* the position of the highest bit picks the group, the next bits the
+	 * bucket inside of it */
+	guint shift = 63 - __builtin_clzll(usec) - GRIVER_HISTOGRAM_SUB_BITS;
+	guint sub = (guint) (usec >> shift) & (SUB_BUCKETS - 1);
+	return ((shift + 1) << GRIVER_HISTOGRAM_SUB_BITS) + sub;
+}
+
+/* The biggest value that ends up in bucket i */
+static guint64 bucket_upper (guint i)
+{
+	if (i < SUB_BUCKETS) {
+		return i;
+	}
+
+	guint shift = (i >> GRIVER_HISTOGRAM_SUB_BITS) - 1;
+	guint64 sub = (i & (SUB_BUCKETS - 1)) | SUB_BUCKETS;
+	return ((sub + 1) << shift) - 1;
+}
+
+static guint64 quantile (const GriverCounters *counters, double q)
+{
+	if (counters->latency_count == 0) {
+		return 0;
+	}
+
+	/* nearest rank */
+	double exact = q * counters->latency_count;
+	guint64 rank = (guint64) exact;
+	guint64 seen = 0;
+
+	if (rank < exact || rank == 0) {
+		rank++;
+	}
+
+	for (guint i = 0; i < GRIVER_HISTOGRAM_BUCKETS; i++) {
+		seen += counters->latency[i];
+		if (seen >= rank) {
+			return MIN(bucket_upper(i), counters->latency_max);
+		}
+	}
+	return counters->latency_max;
+}
+
+void griver_counters_reset (GriverCounters *counters)
+{
+	memset(counters, 0, sizeof(*counters));
+}
+
+void griver_counters_add_latency (GriverCounters *counters, guint64 usec)
+{
+	counters->latency[bucket_index(usec)]++;
+	counters->latency_count++;
+	counters->latency_max = MAX(counters->latency_max, usec);
+}
+
+void griver_counters_merge (GriverCounters *into, const GriverCounters *from)
+{
+	into->demands += from->demands;
+	into->commits += from->commits;
+	into->skipped += from->skipped;
+	into->stale += from->stale;
+	into->commands += from->commands;
+	into->speculated += from->speculated;
+
+	into->latency_count += from->latency_count;
+	into->latency_max = MAX(into->latency_max, from->latency_max);
+	for (guint i = 0; i < GRIVER_HISTOGRAM_BUCKETS; i++) {
+		into->latency[i] += from->latency[i];
+	}
+}
+
+GriverStats *griver_counters_to_stats (const GriverCounters *counters)
+{
+	GriverStats *stats = g_new(GriverStats, 1);
+
+	stats->demands = counters->demands;
+	stats->commits = counters->commits;
+	stats->skipped = counters->skipped;
+	stats->stale = counters->stale;
+	stats->commands = counters->commands;
+	stats->speculated = counters->speculated;
+
+	stats->latency_count = counters->latency_count;
+	stats->latency_p50 = quantile(counters, 0.5);
+	stats->latency_p99 = quantile(counters, 0.99);
+	stats->latency_max = counters->latency_max;
+	return stats;
+}
+
+/**
+ * g_river_stats_copy:
+ * @stats: A #GriverStats
+ *
+ * Returns: (transfer full): a copy of @stats
+ **/
+GriverStats *g_river_stats_copy(const GriverStats *stats)
+{
+	g_return_val_if_fail(stats != NULL, NULL);
+
+	GriverStats *copy = g_new(GriverStats, 1);
+	*copy = *stats;
+	return copy;
+}
+
+/**
+ * g_river_stats_free:
+ * @stats: A #GriverStats
+ *
+ * Frees stats returned by g_river_output_get_stats() or
+ * g_river_context_get_stats().
+ **/
+void g_river_stats_free(GriverStats *stats)
+{
+	g_free(stats);
+}
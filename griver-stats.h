@@ -0,0 +1,50 @@
+#ifndef __GRIVER_STATS_H__
+#define __GRIVER_STATS_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GRIVER_TYPE_STATS (g_river_stats_get_type())
+
+/**
+ * GriverStats:
+ * @demands: Layout demands received
+ * @commits: Layouts committed
+ * @skipped: Demands dropped because a newer one arrived at the same time
+ * @stale: Commits for a demand that wasn't the newest anymore
+ * @commands: User commands received
+ * @speculated: Demands answered with a layout computed ahead of time, see
+ *   g_river_output_set_speculative_layout()
+ * @latency_count: Number of demands the latency was measured for
+ * @latency_p50: Median time between a demand and its commit, in µs
+ * @latency_p99: 99th percentile of the time between a demand and its
+ *   commit, in µs
+ * @latency_max: Longest time between a demand and its commit, in µs
+ *
+ * A snapshot of the counters of an output, or the sum of every output of
+ * a context. The percentiles come from a histogram and are the upper bound
+ * of their bucket, within 1/8 of the real value.
+ **/
+typedef struct {
+	guint64 demands;
+	guint64 commits;
+	guint64 skipped;
+	guint64 stale;
+	guint64 commands;
+	guint64 speculated;
+
+	guint64 latency_count;
+	guint64 latency_p50;
+	guint64 latency_p99;
+	guint64 latency_max;
+} GriverStats;
+
+GType g_river_stats_get_type(void);
+
+GriverStats *g_river_stats_copy(const GriverStats *stats);
+void g_river_stats_free(GriverStats *stats);
+
+G_END_DECLS
+
+#endif /* __GRIVER_STATS_H__ */
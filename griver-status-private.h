@@ -0,0 +1,57 @@
+#ifndef __GRIVER_STATUS_PRIVATE_H__
+#define __GRIVER_STATUS_PRIVATE_H__
+
+#include <glib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <wayland-client.h>
+
+#include "river-status-unstable-v1-client-protocol.h"
+
+G_BEGIN_DECLS
+
+/* What river-status told us about an output */
+typedef struct {
+	uint32_t focused_tags;
+	uint32_t urgent_tags;
+	GArray *view_tags;      // uint32_t, one per view
+	uint32_t occupied_tags; // all view_tags or'ed together
+	bool focused;           // holds the focus of the seat
+} GriverOutputStatus;
+
+/* Which parts of a GriverOutputStatus changed */
+typedef enum {
+	GRIVER_STATUS_FOCUSED_TAGS  = 1 << 0,
+	GRIVER_STATUS_VIEW_TAGS     = 1 << 1,
+	GRIVER_STATUS_URGENT_TAGS   = 1 << 2,
+	GRIVER_STATUS_FOCUSED       = 1 << 3,
+	GRIVER_STATUS_VIEW_COUNT    = 1 << 4,
+	GRIVER_STATUS_OCCUPIED_TAGS = 1 << 5,
+} GriverStatusChange;
+
+/* Called after every event that changed the status of an output */
+typedef void (*GriverStatusFunc) (uint32_t output_name,
+		const GriverOutputStatus *status, GriverStatusChange changed,
+		gpointer user_data);
+
+typedef struct _GriverStatus GriverStatus;
+
+/* The status of every output on a connection, takes the manager */
+GriverStatus *griver_status_new (struct zriver_status_manager_v1 *manager,
+		GriverStatusFunc func, gpointer user_data);
+void griver_status_free (GriverStatus *status);
+
+void griver_status_add_output (GriverStatus *status, struct wl_output *wl_output,
+		uint32_t output_name);
+void griver_status_remove_output (GriverStatus *status, uint32_t output_name);
+
+/* Track which output has the focus of seat */
+void griver_status_set_seat (GriverStatus *status, struct wl_seat *seat);
+
+/* NULL until river sent the status of the output */
+const GriverOutputStatus *griver_status_lookup (GriverStatus *status,
+		uint32_t output_name);
+
+G_END_DECLS
+
+#endif /* __GRIVER_STATUS_PRIVATE_H__ */
@@ -0,0 +1,226 @@
+#include "griver-status-private.h"
+
+#include <string.h>
+
+/* The status of every output, from river-status on the connection shared
+ * by all contexts */
+struct _GriverStatus {
+	struct zriver_status_manager_v1 *manager;
+	struct zriver_seat_status_v1 *seat_status;
+	GHashTable *outputs; // output name -> StatusOutput
+
+	GriverStatusFunc func;
+	gpointer user_data;
+};
+
+typedef struct {
+	GriverStatus *status;
+	uint32_t name;
+	struct wl_output *wl_output;
+	struct zriver_output_status_v1 *output_status;
+	bool received;
+
+	GriverOutputStatus current;
+} StatusOutput;
+
+static void changed (StatusOutput *output, GriverStatusChange change)
+{
+	GriverStatus *status = output->status;
+
+	output->received = true;
+	if (change != 0) {
+		status->func(output->name, &output->current, change, status->user_data);
+	}
+}
+
+static void handle_focused_tags (void *data,
+		struct zriver_output_status_v1 *output_status, uint32_t tags)
+{
+	StatusOutput *output = data;
+	GriverStatusChange change = 0;
+
+	if (output->current.focused_tags != tags) {
+		output->current.focused_tags = tags;
+		change = GRIVER_STATUS_FOCUSED_TAGS;
+	}
+	changed(output, change);
+}
+
+static void handle_view_tags (void *data,
+		struct zriver_output_status_v1 *output_status, struct wl_array *tags)
+{
+	StatusOutput *output = data;
+	GArray *view_tags = output->current.view_tags;
+	guint n_views = tags->size / sizeof(uint32_t);
+	uint32_t occupied = 0;
+
+	if (view_tags->len == n_views &&
+			memcmp(view_tags->data, tags->data, n_views * sizeof(uint32_t)) == 0) {
+		changed(output, 0);
+		return;
+	}
+
+	g_array_set_size(view_tags, n_views);
+	memcpy(view_tags->data, tags->data, n_views * sizeof(uint32_t));
+	for (guint i = 0; i < n_views; i++) {
+		occupied |= g_array_index(view_tags, uint32_t, i);
+	}
+	GriverStatusChange change = GRIVER_STATUS_VIEW_TAGS;
+	if (output->current.occupied_tags != occupied) {
+		output->current.occupied_tags = occupied;
+		change |= GRIVER_STATUS_OCCUPIED_TAGS;
+	}
+	changed(output, change);
+}
+
+static void handle_urgent_tags (void *data,
+		struct zriver_output_status_v1 *output_status, uint32_t tags)
+{
+	StatusOutput *output = data;
+	GriverStatusChange change = 0;
+
+	if (output->current.urgent_tags != tags) {
+		output->current.urgent_tags = tags;
+		change = GRIVER_STATUS_URGENT_TAGS;
+	}
+	changed(output, change);
+}
+
+static const struct zriver_output_status_v1_listener output_status_listener = {
+	.focused_tags = handle_focused_tags,
+	.view_tags    = handle_view_tags,
+	.urgent_tags  = handle_urgent_tags,
+};
+
+static StatusOutput *find_output (GriverStatus *status, struct wl_output *wl_output)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	g_hash_table_iter_init(&iter, status->outputs);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		StatusOutput *output = value;
+		if (output->wl_output == wl_output) {
+			return output;
+		}
+	}
+	return NULL;
+}
+
+static void set_focused (GriverStatus *status, struct wl_output *wl_output,
+		bool focused)
+{
+	StatusOutput *output = find_output(status, wl_output);
+
+	if (output == NULL || output->current.focused == focused) {
+		return;
+	}
+	output->current.focused = focused;
+	changed(output, GRIVER_STATUS_FOCUSED);
+}
+
+static void handle_focused_output (void *data,
+		struct zriver_seat_status_v1 *seat_status, struct wl_output *wl_output)
+{
+	set_focused(data, wl_output, true);
+}
+
+static void handle_unfocused_output (void *data,
+		struct zriver_seat_status_v1 *seat_status, struct wl_output *wl_output)
+{
+	set_focused(data, wl_output, false);
+}
+
+static void handle_focused_view (void *data,
+		struct zriver_seat_status_v1 *seat_status, const char *title)
+{
+}
+
+static void handle_mode (void *data,
+		struct zriver_seat_status_v1 *seat_status, const char *name)
+{
+}
+
+static const struct zriver_seat_status_v1_listener seat_status_listener = {
+	.focused_output   = handle_focused_output,
+	.unfocused_output = handle_unfocused_output,
+	.focused_view     = handle_focused_view,
+	.mode             = handle_mode,
+};
+
+static void status_output_free (gpointer data)
+{
+	StatusOutput *output = data;
+
+	zriver_output_status_v1_destroy(output->output_status);
+	g_array_unref(output->current.view_tags);
+	g_free(output);
+}
+
+GriverStatus *griver_status_new (struct zriver_status_manager_v1 *manager,
+		GriverStatusFunc func, gpointer user_data)
+{
+	GriverStatus *status = g_new0(GriverStatus, 1);
+
+	status->manager = manager;
+	status->outputs = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+			NULL, status_output_free);
+	status->func = func;
+	status->user_data = user_data;
+	return status;
+}
+
+void griver_status_free (GriverStatus *status)
+{
+	if (status->seat_status != NULL) {
+		zriver_seat_status_v1_destroy(status->seat_status);
+	}
+	g_hash_table_destroy(status->outputs);
+	zriver_status_manager_v1_destroy(status->manager);
+	g_free(status);
+}
+
+void griver_status_add_output (GriverStatus *status, struct wl_output *wl_output,
+		uint32_t output_name)
+{
+	StatusOutput *output = g_new0(StatusOutput, 1);
+
+	output->status = status;
+	output->name = output_name;
+	output->wl_output = wl_output;
+	output->current.view_tags = g_array_new(false, false, sizeof(uint32_t));
+	output->output_status = zriver_status_manager_v1_get_river_output_status(
+			status->manager, wl_output);
+	zriver_output_status_v1_add_listener(output->output_status,
+			&output_status_listener, output);
+
+	g_hash_table_insert(status->outputs, GUINT_TO_POINTER(output_name), output);
+}
+
+void griver_status_remove_output (GriverStatus *status, uint32_t output_name)
+{
+	g_hash_table_remove(status->outputs, GUINT_TO_POINTER(output_name));
+}
+
+void griver_status_set_seat (GriverStatus *status, struct wl_seat *seat)
+{
+	if (status->seat_status != NULL) {
+		return;
+	}
+	status->seat_status = zriver_status_manager_v1_get_river_seat_status(
+			status->manager, seat);
+	zriver_seat_status_v1_add_listener(status->seat_status,
+			&seat_status_listener, status);
+}
+
+const GriverOutputStatus *griver_status_lookup (GriverStatus *status,
+		uint32_t output_name)
+{
+	StatusOutput *output = g_hash_table_lookup(status->outputs,
+			GUINT_TO_POINTER(output_name));
+
+	if (output == NULL || !output->received) {
+		return NULL;
+	}
+	return &output->current;
+}
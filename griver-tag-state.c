@@ -0,0 +1,64 @@
+#include "griver-tag-state.h"
+
+G_DEFINE_BOXED_TYPE (GriverTagState, g_river_tag_state,
+		g_river_tag_state_copy, g_river_tag_state_free)
+
+/**
+ * g_river_tag_state_new:
+ *
+ * Creates a new tag state with the default settings.
+ *
+ * Returns: (transfer full): a new tag state
+ **/
+GriverTagState *g_river_tag_state_new(void)
+{
+	GriverTagState *state = g_new(GriverTagState, 1);
+	g_river_tag_state_reset(state);
+	return state;
+}
+
+/**
+ * g_river_tag_state_copy:
+ * @state: A #GriverTagState
+ *
+ * Returns: (transfer full): a copy of @state
+ **/
+GriverTagState *g_river_tag_state_copy(const GriverTagState *state)
+{
+	g_return_val_if_fail(state != NULL, NULL);
+
+	GriverTagState *copy = g_new(GriverTagState, 1);
+	*copy = *state;
+	return copy;
+}
+
+/**
+ * g_river_tag_state_free:
+ * @state: A #GriverTagState
+ *
+ * Frees a tag state created with g_river_tag_state_new() or
+ * g_river_tag_state_copy().
+ **/
+void g_river_tag_state_free(GriverTagState *state)
+{
+	g_free(state);
+}
+
+/**
+ * g_river_tag_state_reset:
+ * @state: A #GriverTagState
+ *
+ * Sets @state back to the defaults, a tall layout with one main view
+ * taking 60% of the output and no padding.
+ **/
+void g_river_tag_state_reset(GriverTagState *state)
+{
+	g_return_if_fail(state != NULL);
+
+	state->main_count = 1;
+	state->view_padding = 0;
+	state->outer_padding = 0;
+	state->ratio = 0.6;
+	state->rotation = GRIVER_LEFT;
+	state->layout = GRIVER_LAYOUT_TALL;
+}
@@ -0,0 +1,44 @@
+#ifndef __GRIVER_TAG_STATE_H__
+#define __GRIVER_TAG_STATE_H__
+
+#include <glib-object.h>
+#include <stdint.h>
+#include "griver-layout.h"
+
+G_BEGIN_DECLS
+
+#define GRIVER_TYPE_TAG_STATE (g_river_tag_state_get_type())
+
+/* one slot per bit in river's tag bitfield */
+#define GRIVER_TAG_COUNT 32
+
+/**
+ * GriverTagState:
+ * @main_count: number of views in the main
+ * @view_padding: the padding between views.
+ * @outer_padding: the outer padding
+ * @ratio: ratio between master and secondary
+ * @rotation: Where the master should be.
+ * @layout: Which layout to use
+ *
+ * The layout settings of a single tag.
+ **/
+typedef struct {
+	uint32_t main_count;
+	uint32_t view_padding;
+	uint32_t outer_padding;
+	double ratio;
+	GriverRotation rotation;
+	GriverLayout layout;
+} GriverTagState;
+
+GType g_river_tag_state_get_type(void);
+
+GriverTagState *g_river_tag_state_new(void);
+GriverTagState *g_river_tag_state_copy(const GriverTagState *state);
+void g_river_tag_state_free(GriverTagState *state);
+void g_river_tag_state_reset(GriverTagState *state);
+
+G_END_DECLS
+
+#endif /* __GRIVER_TAG_STATE_H__ */
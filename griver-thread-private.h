@@ -0,0 +1,40 @@
+#ifndef __GRIVER_THREAD_PRIVATE_H__
+#define __GRIVER_THREAD_PRIVATE_H__
+
+#include <glib.h>
+#include <wayland-client.h>
+
+#include "river-layout-v3-client-protocol.h"
+
+G_BEGIN_DECLS
+
+/* A thread dispatching a private event queue that the river_layout_v3
+ * proxies of a context live on */
+typedef struct _GriverLayoutThread GriverLayoutThread;
+
+/* @dispatched is called on the thread, with the lock held, after every
+ * batch of dispatched events */
+GriverLayoutThread *griver_layout_thread_new (struct wl_display *display,
+		int cpu, int policy, int priority, GFunc dispatched, gpointer user_data);
+
+/* A layout manager whose new river_layout_v3 objects end up on the
+ * thread's queue */
+struct river_layout_manager_v3 *griver_layout_thread_wrap_manager (
+		GriverLayoutThread *thread, struct river_layout_manager_v3 *manager);
+
+gboolean griver_layout_thread_start (GriverLayoutThread *thread, GError **error);
+
+/* Stops and joins the thread, events still queued are dropped */
+void griver_layout_thread_stop (GriverLayoutThread *thread);
+
+/* Held by the thread while dispatching, take it when touching outputs
+ * from another thread */
+void griver_layout_thread_lock (GriverLayoutThread *thread);
+void griver_layout_thread_unlock (GriverLayoutThread *thread);
+
+/* Must be stopped and all proxies on the queue destroyed */
+void griver_layout_thread_free (GriverLayoutThread *thread);
+
+G_END_DECLS
+
+#endif /* __GRIVER_THREAD_PRIVATE_H__ */
@@ -0,0 +1,205 @@
+#define _GNU_SOURCE
+#include "griver-thread-private.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+struct _GriverLayoutThread {
+	struct wl_display *display;
+	struct wl_event_queue *queue;
+	struct river_layout_manager_v3 *manager;
+
+	GThread *thread;
+	GMutex lock;
+	int wakeup[2];
+
+	int cpu;
+	int policy;
+	int priority;
+
+	GFunc dispatched;
+	gpointer user_data;
+};
+
+GriverLayoutThread *griver_layout_thread_new (struct wl_display *display,
+		int cpu, int policy, int priority, GFunc dispatched, gpointer user_data)
+{
+	GriverLayoutThread *thread = g_new0(GriverLayoutThread, 1);
+
+	thread->display = display;
+	thread->queue = wl_display_create_queue(display);
+	thread->manager = NULL;
+	thread->thread = NULL;
+	thread->wakeup[0] = thread->wakeup[1] = -1;
+	thread->cpu = cpu;
+	thread->policy = policy;
+	thread->priority = priority;
+	thread->dispatched = dispatched;
+	thread->user_data = user_data;
+	g_mutex_init(&thread->lock);
+
+	return thread;
+}
+
+struct river_layout_manager_v3 *griver_layout_thread_wrap_manager (
+		GriverLayoutThread *thread, struct river_layout_manager_v3 *manager)
+{
+	if (manager == NULL) {
+		return NULL;
+	}
+
+	if (thread->manager == NULL) {
+		thread->manager = wl_proxy_create_wrapper(manager);
+		wl_proxy_set_queue((struct wl_proxy *) thread->manager, thread->queue);
+	}
+	return thread->manager;
+}
+
+static void setup_scheduling (GriverLayoutThread *thread)
+{
+	pthread_t self = pthread_self();
+
+	if (thread->cpu >= 0) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(thread->cpu, &set);
+		int err = pthread_setaffinity_np(self, sizeof(set), &set);
+		if (err != 0) {
+			g_warning("griver: can't pin layout thread to cpu %d: %s",
+					thread->cpu, strerror(err));
+		}
+	}
+
+	if (thread->policy >= 0) {
+		struct sched_param param = { .sched_priority = thread->priority };
+		int err = pthread_setschedparam(self, thread->policy, &param);
+		if (err != 0) {
+			g_warning("griver: can't set layout thread scheduling: %s",
+					strerror(err));
+		}
+	}
+}
+
+static bool dispatch_pending (GriverLayoutThread *thread)
+{
+	g_mutex_lock(&thread->lock);
+	int ret = wl_display_dispatch_queue_pending(thread->display, thread->queue);
+	if (ret >= 0 && thread->dispatched != NULL) {
+		thread->dispatched(thread, thread->user_data);
+	}
+	g_mutex_unlock(&thread->lock);
+
+	return ret >= 0;
+}
+
+static gpointer thread_main (gpointer data)
+{
+	GriverLayoutThread *thread = data;
+	struct pollfd fds[2] = {
+		{ .fd = wl_display_get_fd(thread->display), .events = POLLIN },
+		{ .fd = thread->wakeup[0], .events = POLLIN },
+	};
+
+	setup_scheduling(thread);
+
+	for (;;) {
+		while (wl_display_prepare_read_queue(thread->display, thread->queue) != 0) {
+			if (!dispatch_pending(thread)) {
+				return NULL;
+			}
+		}
+		wl_display_flush(thread->display);
+
+		if (poll(fds, G_N_ELEMENTS(fds), -1) < 0) {
+			wl_display_cancel_read(thread->display);
+			if (errno == EINTR) {
+				continue;
+			}
+			return NULL;
+		}
+
+		if (fds[1].revents) {
+			wl_display_cancel_read(thread->display);
+			return NULL;
+		}
+
+		if (fds[0].revents & POLLIN) {
+			if (wl_display_read_events(thread->display) < 0) {
+				return NULL;
+			}
+		} else {
+			wl_display_cancel_read(thread->display);
+			if (fds[0].revents & (POLLERR | POLLHUP)) {
+				return NULL;
+			}
+		}
+
+		if (!dispatch_pending(thread)) {
+			return NULL;
+		}
+	}
+}
+
+gboolean griver_layout_thread_start (GriverLayoutThread *thread, GError **error)
+{
+	g_return_val_if_fail(thread->thread == NULL, false);
+
+	if (pipe(thread->wakeup) < 0) {
+		g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errno),
+				"Can't create layout thread pipe: %s", strerror(errno));
+		return false;
+	}
+
+	thread->thread = g_thread_try_new("griver-layout", thread_main, thread, error);
+	if (thread->thread == NULL) {
+		close(thread->wakeup[0]);
+		close(thread->wakeup[1]);
+		thread->wakeup[0] = thread->wakeup[1] = -1;
+		return false;
+	}
+	return true;
+}
+
+void griver_layout_thread_stop (GriverLayoutThread *thread)
+{
+	if (thread->thread == NULL) {
+		return;
+	}
+
+	char c = 0;
+	while (write(thread->wakeup[1], &c, 1) < 0 && errno == EINTR)
+		;
+	g_thread_join(thread->thread);
+	thread->thread = NULL;
+
+	close(thread->wakeup[0]);
+	close(thread->wakeup[1]);
+	thread->wakeup[0] = thread->wakeup[1] = -1;
+}
+
+void griver_layout_thread_lock (GriverLayoutThread *thread)
+{
+	g_mutex_lock(&thread->lock);
+}
+
+void griver_layout_thread_unlock (GriverLayoutThread *thread)
+{
+	g_mutex_unlock(&thread->lock);
+}
+
+void griver_layout_thread_free (GriverLayoutThread *thread)
+{
+	griver_layout_thread_stop(thread);
+
+	if (thread->manager != NULL) {
+		wl_proxy_wrapper_destroy(thread->manager);
+	}
+	wl_event_queue_destroy(thread->queue);
+	g_mutex_clear(&thread->lock);
+	g_free(thread);
+}
@@ -0,0 +1,42 @@
+#ifndef __GRIVER_TRACE_PRIVATE_H__
+#define __GRIVER_TRACE_PRIVATE_H__
+
+#include "griver-trace.h"
+
+G_BEGIN_DECLS
+
+/* Set while g_river_trace_start() is recording, checked before anything
+ * else so tracing costs one load when it is off */
+extern gboolean griver_trace_enabled;
+
+/* The start of a span, 0 when not tracing */
+#define GRIVER_TRACE_BEGIN() \
+	(G_UNLIKELY(griver_trace_enabled) ? g_get_monotonic_time() : 0)
+
+/* Names and categories must be static strings, text is copied. Argument
+ * names can be NULL to leave the argument out */
+void griver_trace_span (const char *name, const char *category, gint64 start,
+		const char *arg_name, guint64 arg, const char *arg2_name, guint64 arg2);
+void griver_trace_instant (const char *name, const char *category,
+		const char *text, const char *arg_name, guint64 arg,
+		const char *arg2_name, guint64 arg2);
+
+/* Start tracing to $GRIVER_TRACE the first time it is called, the trace
+ * is closed when the process exits */
+void griver_trace_start_from_env (void);
+
+#define GRIVER_TRACE_SPAN(name, category, start, ...) \
+	G_STMT_START { \
+		if (G_UNLIKELY(griver_trace_enabled) && (start) != 0) \
+			griver_trace_span(name, category, start, __VA_ARGS__); \
+	} G_STMT_END
+
+#define GRIVER_TRACE_INSTANT(name, category, ...) \
+	G_STMT_START { \
+		if (G_UNLIKELY(griver_trace_enabled)) \
+			griver_trace_instant(name, category, __VA_ARGS__); \
+	} G_STMT_END
+
+G_END_DECLS
+
+#endif /* __GRIVER_TRACE_PRIVATE_H__ */
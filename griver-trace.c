@@ -0,0 +1,243 @@
+#include "griver-trace.h"
+#include "griver-trace-private.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* Events are buffered and written in batches, the file is in the JSON
+ * array format of the Chrome trace viewer, which Perfetto reads too. The
+ * array is only closed when tracing stops, the viewers accept a file that
+ * was cut off by a crash. */
+#define TRACE_BATCH 4096
+
+typedef struct {
+	const char *name;
+	const char *category;
+	char phase;         // 'X' for spans, 'i' for instants
+	guint tid;
+	gint64 ts;
+	gint64 dur;
+	char *text;
+	const char *arg_name;
+	guint64 arg;
+	const char *arg2_name;
+	guint64 arg2;
+} TraceEvent;
+
+gboolean griver_trace_enabled = false;
+
+static GMutex trace_lock;
+static FILE *trace_file = NULL;
+static GArray *trace_events = NULL;
+static int trace_pid = 0;
+static gint trace_next_tid = 0;
+static __thread guint trace_tid = 0;
+
+static guint current_tid (void)
+{
+	if (trace_tid == 0) {
+		trace_tid = g_atomic_int_add(&trace_next_tid, 1) + 1;
+	}
+	return trace_tid;
+}
+
+static void write_string (FILE *file, const char *str)
+{
+	fputc('"', file);
+	for (const unsigned char *c = (const unsigned char *) str; *c; c++) {
+		if (*c == '"' || *c == '\\') {
+			fputc('\\', file);
+			fputc(*c, file);
+		} else if (*c < 0x20) {
+			fprintf(file, "\\u%04x", *c);
+		} else {
+			fputc(*c, file);
+		}
+	}
+	fputc('"', file);
+}
+
+static void write_event (FILE *file, const TraceEvent *event)
+{
+	fputs("{\"name\":", file);
+	write_string(file, event->name);
+	fputs(",\"cat\":", file);
+	write_string(file, event->category);
+	fprintf(file, ",\"ph\":\"%c\",\"pid\":%d,\"tid\":%u,\"ts\":%" G_GINT64_FORMAT,
+			event->phase, trace_pid, event->tid, event->ts);
+	if (event->phase == 'X') {
+		fprintf(file, ",\"dur\":%" G_GINT64_FORMAT, event->dur);
+	} else {
+		fputs(",\"s\":\"t\"", file);
+	}
+
+	fputs(",\"args\":{", file);
+	const char *sep = "";
+	if (event->text != NULL) {
+		fputs("\"text\":", file);
+		write_string(file, event->text);
+		sep = ",";
+	}
+	if (event->arg_name != NULL) {
+		fprintf(file, "%s\"%s\":%" G_GUINT64_FORMAT, sep, event->arg_name,
+				event->arg);
+		sep = ",";
+	}
+	if (event->arg2_name != NULL) {
+		fprintf(file, "%s\"%s\":%" G_GUINT64_FORMAT, sep, event->arg2_name,
+				event->arg2);
+	}
+	fputs("}},\n", file);
+}
+
+/* Call with the lock held */
+static void flush_events (void)
+{
+	for (guint i = 0; i < trace_events->len; i++) {
+		TraceEvent *event = &g_array_index(trace_events, TraceEvent, i);
+		write_event(trace_file, event);
+		g_free(event->text);
+	}
+	g_array_set_size(trace_events, 0);
+	fflush(trace_file);
+}
+
+static void add_event (const TraceEvent *event)
+{
+	g_mutex_lock(&trace_lock);
+	if (trace_file != NULL) {
+		g_array_append_vals(trace_events, event, 1);
+		if (trace_events->len >= TRACE_BATCH) {
+			flush_events();
+		}
+	}
+	g_mutex_unlock(&trace_lock);
+}
+
+void griver_trace_span (const char *name, const char *category, gint64 start,
+		const char *arg_name, guint64 arg, const char *arg2_name, guint64 arg2)
+{
+	TraceEvent event = {
+		.name = name,
+		.category = category,
+		.phase = 'X',
+		.tid = current_tid(),
+		.ts = start,
+		.dur = g_get_monotonic_time() - start,
+		.arg_name = arg_name,
+		.arg = arg,
+		.arg2_name = arg2_name,
+		.arg2 = arg2,
+	};
+	add_event(&event);
+}
+
+void griver_trace_instant (const char *name, const char *category,
+		const char *text, const char *arg_name, guint64 arg,
+		const char *arg2_name, guint64 arg2)
+{
+	TraceEvent event = {
+		.name = name,
+		.category = category,
+		.phase = 'i',
+		.tid = current_tid(),
+		.ts = g_get_monotonic_time(),
+		.text = g_strdup(text),
+		.arg_name = arg_name,
+		.arg = arg,
+		.arg2_name = arg2_name,
+		.arg2 = arg2,
+	};
+	add_event(&event);
+}
+
+/**
+ * g_river_trace_start:
+ * @path: (type filename): Where to write the trace
+ * @error: a #GError
+ *
+ * Record what griver does to @path in the Chrome trace event format, to
+ * be opened in chrome://tracing or https://ui.perfetto.dev. The trace has
+ * the globals river announces, every layout demand and user command, the
+ * signal emissions, the time spent in the layout code and every push and
+ * commit, so a slow layout can be followed from demand to commit.
+ *
+ * Setting the environment variable GRIVER_TRACE to a path starts tracing
+ * when the first context is created.
+ *
+ * Returns: %TRUE if the file could be opened
+ **/
+gboolean g_river_trace_start(const char *path, GError **error)
+{
+	g_return_val_if_fail(path != NULL, false);
+
+	FILE *file = fopen(path, "we");
+	if (file == NULL) {
+		int saved_errno = errno;
+		g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+				"Can not open %s: %s", path, g_strerror(saved_errno));
+		return false;
+	}
+
+	g_river_trace_stop();
+
+	g_mutex_lock(&trace_lock);
+	trace_file = file;
+	trace_pid = getpid();
+	if (trace_events == NULL) {
+		trace_events = g_array_new(false, false, sizeof(TraceEvent));
+	}
+	fputs("[\n", trace_file);
+	g_atomic_int_set(&griver_trace_enabled, true);
+	g_mutex_unlock(&trace_lock);
+	return true;
+}
+
+/**
+ * g_river_trace_stop:
+ *
+ * Write what is left and close the trace started by
+ * g_river_trace_start().
+ **/
+void g_river_trace_stop(void)
+{
+	g_mutex_lock(&trace_lock);
+	g_atomic_int_set(&griver_trace_enabled, false);
+	if (trace_file != NULL) {
+		flush_events();
+		fprintf(trace_file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+				"\"args\":{\"name\":\"griver\"}}\n]\n", trace_pid);
+		fclose(trace_file);
+		trace_file = NULL;
+	}
+	g_mutex_unlock(&trace_lock);
+}
+
+static void stop_at_exit (void)
+{
+	g_river_trace_stop();
+}
+
+void griver_trace_start_from_env (void)
+{
+	static gsize started = 0;
+
+	if (!g_once_init_enter(&started)) {
+		return;
+	}
+
+	const char *path = g_getenv("GRIVER_TRACE");
+	GError *error = NULL;
+	if (path != NULL && *path != '\0') {
+		if (g_river_trace_start(path, &error)) {
+			atexit(stop_at_exit);
+		} else {
+			g_warning("Not tracing: %s", error->message);
+			g_error_free(error);
+		}
+	}
+	g_once_init_leave(&started, 1);
+}
@@ -0,0 +1,13 @@
+#ifndef __GRIVER_TRACE_H__
+#define __GRIVER_TRACE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+gboolean g_river_trace_start(const char *path, GError **error);
+void g_river_trace_stop(void);
+
+G_END_DECLS
+
+#endif /* __GRIVER_TRACE_H__ */
@@ -0,0 +1,749 @@
+#include "griver-layout-kernel.h"
+#include "griver-layout-program.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+static inline uint32_t min (uint32_t a, uint32_t b)
+{
+	return a < b ? a : b;
+}
+
+/* Views are transformed and copied out this many at a time when the caller
+ * wants an array of GriverRect */
+#define CHUNK 64
+
+/* Writes the views in order into a structure of arrays, dropping the first
+ * ones when only the rest needs to be recomputed. The views are still in
+ * the canonical orientation, see transform(). */
+typedef struct {
+	GriverRects soa;
+	uint32_t index;
+	uint32_t first;
+	uint32_t base;   // the view soa[0] belongs to
+
+	/* When set soa is a chunk of scratch space on the stack that is
+	 * flushed here */
+	GriverRect *out;
+	uint32_t usable_width;
+	const GriverLayoutParams *params;
+} Emit;
+
+static void flush (Emit *e);
+
+static void emit (Emit *e, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+	if (e->index >= e->first) {
+		uint32_t i = e->index - e->base;
+		e->soa.x[i] = x;
+		e->soa.y[i] = y;
+		e->soa.width[i] = width;
+		e->soa.height[i] = height;
+		if (e->out != NULL && i == CHUNK - 1) {
+			e->index++;
+			flush(e);
+			return;
+		}
+	}
+	e->index++;
+}
+
+/* Skip count views if none of them is wanted */
+static bool skip (Emit *e, uint32_t count)
+{
+	if (e->index + count <= e->first) {
+		e->index += count;
+		return true;
+	}
+	return false;
+}
+
+/* Split len into count parts, the first part gets the remainder, the same
+ * way the tall layout always has done it */
+static void split (uint32_t start, uint32_t len, uint32_t count, uint32_t i,
+		uint32_t *offset, uint32_t *size)
+{
+	uint32_t part = len / count;
+	uint32_t rem = len % count;
+
+	if (i == 0) {
+		*offset = start;
+		*size = part + rem;
+	} else {
+		*offset = start + i * part + rem;
+		*size = part;
+	}
+}
+
+/* Put count views on top of each other, dividing the height */
+static void stack (uint32_t x, uint32_t y, uint32_t width, uint32_t height,
+		uint32_t count, Emit *e)
+{
+	if (skip(e, count)) {
+		return;
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t ly, lheight;
+		split(y, height, count, i, &ly, &lheight);
+		emit(e, x, ly, width, lheight);
+	}
+}
+
+/* Put count views next to each other, dividing the width */
+static void row (uint32_t x, uint32_t y, uint32_t width, uint32_t height,
+		uint32_t count, Emit *e)
+{
+	if (skip(e, count)) {
+		return;
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t lx, lwidth;
+		split(x, width, count, i, &lx, &lwidth);
+		emit(e, lx, y, lwidth, height);
+	}
+}
+
+static void tall (uint32_t view_count, uint32_t width, uint32_t height,
+		uint32_t main_count, double ratio, Emit *e)
+{
+	uint32_t lmain_count = min(main_count, view_count);
+	uint32_t secondary_count = view_count - lmain_count;
+
+	if (lmain_count == 0 || secondary_count == 0) {
+		stack(0, 0, width, height, view_count, e);
+		return;
+	}
+
+	uint32_t main_width = (uint32_t) (ratio * width);
+	stack(0, 0, main_width, height, lmain_count, e);
+	stack(main_width, 0, width - main_width, height, secondary_count, e);
+}
+
+static void monocle (uint32_t x, uint32_t y, uint32_t view_count,
+		uint32_t width, uint32_t height, Emit *e)
+{
+	if (skip(e, view_count)) {
+		return;
+	}
+	for (uint32_t i = 0; i < view_count; i++) {
+		emit(e, x, y, width, height);
+	}
+}
+
+static void grid (uint32_t x, uint32_t y, uint32_t view_count,
+		uint32_t width, uint32_t height, Emit *e)
+{
+	uint32_t cols = (uint32_t) ceil(sqrt(view_count));
+	uint32_t rows = (view_count + cols - 1) / cols;
+
+	for (uint32_t r = 0; r < rows; r++) {
+		uint32_t ly, lheight;
+		uint32_t count = r == rows - 1 ? view_count - cols * (rows - 1) : cols;
+
+		split(y, height, rows, r, &ly, &lheight);
+		row(x, ly, width, lheight, count, e);
+	}
+}
+
+/* Every view but the last takes a part of what is left, the first split
+ * uses the main ratio and the rest split in half. The spiral variant also
+ * rotates which side the view is taken from. */
+static void dwindle (uint32_t view_count, uint32_t width, uint32_t height,
+		double ratio, bool spiral, Emit *e)
+{
+	uint32_t x = 0, y = 0;
+
+	for (uint32_t i = 0; i < view_count; i++) {
+		if (i == view_count - 1) {
+			emit(e, x, y, width, height);
+			break;
+		}
+
+		double r = i == 0 ? ratio : 0.5;
+		uint32_t side = spiral ? i % 4 : i % 2;
+
+		if (side % 2 == 0) {
+			uint32_t part = (uint32_t) (r * width);
+			if (side == 0) {
+				emit(e, x, y, part, height);
+				x += part;
+			} else {
+				emit(e, x + width - part, y, part, height);
+			}
+			width -= part;
+		} else {
+			uint32_t part = (uint32_t) (r * height);
+			if (side == 1) {
+				emit(e, x, y, width, part);
+				y += part;
+			} else {
+				emit(e, x, y + height - part, width, part);
+			}
+			height -= part;
+		}
+	}
+}
+
+static void centered_master (uint32_t view_count, uint32_t width, uint32_t height,
+		uint32_t main_count, double ratio, Emit *e)
+{
+	uint32_t lmain_count = min(main_count, view_count);
+	uint32_t secondary_count = view_count - lmain_count;
+
+	/* with only one side to fill, this is just tall */
+	if (lmain_count == 0 || secondary_count <= 1) {
+		tall(view_count, width, height, main_count, ratio, e);
+		return;
+	}
+
+	uint32_t main_width = (uint32_t) (ratio * width);
+	uint32_t left_width = (width - main_width) / 2;
+	uint32_t right_width = width - main_width - left_width;
+	uint32_t right_count = (secondary_count + 1) / 2;
+	uint32_t left_count = secondary_count / 2;
+
+	stack(left_width, 0, main_width, height, lmain_count, e);
+
+	/* alternate between the right and the left side */
+	for (uint32_t i = 0; i < secondary_count; i++) {
+		uint32_t ly, lheight;
+		if (i % 2 == 0) {
+			split(0, height, right_count, i / 2, &ly, &lheight);
+			emit(e, left_width + main_width, ly, right_width, lheight);
+		} else {
+			split(0, height, left_count, i / 2, &ly, &lheight);
+			emit(e, 0, ly, left_width, lheight);
+		}
+	}
+}
+
+static void multi_column (uint32_t view_count, uint32_t width, uint32_t height,
+		uint32_t main_count, double ratio, Emit *e)
+{
+	uint32_t lmain_count = min(main_count, view_count);
+	uint32_t secondary_count = view_count - lmain_count;
+
+	if (lmain_count == 0) {
+		row(0, 0, width, height, view_count, e);
+		return;
+	}
+	if (secondary_count == 0) {
+		stack(0, 0, width, height, view_count, e);
+		return;
+	}
+
+	uint32_t main_width = (uint32_t) (ratio * width);
+	stack(0, 0, main_width, height, lmain_count, e);
+	row(main_width, 0, width - main_width, height, secondary_count, e);
+}
+
+static void deck (uint32_t view_count, uint32_t width, uint32_t height,
+		uint32_t main_count, double ratio, Emit *e)
+{
+	uint32_t lmain_count = min(main_count, view_count);
+	uint32_t secondary_count = view_count - lmain_count;
+
+	if (lmain_count == 0) {
+		monocle(0, 0, view_count, width, height, e);
+		return;
+	}
+	if (secondary_count == 0) {
+		stack(0, 0, width, height, view_count, e);
+		return;
+	}
+
+	uint32_t main_width = (uint32_t) (ratio * width);
+	stack(0, 0, main_width, height, lmain_count, e);
+	if (skip(e, secondary_count)) {
+		return;
+	}
+	for (uint32_t i = 0; i < secondary_count; i++) {
+		emit(e, main_width, 0, width - main_width, height);
+	}
+}
+
+uint32_t griver_layout_stable_views (GriverLayout layout, uint32_t old_count,
+		uint32_t new_count, uint32_t main_count)
+{
+	uint32_t common = min(old_count, new_count);
+	/* the main area only depends on the secondary views being there */
+	bool main_stable = main_count > 0 && old_count > main_count &&
+		new_count > main_count;
+
+	if (common == 0) {
+		return 0;
+	}
+
+	switch (layout) {
+		case GRIVER_LAYOUT_MONOCLE:
+			return common;
+		case GRIVER_LAYOUT_DWINDLE:
+		case GRIVER_LAYOUT_SPIRAL:
+			/* only the last view fills what is left */
+			return common - 1;
+		case GRIVER_LAYOUT_TALL:
+		case GRIVER_LAYOUT_MULTI_COLUMN:
+			return main_stable ? main_count : 0;
+		case GRIVER_LAYOUT_CENTERED_MASTER:
+			/* one secondary view falls back to tall */
+			return main_stable && old_count - main_count > 1 &&
+				new_count - main_count > 1 ? main_count : 0;
+		case GRIVER_LAYOUT_DECK:
+			if (main_count == 0) {
+				return common;
+			}
+			/* every secondary view gets the same place */
+			return main_stable ? common : 0;
+		case GRIVER_LAYOUT_GRID:
+			return 0;
+	}
+	return 0;
+}
+
+/* The padding between views, a view never gets smaller than 1x1 */
+static inline uint32_t shrink (uint32_t size, uint32_t padding)
+{
+	return size > 2 * padding ? size - 2 * padding : 1;
+}
+
+/* Mirroring a view squeezed to 1x1 by the padding would go past 0 */
+static inline uint32_t clamp_sub (uint32_t a, uint32_t b)
+{
+	return a > b ? a - b : 0;
+}
+
+/* Moves the views from the canonical orientation, with the main area to the
+ * left, to the real one and adds the padding. One pass over every view,
+ * shared by all the layouts; the rotation is picked once and every loop is
+ * straight line code over the arrays, so the compiler can vectorize it. */
+static void transform (const GriverRects *rects, uint32_t from, uint32_t to,
+		uint32_t usable_width, const GriverLayoutParams *params)
+{
+	uint32_t *restrict xs = rects->x;
+	uint32_t *restrict ys = rects->y;
+	uint32_t *restrict ws = rects->width;
+	uint32_t *restrict hs = rects->height;
+	const uint32_t vp = params->view_padding;
+	const uint32_t op = params->outer_padding;
+	const uint32_t offset = vp + op;
+	/* x + vp + op mirrored in the usable width is edge - (x + w + vp) */
+	const uint32_t edge = usable_width + op;
+
+	switch (params->rotation) {
+		case GRIVER_LEFT:
+		default:
+			for (uint32_t i = from; i < to; i++) {
+				xs[i] += offset;
+				ys[i] += offset;
+				ws[i] = shrink(ws[i], vp);
+				hs[i] = shrink(hs[i], vp);
+			}
+			break;
+		case GRIVER_RIGHT:
+			for (uint32_t i = from; i < to; i++) {
+				uint32_t w = shrink(ws[i], vp);
+				xs[i] = clamp_sub(edge, xs[i] + w + vp);
+				ys[i] += offset;
+				ws[i] = w;
+				hs[i] = shrink(hs[i], vp);
+			}
+			break;
+		case GRIVER_TOP:
+			for (uint32_t i = from; i < to; i++) {
+				uint32_t x = xs[i], w = ws[i];
+				xs[i] = ys[i] + offset;
+				ys[i] = x + offset;
+				ws[i] = shrink(hs[i], vp);
+				hs[i] = shrink(w, vp);
+			}
+			break;
+		case GRIVER_BOTTOM:
+			for (uint32_t i = from; i < to; i++) {
+				uint32_t x = xs[i], w = shrink(ws[i], vp);
+				xs[i] = ys[i] + offset;
+				ys[i] = clamp_sub(edge, x + w + vp);
+				ws[i] = shrink(hs[i], vp);
+				hs[i] = w;
+			}
+			break;
+	}
+}
+
+/* Transform the chunk and copy it out as GriverRect */
+static void flush (Emit *e)
+{
+	uint32_t count = e->index - e->base;
+
+	transform(&e->soa, 0, count, e->usable_width, e->params);
+	for (uint32_t i = 0; i < count; i++) {
+		GriverRect *rect = &e->out[e->base + i];
+		rect->x = e->soa.x[i];
+		rect->y = e->soa.y[i];
+		rect->width = e->soa.width[i];
+		rect->height = e->soa.height[i];
+	}
+	e->base += count;
+}
+
+/* The kernels always put the main area to the left, turn the area around
+ * when it should be at the top or bottom */
+static void usable_area (uint32_t width, uint32_t height,
+		const GriverLayoutParams *params, uint32_t *usable_width,
+		uint32_t *usable_height)
+{
+	uint32_t outer = 2 * params->outer_padding;
+	bool turned = params->rotation == GRIVER_TOP || params->rotation == GRIVER_BOTTOM;
+	uint32_t w = turned ? height : width;
+	uint32_t h = turned ? width : height;
+
+	*usable_width = w > outer ? w - outer : 0;
+	*usable_height = h > outer ? h - outer : 0;
+}
+
+/* Evaluating a compiled layout spec, see griver-layout-program.h */
+
+static bool is_leaf (const GriverLayoutNode *node)
+{
+	return node->kind != GRIVER_NODE_H && node->kind != GRIVER_NODE_V;
+}
+
+/* Hand out count views evenly to the leaves of a kind */
+static uint32_t share_views (const GriverLayoutProgram *program,
+		GriverCountKind kind, uint32_t count, uint32_t *views)
+{
+	uint32_t n = 0, i, k = 0;
+
+	for (i = 0; i < program->n_nodes; i++) {
+		if (is_leaf(&program->nodes[i]) && program->nodes[i].count_kind == kind) {
+			n++;
+		}
+	}
+	if (n == 0) {
+		return 0;
+	}
+	for (i = 0; i < program->n_nodes; i++) {
+		if (is_leaf(&program->nodes[i]) && program->nodes[i].count_kind == kind) {
+			views[i] = count / n + (k++ < count % n ? 1 : 0);
+		}
+	}
+	return count;
+}
+
+/* How many views every node holds, containers count their leaves */
+static void assign_views (const GriverLayoutProgram *program, uint32_t view_count,
+		uint32_t main_count, uint32_t *views)
+{
+	uint32_t left = view_count;
+	uint32_t last_leaf = 0;
+
+	memset(views, 0, sizeof(uint32_t) * program->n_nodes);
+	left -= share_views(program, GRIVER_COUNT_MAIN, min(main_count, left), views);
+
+	for (uint32_t i = 0; i < program->n_nodes; i++) {
+		const GriverLayoutNode *node = &program->nodes[i];
+		if (!is_leaf(node)) {
+			continue;
+		}
+		last_leaf = i;
+		if (node->count_kind == GRIVER_COUNT_FIXED) {
+			views[i] = min(node->count, left);
+			left -= views[i];
+		}
+	}
+
+	left -= share_views(program, GRIVER_COUNT_REST, left, views);
+	views[last_leaf] += left;
+
+	for (uint32_t i = program->n_nodes; i-- > 0;) {
+		const GriverLayoutNode *node = &program->nodes[i];
+		if (is_leaf(node)) {
+			continue;
+		}
+		for (uint32_t c = i + 1; c < node->next; c = program->nodes[c].next) {
+			views[i] += views[c];
+		}
+	}
+}
+
+typedef struct {
+	uint32_t views[GRIVER_LAYOUT_PROGRAM_MAX];
+	uint32_t x[GRIVER_LAYOUT_PROGRAM_MAX];
+	uint32_t y[GRIVER_LAYOUT_PROGRAM_MAX];
+	uint32_t width[GRIVER_LAYOUT_PROGRAM_MAX];
+	uint32_t height[GRIVER_LAYOUT_PROGRAM_MAX];
+} ProgramState;
+
+/* Divide the area of a container between the children that have views */
+static void place (const GriverLayoutProgram *program, uint32_t i, uint32_t x,
+		uint32_t y, uint32_t width, uint32_t height, double ratio,
+		ProgramState *state)
+{
+	const GriverLayoutNode *node = &program->nodes[i];
+
+	state->x[i] = x;
+	state->y[i] = y;
+	state->width[i] = width;
+	state->height[i] = height;
+	if (is_leaf(node)) {
+		return;
+	}
+
+	bool horizontal = node->kind == GRIVER_NODE_H;
+	uint32_t total = horizontal ? width : height;
+	uint32_t offset = horizontal ? x : y;
+	uint32_t end = offset + total;
+	uint32_t n_share = 0, n_fixed = 0, last = 0;
+	double fixed = 0.0, share = 0.0, scale = 1.0;
+
+	for (uint32_t c = i + 1; c < node->next; c = program->nodes[c].next) {
+		const GriverLayoutNode *child = &program->nodes[c];
+		if (state->views[c] == 0) {
+			continue;
+		}
+		last = c;
+		if (child->weight_kind == GRIVER_WEIGHT_SHARE) {
+			n_share++;
+		} else {
+			n_fixed++;
+			fixed += child->weight_kind == GRIVER_WEIGHT_RATIO ? ratio : child->weight;
+		}
+	}
+
+	/* the weighted children get their part, the others share the rest; if
+	 * there are none, the weighted children are scaled up to fill it all.
+	 * When a ratio leaves nothing to share, the others are weighted like
+	 * an average weighted child and everything is scaled down to fit */
+	if (n_share > 0 && fixed < 1.0) {
+		share = (1.0 - fixed) / n_share;
+	} else if (n_share > 0) {
+		double average = fixed / n_fixed;
+		scale = 1.0 / (fixed + n_share * average);
+		share = average * scale;
+	} else if (fixed > 0.0) {
+		scale = 1.0 / fixed;
+	}
+
+	for (uint32_t c = i + 1; c < node->next; c = program->nodes[c].next) {
+		const GriverLayoutNode *child = &program->nodes[c];
+		if (state->views[c] == 0) {
+			continue;
+		}
+
+		uint32_t size;
+		if (c == last) {
+			size = end - offset;
+		} else {
+			double part = child->weight_kind == GRIVER_WEIGHT_SHARE ? share :
+				scale * (child->weight_kind == GRIVER_WEIGHT_RATIO ? ratio : child->weight);
+			size = min((uint32_t) (part * total), end - offset);
+		}
+
+		if (horizontal) {
+			place(program, c, offset, y, size, height, ratio, state);
+		} else {
+			place(program, c, x, offset, width, size, ratio, state);
+		}
+		offset += size;
+	}
+}
+
+static void emit_leaves (const GriverLayoutProgram *program, GriverCountKind kind,
+		const ProgramState *state, Emit *e)
+{
+	for (uint32_t i = 0; i < program->n_nodes; i++) {
+		const GriverLayoutNode *node = &program->nodes[i];
+		uint32_t count = state->views[i];
+
+		if (!is_leaf(node) || node->count_kind != kind || count == 0) {
+			continue;
+		}
+		switch (node->kind) {
+			case GRIVER_NODE_ROWS:
+				stack(state->x[i], state->y[i], state->width[i], state->height[i],
+						count, e);
+				break;
+			case GRIVER_NODE_COLS:
+				row(state->x[i], state->y[i], state->width[i], state->height[i],
+						count, e);
+				break;
+			case GRIVER_NODE_MONO:
+				monocle(state->x[i], state->y[i], count, state->width[i],
+						state->height[i], e);
+				break;
+			case GRIVER_NODE_GRID:
+				grid(state->x[i], state->y[i], count, state->width[i],
+						state->height[i], e);
+				break;
+		}
+	}
+}
+
+static void run_program (const GriverLayoutProgram *program, uint32_t view_count,
+		uint32_t usable_width, uint32_t usable_height, uint32_t main_count,
+		double ratio, Emit *e)
+{
+	ProgramState state;
+
+	if (program->n_nodes == 0) {
+		stack(0, 0, usable_width, usable_height, view_count, e);
+		return;
+	}
+
+	assign_views(program, view_count, main_count, state.views);
+	place(program, 0, 0, 0, usable_width, usable_height, ratio, &state);
+
+	/* in view order: main views first, then the fixed ones, then the rest */
+	emit_leaves(program, GRIVER_COUNT_MAIN, &state, e);
+	emit_leaves(program, GRIVER_COUNT_FIXED, &state, e);
+	emit_leaves(program, GRIVER_COUNT_REST, &state, e);
+}
+
+static void run_kernel (GriverLayout layout, const GriverLayoutProgram *program,
+		uint32_t view_count, uint32_t usable_width, uint32_t usable_height,
+		const GriverLayoutParams *params, Emit *e)
+{
+	uint32_t main_count = params->main_count;
+	double ratio = params->ratio;
+
+	if (!(ratio >= 0.0)) {
+		ratio = 0.0;
+	} else if (ratio > 1.0) {
+		ratio = 1.0;
+	}
+
+	if (program != NULL) {
+		run_program(program, view_count, usable_width, usable_height,
+				main_count, ratio, e);
+		return;
+	}
+
+	switch (layout) {
+		case GRIVER_LAYOUT_TALL:
+			tall(view_count, usable_width, usable_height, main_count, ratio, e);
+			break;
+		case GRIVER_LAYOUT_MONOCLE:
+			monocle(0, 0, view_count, usable_width, usable_height, e);
+			break;
+		case GRIVER_LAYOUT_GRID:
+			grid(0, 0, view_count, usable_width, usable_height, e);
+			break;
+		case GRIVER_LAYOUT_DWINDLE:
+			dwindle(view_count, usable_width, usable_height, ratio, false, e);
+			break;
+		case GRIVER_LAYOUT_SPIRAL:
+			dwindle(view_count, usable_width, usable_height, ratio, true, e);
+			break;
+		case GRIVER_LAYOUT_CENTERED_MASTER:
+			centered_master(view_count, usable_width, usable_height, main_count,
+					ratio, e);
+			break;
+		case GRIVER_LAYOUT_MULTI_COLUMN:
+			multi_column(view_count, usable_width, usable_height, main_count,
+					ratio, e);
+			break;
+		case GRIVER_LAYOUT_DECK:
+			deck(view_count, usable_width, usable_height, main_count, ratio, e);
+			break;
+		default:
+			/* unknown layouts stack everything */
+			tall(view_count, usable_width, usable_height, 0, ratio, e);
+			break;
+	}
+}
+
+static uint32_t compute_from (GriverLayout layout, const GriverLayoutProgram *program,
+		uint32_t view_count, uint32_t width, uint32_t height,
+		const GriverLayoutParams *params, uint32_t first, GriverRect *rects)
+{
+	uint32_t xs[CHUNK], ys[CHUNK], ws[CHUNK], hs[CHUNK];
+	uint32_t usable_width, usable_height;
+
+	if (view_count == 0 || first >= view_count) {
+		return 0;
+	}
+
+	usable_area(width, height, params, &usable_width, &usable_height);
+	Emit e = {
+		.soa = { .x = xs, .y = ys, .width = ws, .height = hs },
+		.index = 0,
+		.first = first,
+		.base = first,
+		.out = rects,
+		.usable_width = usable_width,
+		.params = params,
+	};
+
+	run_kernel(layout, program, view_count, usable_width, usable_height,
+			params, &e);
+	flush(&e);
+	return view_count - first;
+}
+
+static uint32_t compute_rects (GriverLayout layout, const GriverLayoutProgram *program,
+		uint32_t view_count, uint32_t width, uint32_t height,
+		const GriverLayoutParams *params, uint32_t first, const GriverRects *rects)
+{
+	uint32_t usable_width, usable_height;
+
+	if (view_count == 0 || first >= view_count) {
+		return 0;
+	}
+
+	usable_area(width, height, params, &usable_width, &usable_height);
+	Emit e = {
+		.soa = *rects,
+		.index = 0,
+		.first = first,
+		.base = 0,
+		.out = NULL,
+		.usable_width = usable_width,
+		.params = params,
+	};
+
+	run_kernel(layout, program, view_count, usable_width, usable_height,
+			params, &e);
+	transform(rects, first, view_count, usable_width, params);
+	return view_count - first;
+}
+
+uint32_t griver_layout_compute (GriverLayout layout, uint32_t view_count,
+		uint32_t width, uint32_t height, const GriverLayoutParams *params,
+		GriverRect *rects)
+{
+	return compute_from(layout, NULL, view_count, width, height, params, 0, rects);
+}
+
+uint32_t griver_layout_compute_from (GriverLayout layout, uint32_t view_count,
+		uint32_t width, uint32_t height, const GriverLayoutParams *params,
+		uint32_t first, GriverRect *rects)
+{
+	return compute_from(layout, NULL, view_count, width, height, params,
+			first, rects);
+}
+
+uint32_t griver_layout_compute_rects (GriverLayout layout, uint32_t view_count,
+		uint32_t width, uint32_t height, const GriverLayoutParams *params,
+		uint32_t first, const GriverRects *rects)
+{
+	return compute_rects(layout, NULL, view_count, width, height, params,
+			first, rects);
+}
+
+uint32_t griver_layout_program_compute (const GriverLayoutProgram *program,
+		uint32_t view_count, uint32_t width, uint32_t height,
+		const GriverLayoutParams *params, GriverRect *rects)
+{
+	return compute_from(GRIVER_LAYOUT_TALL, program, view_count, width, height,
+			params, 0, rects);
+}
+
+uint32_t griver_layout_program_compute_rects (const GriverLayoutProgram *program,
+		uint32_t view_count, uint32_t width, uint32_t height,
+		const GriverLayoutParams *params, const GriverRects *rects)
+{
+	return compute_rects(GRIVER_LAYOUT_TALL, program, view_count, width, height,
+			params, 0, rects);
+}
@@ -0,0 +1,68 @@
+#ifndef __GRIVER_LAYOUT_KERNEL_H__
+#define __GRIVER_LAYOUT_KERNEL_H__
+
+/* libgriver-layout: the layouts of griver without Wayland, GLib or any
+ * allocation. Everything is written into buffers owned by the caller, so
+ * the same code can answer river, draw a preview or be benchmarked. */
+
+#include <stdint.h>
+#include "griver-layout-types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A view, in output coordinates: (0,0) is the top left corner of the
+ * usable area river passed in the layout demand */
+typedef struct {
+	uint32_t x;
+	uint32_t y;
+	uint32_t width;
+	uint32_t height;
+} GriverRect;
+
+/* The same as a structure of arrays, every array has room for all the
+ * views. Faster for many views, and what GriverOutput uses. */
+typedef struct {
+	uint32_t *x;
+	uint32_t *y;
+	uint32_t *width;
+	uint32_t *height;
+} GriverRects;
+
+typedef struct {
+	uint32_t main_count;
+	uint32_t view_padding;
+	uint32_t outer_padding;
+	double ratio;
+	GriverRotation rotation;
+} GriverLayoutParams;
+
+/* Lays out view_count views in a width x height area, rects must have
+ * room for view_count of them. Returns the number of rects written. */
+uint32_t griver_layout_compute (GriverLayout layout, uint32_t view_count,
+		uint32_t width, uint32_t height, const GriverLayoutParams *params,
+		GriverRect *rects);
+
+/* Like griver_layout_compute() but leaves rects[0] to rects[first - 1]
+ * alone, the views before first are skipped without being computed when
+ * possible. Returns the number of rects written. */
+uint32_t griver_layout_compute_from (GriverLayout layout, uint32_t view_count,
+		uint32_t width, uint32_t height, const GriverLayoutParams *params,
+		uint32_t first, GriverRect *rects);
+
+/* Like griver_layout_compute_from() but into a structure of arrays */
+uint32_t griver_layout_compute_rects (GriverLayout layout, uint32_t view_count,
+		uint32_t width, uint32_t height, const GriverLayoutParams *params,
+		uint32_t first, const GriverRects *rects);
+
+/* How many of the first views keep their place when the view count goes
+ * from old_count to new_count, everything else being the same */
+uint32_t griver_layout_stable_views (GriverLayout layout, uint32_t old_count,
+		uint32_t new_count, uint32_t main_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GRIVER_LAYOUT_KERNEL_H__ */
@@ -0,0 +1,64 @@
+#ifndef __GRIVER_LAYOUT_PLUGIN_H__
+#define __GRIVER_LAYOUT_PLUGIN_H__
+
+/* Layout plugins: shared objects that griver loads and can swap while it
+ * keeps running, see g_river_layout_spec_new_from_plugin(). This header
+ * and griver-layout-kernel.h are the whole ABI, neither needs GLib.
+ *
+ * A plugin exports a function named GRIVER_LAYOUT_PLUGIN_SYMBOL:
+ *
+ *   static void compute (uint32_t view_count, uint32_t width,
+ *           uint32_t height, const GriverLayoutParams *params,
+ *           const GriverRects *rects)
+ *   {
+ *       griver_layout_compute_rects(GRIVER_LAYOUT_GRID, view_count,
+ *               width, height, params, 0, rects);
+ *   }
+ *
+ *   static const GriverLayoutPlugin plugin = {
+ *       .abi = GRIVER_LAYOUT_PLUGIN_ABI,
+ *       .size = sizeof(GriverLayoutPlugin),
+ *       .name = "###",
+ *       .compute = compute,
+ *   };
+ *
+ *   GRIVER_LAYOUT_PLUGIN_EXPORT const GriverLayoutPlugin *
+ *   griver_layout_plugin_v1 (void)
+ *   {
+ *       return &plugin;
+ *   }
+ */
+
+#include <stdint.h>
+#include "griver-layout-kernel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped when an existing field changes meaning, new fields are only ever
+ * added at the end and announced through size */
+#define GRIVER_LAYOUT_PLUGIN_ABI 1
+#define GRIVER_LAYOUT_PLUGIN_SYMBOL "griver_layout_plugin_v1"
+
+#define GRIVER_LAYOUT_PLUGIN_EXPORT __attribute__((visibility("default")))
+
+typedef struct {
+	uint32_t abi;       // GRIVER_LAYOUT_PLUGIN_ABI
+	uint32_t size;      // sizeof(GriverLayoutPlugin) the plugin was built with
+	const char *name;   // sent to river with every commit
+
+	/* Fill in all view_count views, like griver_layout_compute_rects()
+	 * with first 0: width and height are the whole output, padding and
+	 * rotation are up to the plugin. Must not keep the pointers. */
+	void (*compute) (uint32_t view_count, uint32_t width, uint32_t height,
+			const GriverLayoutParams *params, const GriverRects *rects);
+} GriverLayoutPlugin;
+
+typedef const GriverLayoutPlugin *(*GriverLayoutPluginFunc) (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GRIVER_LAYOUT_PLUGIN_H__ */
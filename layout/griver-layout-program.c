@@ -0,0 +1,258 @@
+#include "griver-layout-program.h"
+
+#include <math.h>
+#include <string.h>
+
+typedef struct {
+	const char *start;
+	const char *p;
+	GriverLayoutProgram *program;
+	const char *error;
+	const char *error_at;
+} Parser;
+
+static bool fail (Parser *ps, const char *message)
+{
+	if (ps->error == NULL) {
+		ps->error = message;
+		ps->error_at = ps->p;
+	}
+	return false;
+}
+
+static void skip_space (Parser *ps)
+{
+	while (*ps->p == ' ' || *ps->p == '\t' || *ps->p == '\n') {
+		ps->p++;
+	}
+}
+
+static bool accept (Parser *ps, char c)
+{
+	skip_space(ps);
+	if (*ps->p == c) {
+		ps->p++;
+		return true;
+	}
+	return false;
+}
+
+static bool is_alpha (char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static bool is_digit (char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+/* Accepts word if it is the next word in the input */
+static bool accept_word (Parser *ps, const char *word)
+{
+	size_t len = strlen(word);
+
+	skip_space(ps);
+	if (strncmp(ps->p, word, len) != 0 || is_alpha(ps->p[len])) {
+		return false;
+	}
+	ps->p += len;
+	return true;
+}
+
+/* Without strtod, which depends on the locale */
+static bool parse_number (Parser *ps, double *value)
+{
+	double v = 0.0, scale = 1.0;
+	bool digits = false;
+
+	skip_space(ps);
+	while (is_digit(*ps->p)) {
+		v = v * 10 + (*ps->p++ - '0');
+		digits = true;
+	}
+	if (*ps->p == '.') {
+		ps->p++;
+		while (is_digit(*ps->p)) {
+			scale /= 10;
+			v += (*ps->p++ - '0') * scale;
+			digits = true;
+		}
+	}
+	if (!digits) {
+		return fail(ps, "expected a number");
+	}
+	*value = v;
+	return true;
+}
+
+static bool parse_count (Parser *ps, GriverLayoutNode *node)
+{
+	double count;
+
+	if (accept_word(ps, "main")) {
+		node->count_kind = GRIVER_COUNT_MAIN;
+		return true;
+	}
+	if (accept(ps, '*')) {
+		node->count_kind = GRIVER_COUNT_REST;
+		return true;
+	}
+
+	const char *at = ps->p;
+	/* range checked before the cast, which is undefined outside of it */
+	if (!parse_number(ps, &count) || !(count >= 1 && count <= UINT32_MAX) ||
+			count != floor(count)) {
+		ps->p = at;
+		ps->error = NULL;
+		return fail(ps, "expected main, * or a whole number of views");
+	}
+	node->count_kind = GRIVER_COUNT_FIXED;
+	node->count = (uint32_t) count;
+	return true;
+}
+
+static bool parse_weight (Parser *ps, GriverLayoutNode *node)
+{
+	double weight;
+
+	if (accept_word(ps, "ratio")) {
+		node->weight_kind = GRIVER_WEIGHT_RATIO;
+		return true;
+	}
+
+	const char *at = ps->p;
+	if (!parse_number(ps, &weight)) {
+		return false;
+	}
+	if (weight <= 0.0 || weight > 1.0) {
+		ps->p = at;
+		return fail(ps, "a weight is a part of the parent, between 0 and 1");
+	}
+	node->weight_kind = GRIVER_WEIGHT_FIXED;
+	node->weight = weight;
+	return true;
+}
+
+/* Children without a weight share what the others leave, make sure
+ * something is left. The main ratio is only known when laying out, see
+ * place() in griver-layout-kernel.c for when it takes everything */
+static bool check_weights (Parser *ps, uint32_t index)
+{
+	const GriverLayoutProgram *program = ps->program;
+	double fixed = 0.0;
+	bool share = false;
+
+	for (uint32_t c = index + 1; c < program->n_nodes; c = program->nodes[c].next) {
+		const GriverLayoutNode *child = &program->nodes[c];
+		if (child->weight_kind == GRIVER_WEIGHT_SHARE) {
+			share = true;
+		} else if (child->weight_kind == GRIVER_WEIGHT_FIXED) {
+			fixed += child->weight;
+		}
+	}
+	if (share && fixed >= 1.0) {
+		return fail(ps, "the weights leave no room for the children without one");
+	}
+	return true;
+}
+
+static bool parse_node (Parser *ps)
+{
+	GriverLayoutProgram *program = ps->program;
+	static const struct {
+		const char *name;
+		GriverNodeKind kind;
+	} kinds[] = {
+		{ "h", GRIVER_NODE_H },
+		{ "v", GRIVER_NODE_V },
+		{ "rows", GRIVER_NODE_ROWS },
+		{ "cols", GRIVER_NODE_COLS },
+		{ "mono", GRIVER_NODE_MONO },
+		{ "grid", GRIVER_NODE_GRID },
+	};
+
+	if (program->n_nodes == GRIVER_LAYOUT_PROGRAM_MAX) {
+		return fail(ps, "too many nodes");
+	}
+
+	uint32_t index = program->n_nodes++;
+	GriverLayoutNode *node = &program->nodes[index];
+	size_t i;
+
+	memset(node, 0, sizeof(*node));
+	for (i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++) {
+		if (accept_word(ps, kinds[i].name)) {
+			break;
+		}
+	}
+	if (i == sizeof(kinds) / sizeof(kinds[0])) {
+		return fail(ps, "expected h, v, rows, cols, mono or grid");
+	}
+	node->kind = kinds[i].kind;
+	node->count_kind = GRIVER_COUNT_REST;
+	node->weight_kind = GRIVER_WEIGHT_SHARE;
+
+	if (node->kind == GRIVER_NODE_H || node->kind == GRIVER_NODE_V) {
+		if (!accept(ps, '(')) {
+			return fail(ps, "expected (");
+		}
+		do {
+			uint32_t child = program->n_nodes;
+			if (!parse_node(ps)) {
+				return false;
+			}
+			if (accept(ps, ':') && !parse_weight(ps, &program->nodes[child])) {
+				return false;
+			}
+		} while (accept(ps, ','));
+		if (!accept(ps, ')')) {
+			return fail(ps, "expected , or )");
+		}
+		if (!check_weights(ps, index)) {
+			return false;
+		}
+	} else if (accept(ps, '(')) {
+		if (!parse_count(ps, node)) {
+			return false;
+		}
+		if (!accept(ps, ')')) {
+			return fail(ps, "expected )");
+		}
+	}
+
+	node->next = (uint8_t) program->n_nodes;
+	return true;
+}
+
+bool griver_layout_program_compile (GriverLayoutProgram *program,
+		const char *spec, size_t *error_offset, const char **error_message)
+{
+	Parser ps = {
+		.start = spec,
+		.p = spec,
+		.program = program,
+		.error = NULL,
+		.error_at = NULL,
+	};
+
+	program->n_nodes = 0;
+	if (parse_node(&ps)) {
+		skip_space(&ps);
+		if (*ps.p != '\0') {
+			fail(&ps, "unexpected text after the layout");
+		}
+	}
+
+	if (ps.error != NULL) {
+		program->n_nodes = 0;
+		if (error_offset != NULL) {
+			*error_offset = (size_t) (ps.error_at - ps.start);
+		}
+		if (error_message != NULL) {
+			*error_message = ps.error;
+		}
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,92 @@
+#ifndef __GRIVER_LAYOUT_PROGRAM_H__
+#define __GRIVER_LAYOUT_PROGRAM_H__
+
+/* Layouts described by a string, compiled once into a program that
+ * griver_layout_program_compute() evaluates for every demand.
+ *
+ *   node      := container | leaf
+ *   container := ("h" | "v") "(" child ("," child)* ")"
+ *   leaf      := ("rows" | "cols" | "mono" | "grid") ["(" count ")"]
+ *   child     := node [":" weight]
+ *   count     := "main" | "*" | integer
+ *   weight    := "ratio" | number
+ *
+ * h puts its children side by side, v on top of each other. A child with
+ * a weight gets that part of its parent ("ratio" being the main ratio),
+ * the others share what is left, so the weights next to them have to add
+ * up to less than 1. Children without views give their space to their
+ * siblings.
+ *
+ * Leaves hold views: "main" leaves get the first main_count views, then
+ * leaves with a fixed count are filled, then "*" leaves (the default)
+ * share the rest. Views that fit nowhere go to the last leaf.
+ *
+ * The tall layout is "h(rows(main):ratio, rows)". */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "griver-layout-kernel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GRIVER_LAYOUT_PROGRAM_MAX 64
+
+typedef enum {
+	GRIVER_NODE_H,
+	GRIVER_NODE_V,
+	GRIVER_NODE_ROWS,
+	GRIVER_NODE_COLS,
+	GRIVER_NODE_MONO,
+	GRIVER_NODE_GRID,
+} GriverNodeKind;
+
+typedef enum {
+	GRIVER_COUNT_REST,
+	GRIVER_COUNT_MAIN,
+	GRIVER_COUNT_FIXED,
+} GriverCountKind;
+
+typedef enum {
+	GRIVER_WEIGHT_SHARE,
+	GRIVER_WEIGHT_FIXED,
+	GRIVER_WEIGHT_RATIO,
+} GriverWeightKind;
+
+/* Nodes are stored in pre-order, next is the index following the subtree */
+typedef struct {
+	uint8_t kind;
+	uint8_t count_kind;
+	uint8_t weight_kind;
+	uint8_t next;
+	uint32_t count;
+	double weight;
+} GriverLayoutNode;
+
+typedef struct {
+	uint32_t n_nodes;
+	GriverLayoutNode nodes[GRIVER_LAYOUT_PROGRAM_MAX];
+} GriverLayoutProgram;
+
+/* Returns false when spec isn't valid, with the offset in spec and a
+ * static message describing the problem if asked for */
+bool griver_layout_program_compile (GriverLayoutProgram *program,
+		const char *spec, size_t *error_offset, const char **error_message);
+
+/* Like griver_layout_compute() and griver_layout_compute_rects() but for a
+ * compiled program */
+uint32_t griver_layout_program_compute (const GriverLayoutProgram *program,
+		uint32_t view_count, uint32_t width, uint32_t height,
+		const GriverLayoutParams *params, GriverRect *rects);
+
+uint32_t griver_layout_program_compute_rects (const GriverLayoutProgram *program,
+		uint32_t view_count, uint32_t width, uint32_t height,
+		const GriverLayoutParams *params, const GriverRects *rects);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GRIVER_LAYOUT_PROGRAM_H__ */
@@ -0,0 +1,47 @@
+#ifndef __GRIVER_LAYOUT_TYPES_H__
+#define __GRIVER_LAYOUT_TYPES_H__
+
+/* Plain C, shared by libgriver and libgriver-layout */
+
+/**
+ * GriverLayout:
+ * @GRIVER_LAYOUT_TALL: Main views in a stack, the rest in a second stack
+ * @GRIVER_LAYOUT_MONOCLE: Every view covers the whole output
+ * @GRIVER_LAYOUT_GRID: Views in a grid of (almost) equal cells
+ * @GRIVER_LAYOUT_DWINDLE: Every view takes part of the space left, alternating the split direction
+ * @GRIVER_LAYOUT_SPIRAL: Like dwindle but the views spiral inwards
+ * @GRIVER_LAYOUT_CENTERED_MASTER: Main views in the middle, the rest on both sides
+ * @GRIVER_LAYOUT_MULTI_COLUMN: Main views in a stack, every other view in its own column
+ * @GRIVER_LAYOUT_DECK: Main views in a stack, the other views on top of each other
+ *
+ * The layouts that griver can compute natively. The main area is always
+ * placed according to the #GriverRotation passed along.
+ **/
+typedef enum {
+	GRIVER_LAYOUT_TALL,
+	GRIVER_LAYOUT_MONOCLE,
+	GRIVER_LAYOUT_GRID,
+	GRIVER_LAYOUT_DWINDLE,
+	GRIVER_LAYOUT_SPIRAL,
+	GRIVER_LAYOUT_CENTERED_MASTER,
+	GRIVER_LAYOUT_MULTI_COLUMN,
+	GRIVER_LAYOUT_DECK,
+} GriverLayout;
+
+/**
+ * GriverRotation:
+ * @GRIVER_LEFT: Put the master to the left
+ * @GRIVER_RIGHT: Put the master to the right
+ * @GRIVER_TOP: Put the master to at the top
+ * @GRIVER_BOTTOM: Put the master to at the bot
+ *
+ * A type to represents the orientation of tiling
+ **/
+typedef enum {
+	GRIVER_LEFT,
+	GRIVER_RIGHT,
+	GRIVER_TOP,
+	GRIVER_BOTTOM,
+} GriverRotation;
+
+#endif /* __GRIVER_LAYOUT_TYPES_H__ */
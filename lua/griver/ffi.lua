@@ -0,0 +1,158 @@
+-- griver through the LuaJIT FFI, see griver-ffi.h
+--
+-- Every call is a plain C call that the JIT compiles, unlike the lgi
+-- bindings. Events are pulled instead of delivered to callbacks:
+--
+--   local griver = require "griver.ffi"
+--   local ctx = griver.new "my-layout"
+--   for event in ctx:events() do
+--     if event.type == griver.DEMAND then ... end
+--   end
+local ffi = require "ffi"
+
+local VERSION = 1
+
+-- griver-ffi.h without the preprocessor lines, keep them the same
+ffi.cdef [[
+typedef struct _GriverFfi GriverFfi;
+typedef struct _GriverOutput GriverOutput;
+
+typedef struct {
+  int32_t type;
+  uint32_t uid;
+  GriverOutput *output;
+  uint32_t view_count;
+  uint32_t width;
+  uint32_t height;
+  uint32_t tags;
+  uint32_t serial;
+  const char *command;
+} GriverFfiEvent;
+
+typedef struct {
+  uint32_t main_count;
+  uint32_t view_padding;
+  uint32_t outer_padding;
+  uint32_t layout;
+  uint32_t rotation;
+  double ratio;
+} GriverFfiTagState;
+
+uint32_t griver_ffi_version(void);
+GriverFfi *griver_ffi_new(const char *layout_namespace);
+void griver_ffi_free(GriverFfi *ffi);
+void griver_ffi_register_tag_commands(GriverFfi *ffi);
+int griver_ffi_next_event(GriverFfi *ffi, GriverFfiEvent *event, int timeout_ms);
+const char *griver_ffi_get_error(GriverFfi *ffi);
+void griver_ffi_push(GriverOutput *output, uint32_t x, uint32_t y,
+  uint32_t width, uint32_t height, uint32_t serial);
+void griver_ffi_commit(GriverOutput *output, const char *layout_name,
+  uint32_t serial);
+void griver_ffi_push_rects(GriverOutput *output, const uint32_t *dimensions,
+  uint32_t n_dimensions, const char *layout_name, uint32_t serial);
+void griver_ffi_arrange(GriverOutput *output, uint32_t view_count,
+  uint32_t width, uint32_t height, uint32_t tags, uint32_t serial);
+void griver_ffi_get_tag_state(GriverOutput *output, uint32_t tags,
+  GriverFfiTagState *state);
+void griver_ffi_set_tag_state(GriverOutput *output, uint32_t tags,
+  const GriverFfiTagState *state);
+const char *griver_ffi_output_get_name(GriverOutput *output);
+]]
+
+local lib = ffi.load(os.getenv "GRIVER_LIBRARY" or "griver")
+
+if lib.griver_ffi_version() ~= VERSION then
+  error(string.format("griver.ffi is for version %d of griver-ffi.h, libgriver has %d",
+    VERSION, lib.griver_ffi_version()))
+end
+
+local M = {
+  lib = lib,
+
+  -- GriverFfiEventType
+  NONE = 0,
+  OUTPUT_ADD = 1,
+  OUTPUT_REMOVE = 2,
+  DEMAND = 3,
+  COMMAND = 4,
+
+  -- GriverLayout and GriverRotation
+  TALL = 0,
+  MONOCLE = 1,
+  GRID = 2,
+  DWINDLE = 3,
+  SPIRAL = 4,
+  CENTERED_MASTER = 5,
+  MULTI_COLUMN = 6,
+  DECK = 7,
+  LEFT = 0,
+  RIGHT = 1,
+  TOP = 2,
+  BOTTOM = 3,
+
+  -- answering a demand, output and serial come from the event
+  push = lib.griver_ffi_push,
+  commit = lib.griver_ffi_commit,
+  push_rects = lib.griver_ffi_push_rects,
+  arrange = lib.griver_ffi_arrange,
+}
+
+local Context = {}
+Context.__index = Context
+
+function M.new(namespace)
+  local ctx = {
+    handle = ffi.gc(lib.griver_ffi_new(namespace), lib.griver_ffi_free),
+    -- reused for every event, copy what has to outlive the next one
+    event = ffi.new "GriverFfiEvent",
+  }
+  return setmetatable(ctx, Context)
+end
+
+function Context:register_tag_commands()
+  lib.griver_ffi_register_tag_commands(self.handle)
+end
+
+-- The next event, nil after timeout_ms (-1 or nil to wait forever).
+-- Raises an error when the connection is lost
+function Context:next_event(timeout_ms)
+  local ret = lib.griver_ffi_next_event(self.handle, self.event, timeout_ms or -1)
+  if ret < 0 then
+    error(ffi.string(lib.griver_ffi_get_error(self.handle)))
+  end
+  if ret == 0 then
+    return nil
+  end
+  return self.event
+end
+
+-- for event in ctx:events() do ... end
+function Context:events()
+  return function()
+    return self:next_event(-1)
+  end
+end
+
+-- A GriverFfiTagState, filled with the settings of tags
+function M.get_tag_state(output, tags, state)
+  state = state or ffi.new "GriverFfiTagState"
+  lib.griver_ffi_get_tag_state(output, tags, state)
+  return state
+end
+
+M.set_tag_state = lib.griver_ffi_set_tag_state
+
+function M.output_name(output)
+  local name = lib.griver_ffi_output_get_name(output)
+  if name == nil then
+    return nil
+  end
+  return ffi.string(name)
+end
+
+-- Room for the dimensions of count views, for push_rects
+function M.rects(count)
+  return ffi.new("uint32_t[?]", 4 * count)
+end
+
+return M
@@ -0,0 +1,31 @@
+#ifndef __GRIVER_TESTS_CHECK_H__
+#define __GRIVER_TESTS_CHECK_H__
+
+/* What the tests share: check() counts and reports a failed condition
+ * without stopping, check_status() is what main() returns at the end.
+ * Every test is a single file, so the counter can live in here.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+static unsigned failures;
+
+#define check(cond, ...) do { \
+	if (!(cond)) { \
+		failures++; \
+		fprintf(stderr, "%s:%d: %s: ", __FILE__, __LINE__, #cond); \
+		fprintf(stderr, __VA_ARGS__); \
+		fputc('\n', stderr); \
+	} \
+} while (0)
+
+static inline int check_status (void)
+{
+	if (failures > 0) {
+		fprintf(stderr, "%u checks failed\n", failures);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+#endif /* __GRIVER_TESTS_CHECK_H__ */
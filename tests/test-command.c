@@ -0,0 +1,77 @@
+/* Checks the parser of the builtin commands: what the user sends has to
+ * match the argument completely, or it goes on as a user-command.
+ */
+#include <math.h>
+#include <stdbool.h>
+
+#include "griver-command-private.h"
+#include "check.h"
+
+static void test_accepted (GHashTable *table)
+{
+	GriverCommand cmd;
+
+	check(griver_command_parse(table, "main-location left", &cmd) != NULL &&
+			cmd.enum_value == 0, "main-location left");
+	check(griver_command_parse(table, "  main-location  BOTTOM  ", &cmd) != NULL &&
+			cmd.enum_value == 3, "main-location with spaces");
+	check(griver_command_parse(table, "layout centered-master", &cmd) != NULL &&
+			g_strcmp0(cmd.enum_name, "centered-master") == 0,
+			"layout centered-master");
+	check(griver_command_parse(table, "main-count +2", &cmd) != NULL &&
+			cmd.relative && cmd.int_value == 2, "main-count +2");
+	check(griver_command_parse(table, "view-padding 6 ", &cmd) != NULL &&
+			!cmd.relative && cmd.int_value == 6, "view-padding 6");
+	check(griver_command_parse(table, "main-ratio -0.05", &cmd) != NULL &&
+			cmd.relative && fabs(cmd.float_value + 0.05) < 1e-9,
+			"main-ratio -0.05");
+	check(griver_command_parse(table, "reset", &cmd) != NULL, "reset");
+}
+
+static void test_refused (GHashTable *table)
+{
+	static const char *refused[] = {
+		/* trailing words, for every type of argument */
+		"main-location left junk",
+		"layout tall monocle",
+		"main-count 2 junk",
+		"main-count 2junk",
+		"main-ratio 0.5 junk",
+		"reset junk",
+		"reload now",
+		/* no argument or a wrong one */
+		"main-count",
+		"main-count two",
+		"main-location leftish",
+		"main-location",
+		/* out of range */
+		"main-count 99999999999",
+		"view-padding -99999999999",
+		"main-ratio nan",
+		"main-ratio -inf",
+		"main-ratio +infinity",
+		"main-ratio 1e999",
+		/* not a command */
+		"",
+		"   ",
+		"main-counts 1",
+	};
+	GriverCommand cmd;
+
+	for (size_t i = 0; i < G_N_ELEMENTS(refused); i++) {
+		check(griver_command_parse(table, refused[i], &cmd) == NULL,
+				"\"%s\" parsed", refused[i]);
+	}
+}
+
+int main (void)
+{
+	GHashTable *table = griver_command_table_new();
+
+	griver_command_table_add_builtins(table);
+	test_accepted(table);
+	test_refused(table);
+	g_hash_table_unref(table);
+
+	return check_status();
+}
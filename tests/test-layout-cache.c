@@ -0,0 +1,118 @@
+/* Checks the layout cache of GriverOutput: a demand is answered from the
+ * cache when the same view count, size, tags and parameters were laid out
+ * before, with the same views, and laid out again otherwise. The output
+ * has no river_layout, so it keeps what it commits like when replaying.
+ */
+#include <string.h>
+
+#include "griver-output-private.h"
+#include "check.h"
+
+typedef struct {
+	guint calls;
+} Demands;
+
+static void demand (GriverOutput *out, uint32_t view_count, uint32_t width,
+		uint32_t height, uint32_t tags, uint32_t serial, gpointer user_data)
+{
+	Demands *demands = user_data;
+
+	demands->calls++;
+	g_river_output_arrange(out, view_count, width, height, tags, serial);
+}
+
+/* Sends a demand and returns whether the layout came from the cache */
+static bool cached (GriverOutput *out, Demands *demands, uint32_t view_count,
+		uint32_t width, uint32_t height, uint32_t tags)
+{
+	static uint32_t serial;
+	guint calls = demands->calls;
+
+	griver_output_replay_demand(out, view_count, width, height, tags, ++serial);
+
+	uint32_t committed_serial = 0;
+	const char *layout_name;
+	const uint32_t *dimensions;
+	guint n_dimensions = 0;
+	check(griver_output_get_last_commit(out, &committed_serial, &layout_name,
+				&dimensions, &n_dimensions) && committed_serial == serial &&
+			n_dimensions == view_count * 4,
+			"demand %u went unanswered, %u dimensions for %u views", serial,
+			n_dimensions, view_count);
+	return demands->calls == calls;
+}
+
+static GArray *last_commit (GriverOutput *out)
+{
+	uint32_t serial;
+	const char *layout_name;
+	const uint32_t *dimensions;
+	guint n_dimensions;
+	GArray *copy = g_array_new(false, false, sizeof(uint32_t));
+
+	if (griver_output_get_last_commit(out, &serial, &layout_name, &dimensions,
+				&n_dimensions)) {
+		g_array_append_vals(copy, dimensions, n_dimensions);
+	}
+	return copy;
+}
+
+static bool same_commit (GArray *a, GArray *b)
+{
+	return a->len == b->len &&
+		memcmp(a->data, b->data, a->len * sizeof(uint32_t)) == 0;
+}
+
+int main (void)
+{
+	GriverOutput *out = GRIVER_OUTPUT(g_river_output_new(NULL, NULL, 1, "test",
+			false));
+	Demands demands = { 0 };
+
+	g_river_output_set_layout_demand_func(out, demand, &demands, NULL);
+	g_river_output_set_layout_cache(out, true);
+
+	/* every view count keeps its own layout */
+	check(!cached(out, &demands, 2, 1920, 1080, 1), "nothing was cached yet");
+	GArray *two = last_commit(out);
+	check(!cached(out, &demands, 3, 1920, 1080, 1), "3 views were never laid out");
+	GArray *three = last_commit(out);
+	for (int i = 0; i < 3; i++) {
+		check(cached(out, &demands, 2, 1920, 1080, 1), "2 views missed");
+		GArray *commit = last_commit(out);
+		check(same_commit(commit, two), "2 views replayed differently");
+		g_array_unref(commit);
+
+		check(cached(out, &demands, 3, 1920, 1080, 1), "3 views missed");
+		commit = last_commit(out);
+		check(same_commit(commit, three), "3 views replayed differently");
+		g_array_unref(commit);
+	}
+
+	/* and so does every size and set of tags */
+	check(!cached(out, &demands, 2, 1280, 720, 1), "another size hit");
+	check(!cached(out, &demands, 2, 1920, 1080, 2), "other tags hit");
+	check(cached(out, &demands, 2, 1280, 720, 1), "the other size missed");
+	check(cached(out, &demands, 2, 1920, 1080, 1), "the first size missed");
+
+	/* parameter sets are cached side by side */
+	g_river_output_set_layout_params_hash(out, 1, 7);
+	check(!cached(out, &demands, 2, 1920, 1080, 1), "other parameters hit");
+	g_river_output_set_layout_params_hash(out, 1, 0);
+	check(cached(out, &demands, 2, 1920, 1080, 1),
+			"going back to the first parameters missed");
+
+	/* a command invalidates the layouts of its tags only */
+	g_river_output_invalidate_layout_cache(out, 1);
+	check(!cached(out, &demands, 2, 1920, 1080, 1), "an invalidated layout hit");
+	check(cached(out, &demands, 2, 1920, 1080, 2), "other tags were invalidated");
+
+	g_river_output_set_layout_cache(out, false);
+	check(!cached(out, &demands, 2, 1920, 1080, 1), "a disabled cache hit");
+
+	g_array_unref(two);
+	g_array_unref(three);
+	g_object_unref(out);
+
+	return check_status();
+}
@@ -0,0 +1,135 @@
+/* Checks what GriverOutput relies on for incremental layouts: computing
+ * from a view on gives the same rects as computing everything, and
+ * griver_layout_stable_views() never keeps a view whose rect changed.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "griver-layout-kernel.h"
+#include "check.h"
+
+#define MAX_VIEWS 300
+
+static const GriverLayout layouts[] = {
+	GRIVER_LAYOUT_TALL,
+	GRIVER_LAYOUT_MONOCLE,
+	GRIVER_LAYOUT_GRID,
+	GRIVER_LAYOUT_DWINDLE,
+	GRIVER_LAYOUT_SPIRAL,
+	GRIVER_LAYOUT_CENTERED_MASTER,
+	GRIVER_LAYOUT_MULTI_COLUMN,
+	GRIVER_LAYOUT_DECK,
+};
+#define N_LAYOUTS (sizeof(layouts) / sizeof(layouts[0]))
+
+static const GriverRotation rotations[] = {
+	GRIVER_LEFT, GRIVER_RIGHT, GRIVER_TOP, GRIVER_BOTTOM,
+};
+
+static bool rect_equal (const GriverRect *a, const GriverRect *b)
+{
+	return a->x == b->x && a->y == b->y && a->width == b->width &&
+		a->height == b->height;
+}
+
+/* Every first, up to 299 views so the chunks of 64 are crossed */
+static void test_compute_from (void)
+{
+	static GriverRect full[MAX_VIEWS], part[MAX_VIEWS];
+	static uint32_t xs[MAX_VIEWS], ys[MAX_VIEWS], ws[MAX_VIEWS], hs[MAX_VIEWS];
+	const GriverRects soa = { .x = xs, .y = ys, .width = ws, .height = hs };
+	const uint32_t counts[] = { 1, 2, 3, 4, 7, 63, 64, 65, 128, 129, 299 };
+
+	for (size_t l = 0; l < N_LAYOUTS; l++) {
+		for (size_t r = 0; r < 4; r++) {
+			for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+				uint32_t n = counts[c];
+				GriverLayoutParams p = {
+					.main_count = 2,
+					.view_padding = 3,
+					.outer_padding = 6,
+					.ratio = 0.6,
+					.rotation = rotations[r],
+				};
+				griver_layout_compute(layouts[l], n, 2560, 1440, &p, full);
+
+				for (uint32_t first = 0; first <= n; first++) {
+					uint32_t written = griver_layout_compute_from(layouts[l], n,
+							2560, 1440, &p, first, part);
+					check(written == n - first, "layout %d, %u views from %u: "
+							"%u rects", layouts[l], n, first, written);
+					for (uint32_t i = first; i < n; i++) {
+						check(rect_equal(&part[i], &full[i]),
+								"layout %d rotation %d, %u views from %u: "
+								"view %u differs", layouts[l], rotations[r],
+								n, first, i);
+					}
+
+					written = griver_layout_compute_rects(layouts[l], n, 2560,
+							1440, &p, first, &soa);
+					check(written == n - first, "layout %d, %u views from %u: "
+							"%u rects", layouts[l], n, first, written);
+					for (uint32_t i = first; i < n; i++) {
+						GriverRect rect = { xs[i], ys[i], ws[i], hs[i] };
+						check(rect_equal(&rect, &full[i]),
+								"layout %d rotation %d, %u views from %u: "
+								"view %u differs in the arrays", layouts[l],
+								rotations[r], n, first, i);
+					}
+				}
+			}
+		}
+	}
+}
+
+/* Going from any view count to any other, the views claimed stable are
+ * exactly where they were */
+static void test_stable_views (void)
+{
+	static GriverRect before[MAX_VIEWS], after[MAX_VIEWS];
+	const uint32_t max_count = 40;
+
+	for (size_t l = 0; l < N_LAYOUTS; l++) {
+		for (size_t r = 0; r < 4; r++) {
+			for (uint32_t main_count = 0; main_count <= 4; main_count++) {
+				GriverLayoutParams p = {
+					.main_count = main_count,
+					.view_padding = 2,
+					.outer_padding = 4,
+					.ratio = 0.55,
+					.rotation = rotations[r],
+				};
+
+				for (uint32_t old_count = 0; old_count <= max_count; old_count++) {
+					griver_layout_compute(layouts[l], old_count, 1920, 1080, &p,
+							before);
+					for (uint32_t new_count = 0; new_count <= max_count; new_count++) {
+						uint32_t stable = griver_layout_stable_views(layouts[l],
+								old_count, new_count, main_count);
+						check(stable <= old_count && stable <= new_count,
+								"layout %d: %u stable views going from %u to %u",
+								layouts[l], stable, old_count, new_count);
+
+						griver_layout_compute(layouts[l], new_count, 1920, 1080,
+								&p, after);
+						for (uint32_t i = 0; i < stable && i < new_count; i++) {
+							check(rect_equal(&before[i], &after[i]),
+									"layout %d rotation %d main count %u: view %u "
+									"moved going from %u to %u views but %u are "
+									"stable", layouts[l], rotations[r],
+									main_count, i, old_count, new_count, stable);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+int main (void)
+{
+	test_compute_from();
+	test_stable_views();
+
+	return check_status();
+}
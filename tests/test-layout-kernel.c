@@ -0,0 +1,359 @@
+/* Checks the layout kernels of libgriver-layout against rects worked out by
+ * hand, and the rotations, padding and both output formats against each
+ * other. Plain C like the library, run with meson test.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "griver-layout-kernel.h"
+#include "check.h"
+
+#define MAX_VIEWS 300
+
+static const GriverLayout layouts[] = {
+	GRIVER_LAYOUT_TALL,
+	GRIVER_LAYOUT_MONOCLE,
+	GRIVER_LAYOUT_GRID,
+	GRIVER_LAYOUT_DWINDLE,
+	GRIVER_LAYOUT_SPIRAL,
+	GRIVER_LAYOUT_CENTERED_MASTER,
+	GRIVER_LAYOUT_MULTI_COLUMN,
+	GRIVER_LAYOUT_DECK,
+};
+#define N_LAYOUTS (sizeof(layouts) / sizeof(layouts[0]))
+
+static const GriverRotation rotations[] = {
+	GRIVER_LEFT, GRIVER_RIGHT, GRIVER_TOP, GRIVER_BOTTOM,
+};
+
+static GriverLayoutParams params (uint32_t main_count, double ratio,
+		GriverRotation rotation, uint32_t view_padding, uint32_t outer_padding)
+{
+	return (GriverLayoutParams) {
+		.main_count = main_count,
+		.view_padding = view_padding,
+		.outer_padding = outer_padding,
+		.ratio = ratio,
+		.rotation = rotation,
+	};
+}
+
+static bool rect_equal (const GriverRect *a, const GriverRect *b)
+{
+	return a->x == b->x && a->y == b->y && a->width == b->width &&
+		a->height == b->height;
+}
+
+static void check_rects (const char *what, GriverLayout layout,
+		uint32_t view_count, uint32_t width, uint32_t height,
+		const GriverLayoutParams *p, const GriverRect *expected)
+{
+	GriverRect rects[MAX_VIEWS];
+	uint32_t n = griver_layout_compute(layout, view_count, width, height, p, rects);
+
+	check(n == view_count, "%s: %u rects for %u views", what, n, view_count);
+	for (uint32_t i = 0; i < n && i < view_count; i++) {
+		check(rect_equal(&rects[i], &expected[i]),
+				"%s: view %u is %u,%u %ux%u instead of %u,%u %ux%u", what, i,
+				rects[i].x, rects[i].y, rects[i].width, rects[i].height,
+				expected[i].x, expected[i].y, expected[i].width,
+				expected[i].height);
+	}
+}
+
+static void test_known_rects (void)
+{
+	GriverLayoutParams p;
+
+	p = params(1, 0.6, GRIVER_LEFT, 0, 0);
+	check_rects("tall, one view", GRIVER_LAYOUT_TALL, 1, 1000, 600, &p,
+			(GriverRect[]) { { 0, 0, 1000, 600 } });
+	check_rects("tall", GRIVER_LAYOUT_TALL, 3, 1000, 600, &p,
+			(GriverRect[]) {
+				{ 0, 0, 600, 600 },
+				{ 600, 0, 400, 300 },
+				{ 600, 300, 400, 300 },
+			});
+
+	/* the first view of a stack gets the remainder */
+	check_rects("tall, remainder", GRIVER_LAYOUT_TALL, 4, 1000, 601, &p,
+			(GriverRect[]) {
+				{ 0, 0, 600, 601 },
+				{ 600, 0, 400, 201 },
+				{ 600, 201, 400, 200 },
+				{ 600, 401, 400, 200 },
+			});
+
+	p = params(1, 0.6, GRIVER_RIGHT, 0, 0);
+	check_rects("tall, right", GRIVER_LAYOUT_TALL, 3, 1000, 600, &p,
+			(GriverRect[]) {
+				{ 400, 0, 600, 600 },
+				{ 0, 0, 400, 300 },
+				{ 0, 300, 400, 300 },
+			});
+
+	p = params(1, 0.6, GRIVER_TOP, 0, 0);
+	check_rects("tall, top", GRIVER_LAYOUT_TALL, 3, 1000, 600, &p,
+			(GriverRect[]) {
+				{ 0, 0, 1000, 360 },
+				{ 0, 360, 500, 240 },
+				{ 500, 360, 500, 240 },
+			});
+
+	p = params(1, 0.6, GRIVER_BOTTOM, 0, 0);
+	check_rects("tall, bottom", GRIVER_LAYOUT_TALL, 3, 1000, 600, &p,
+			(GriverRect[]) {
+				{ 0, 240, 1000, 360 },
+				{ 0, 0, 500, 240 },
+				{ 500, 0, 500, 240 },
+			});
+
+	/* more main views than views stacks them all */
+	p = params(5, 0.6, GRIVER_LEFT, 0, 0);
+	check_rects("tall, main count above view count", GRIVER_LAYOUT_TALL, 3,
+			1000, 600, &p,
+			(GriverRect[]) {
+				{ 0, 0, 1000, 200 },
+				{ 0, 200, 1000, 200 },
+				{ 0, 400, 1000, 200 },
+			});
+	check_rects("deck, main count above view count", GRIVER_LAYOUT_DECK, 2,
+			1000, 600, &p,
+			(GriverRect[]) {
+				{ 0, 0, 1000, 300 },
+				{ 0, 300, 1000, 300 },
+			});
+
+	p = params(0, 0.6, GRIVER_LEFT, 0, 0);
+	check_rects("multi-column, no main view", GRIVER_LAYOUT_MULTI_COLUMN, 3,
+			900, 600, &p,
+			(GriverRect[]) {
+				{ 0, 0, 300, 600 },
+				{ 300, 0, 300, 600 },
+				{ 600, 0, 300, 600 },
+			});
+
+	p = params(1, 0.5, GRIVER_LEFT, 0, 0);
+	check_rects("monocle", GRIVER_LAYOUT_MONOCLE, 2, 1000, 600, &p,
+			(GriverRect[]) {
+				{ 0, 0, 1000, 600 },
+				{ 0, 0, 1000, 600 },
+			});
+	check_rects("grid", GRIVER_LAYOUT_GRID, 3, 1000, 600, &p,
+			(GriverRect[]) {
+				{ 0, 0, 500, 300 },
+				{ 500, 0, 500, 300 },
+				{ 0, 300, 1000, 300 },
+			});
+	check_rects("dwindle", GRIVER_LAYOUT_DWINDLE, 4, 1000, 600, &p,
+			(GriverRect[]) {
+				{ 0, 0, 500, 600 },
+				{ 500, 0, 500, 300 },
+				{ 500, 300, 250, 300 },
+				{ 750, 300, 250, 300 },
+			});
+	check_rects("spiral", GRIVER_LAYOUT_SPIRAL, 4, 1000, 600, &p,
+			(GriverRect[]) {
+				{ 0, 0, 500, 600 },
+				{ 500, 0, 500, 300 },
+				{ 750, 300, 250, 300 },
+				{ 500, 300, 250, 300 },
+			});
+	check_rects("centered master", GRIVER_LAYOUT_CENTERED_MASTER, 3, 1000,
+			600, &p,
+			(GriverRect[]) {
+				{ 250, 0, 500, 600 },
+				{ 750, 0, 250, 600 },
+				{ 0, 0, 250, 600 },
+			});
+	check_rects("deck", GRIVER_LAYOUT_DECK, 3, 1000, 600, &p,
+			(GriverRect[]) {
+				{ 0, 0, 500, 600 },
+				{ 500, 0, 500, 600 },
+				{ 500, 0, 500, 600 },
+			});
+
+	/* the outer padding around the area, the view padding around every
+	 * view */
+	p = params(1, 0.5, GRIVER_LEFT, 5, 10);
+	check_rects("padding", GRIVER_LAYOUT_TALL, 2, 1000, 600, &p,
+			(GriverRect[]) {
+				{ 15, 15, 480, 570 },
+				{ 505, 15, 480, 570 },
+			});
+	p = params(1, 0.5, GRIVER_RIGHT, 5, 10);
+	check_rects("padding, right", GRIVER_LAYOUT_TALL, 2, 1000, 600, &p,
+			(GriverRect[]) {
+				{ 505, 15, 480, 570 },
+				{ 15, 15, 480, 570 },
+			});
+}
+
+static void test_no_views (void)
+{
+	GriverRect rects[1] = { { 7, 7, 7, 7 } };
+
+	for (size_t l = 0; l < N_LAYOUTS; l++) {
+		for (size_t r = 0; r < 4; r++) {
+			GriverLayoutParams p = params(1, 0.5, rotations[r], 5, 5);
+			uint32_t n = griver_layout_compute(layouts[l], 0, 1000, 600, &p, rects);
+			check(n == 0, "layout %d: %u rects without views", layouts[l], n);
+			check(rects[0].x == 7, "layout %d wrote a rect without views",
+					layouts[l]);
+		}
+	}
+}
+
+/* Without padding the views of the tiling layouts cover the area exactly
+ * once, the others stay inside it. Dwindle runs out of room after a few
+ * dozen views, those get the smallest size there is, 1x1, and pile up */
+static void check_tiles (GriverLayout layout, uint32_t view_count,
+		uint32_t width, uint32_t height, const GriverLayoutParams *p,
+		const GriverRect *rects)
+{
+	bool tiling = layout != GRIVER_LAYOUT_MONOCLE && layout != GRIVER_LAYOUT_DECK;
+	uint64_t area = 0;
+
+	for (uint32_t i = 0; i < view_count; i++) {
+		if (rects[i].width <= 1 || rects[i].height <= 1) {
+			tiling = false;
+		}
+	}
+
+	for (uint32_t i = 0; i < view_count; i++) {
+		const GriverRect *a = &rects[i];
+		check(a->x + a->width <= width && a->y + a->height <= height,
+				"layout %d rotation %d, %u views: view %u at %u,%u %ux%u is "
+				"outside of %ux%u", layout, p->rotation, view_count, i,
+				a->x, a->y, a->width, a->height, width, height);
+		area += (uint64_t) a->width * a->height;
+
+		for (uint32_t j = 0; tiling && j < i; j++) {
+			const GriverRect *b = &rects[j];
+			bool apart = a->x + a->width <= b->x || b->x + b->width <= a->x ||
+				a->y + a->height <= b->y || b->y + b->height <= a->y;
+			check(apart, "layout %d rotation %d, %u views: views %u and %u "
+					"overlap", layout, p->rotation, view_count, j, i);
+		}
+	}
+	if (tiling) {
+		check(area == (uint64_t) width * height,
+				"layout %d rotation %d, %u views: covers %llu of %llu",
+				layout, p->rotation, view_count, (unsigned long long) area,
+				(unsigned long long) width * height);
+	}
+}
+
+/* Every rotation is the left one turned around, and the structure of
+ * arrays gets the same rects as the array of GriverRect */
+static void test_rotations (void)
+{
+	static GriverRect left[MAX_VIEWS], turned[MAX_VIEWS], rects[MAX_VIEWS];
+	static uint32_t xs[MAX_VIEWS], ys[MAX_VIEWS], ws[MAX_VIEWS], hs[MAX_VIEWS];
+	const GriverRects soa = { .x = xs, .y = ys, .width = ws, .height = hs };
+	const uint32_t counts[] = { 1, 2, 3, 5, 8, 13, 64, 65, 200, 299 };
+	const uint32_t width = 1920, height = 1080;
+
+	for (size_t l = 0; l < N_LAYOUTS; l++) {
+		for (uint32_t main_count = 0; main_count <= 3; main_count++) {
+			for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+				uint32_t n = counts[c];
+				GriverLayoutParams p = params(main_count, 0.55, GRIVER_LEFT, 0, 0);
+				griver_layout_compute(layouts[l], n, width, height, &p, left);
+				check_tiles(layouts[l], n, width, height, &p, left);
+
+				p.rotation = GRIVER_RIGHT;
+				griver_layout_compute(layouts[l], n, width, height, &p, rects);
+				check_tiles(layouts[l], n, width, height, &p, rects);
+				for (uint32_t i = 0; i < n; i++) {
+					GriverRect mirrored = {
+						width - left[i].x - left[i].width, left[i].y,
+						left[i].width, left[i].height,
+					};
+					check(rect_equal(&rects[i], &mirrored),
+							"layout %d, %u views: view %u on the right is "
+							"not the mirror of the left", layouts[l], n, i);
+				}
+
+				/* top and bottom are left and right on the turned area */
+				for (size_t r = 0; r < 2; r++) {
+					GriverRotation from = r == 0 ? GRIVER_LEFT : GRIVER_RIGHT;
+					p.rotation = from;
+					griver_layout_compute(layouts[l], n, height, width, &p, turned);
+					p.rotation = r == 0 ? GRIVER_TOP : GRIVER_BOTTOM;
+					griver_layout_compute(layouts[l], n, width, height, &p, rects);
+					check_tiles(layouts[l], n, width, height, &p, rects);
+					for (uint32_t i = 0; i < n; i++) {
+						GriverRect transposed = {
+							turned[i].y, turned[i].x,
+							turned[i].height, turned[i].width,
+						};
+						check(rect_equal(&rects[i], &transposed),
+								"layout %d rotation %d, %u views: view %u is "
+								"not the turned around %d", layouts[l],
+								p.rotation, n, i, from);
+					}
+				}
+
+				for (size_t r = 0; r < 4; r++) {
+					p = params(main_count, 0.55, rotations[r], 4, 8);
+					griver_layout_compute(layouts[l], n, width, height, &p, rects);
+					uint32_t written = griver_layout_compute_rects(layouts[l], n,
+							width, height, &p, 0, &soa);
+					check(written == n, "layout %d: %u rects for %u views",
+							layouts[l], written, n);
+					for (uint32_t i = 0; i < n; i++) {
+						GriverRect rect = { xs[i], ys[i], ws[i], hs[i] };
+						check(rect_equal(&rect, &rects[i]),
+								"layout %d rotation %d, %u views: view %u "
+								"differs between the two formats",
+								layouts[l], rotations[r], n, i);
+					}
+				}
+			}
+		}
+	}
+}
+
+/* Padding that does not fit leaves 1x1 views, and never wraps around */
+static void test_huge_padding (void)
+{
+	GriverRect rects[8];
+	const uint32_t paddings[][2] = {
+		{ 0, 600 },   // outer padding eats the whole output
+		{ 1000, 0 },  // view padding wider than the output
+		{ 400, 400 },
+	};
+
+	for (size_t l = 0; l < N_LAYOUTS; l++) {
+		for (size_t r = 0; r < 4; r++) {
+			for (size_t i = 0; i < sizeof(paddings) / sizeof(paddings[0]); i++) {
+				GriverLayoutParams p = params(1, 0.5, rotations[r],
+						paddings[i][0], paddings[i][1]);
+				uint32_t n = griver_layout_compute(layouts[l], 8, 1000, 600, &p,
+						rects);
+				check(n == 8, "layout %d: %u rects for 8 views", layouts[l], n);
+				for (uint32_t v = 0; v < n; v++) {
+					check(rects[v].width == 1 && rects[v].height == 1,
+							"layout %d rotation %d padding %u/%u: view %u is "
+							"%ux%u", layouts[l], rotations[r], paddings[i][0],
+							paddings[i][1], v, rects[v].width, rects[v].height);
+					check(rects[v].x <= 2000 && rects[v].y <= 2000,
+							"layout %d rotation %d padding %u/%u: view %u at "
+							"%u,%u", layouts[l], rotations[r], paddings[i][0],
+							paddings[i][1], v, rects[v].x, rects[v].y);
+				}
+			}
+		}
+	}
+}
+
+int main (void)
+{
+	test_known_rects();
+	test_no_views();
+	test_rotations();
+	test_huge_padding();
+
+	return check_status();
+}
@@ -0,0 +1,79 @@
+/* Checks the layout spec compiler on what it has to refuse, and that a
+ * ratio taking the whole parent leaves room for the other children.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "griver-layout-program.h"
+#include "check.h"
+
+static void test_compile (void)
+{
+	static const char *valid[] = {
+		"rows",
+		"h(rows(main):ratio, rows)",
+		"h(rows(1), cols(4294967295), grid(*))",
+		"v(mono:0.3, rows:0.7)",
+		"h(rows:0.5, rows:0.49, rows)",
+	};
+	static const char *invalid[] = {
+		"rows(0)",
+		"rows(1.5)",
+		"rows(4294967296)",
+		"rows(99999999999999999999999999999999999999)",
+		"h(rows:0.5, rows:0.5, rows)",
+		"v(mono:1, grid)",
+		"h(rows:0, rows)",
+		"h(rows",
+		"rows junk",
+	};
+	GriverLayoutProgram program;
+	const char *message = NULL;
+	size_t offset = 0;
+
+	for (size_t i = 0; i < sizeof(valid) / sizeof(valid[0]); i++) {
+		bool ok = griver_layout_program_compile(&program, valid[i], &offset,
+				&message);
+		check(ok, "\"%s\" refused at %zu: %s", valid[i], offset, message);
+	}
+	for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+		message = NULL;
+		bool ok = griver_layout_program_compile(&program, invalid[i], &offset,
+				&message);
+		check(!ok, "\"%s\" compiled", invalid[i]);
+		check(ok || message != NULL, "\"%s\" refused without a message",
+				invalid[i]);
+		check(program.n_nodes == 0, "\"%s\" left %u nodes", invalid[i],
+				program.n_nodes);
+	}
+}
+
+static void test_full_ratio (void)
+{
+	GriverLayoutProgram program;
+	GriverRect rects[3];
+	GriverLayoutParams params = {
+		.main_count = 1,
+		.ratio = 1.0,
+		.rotation = GRIVER_LEFT,
+	};
+
+	check(griver_layout_program_compile(&program,
+				"h(rows(main):ratio, rows:0.5, rows)", NULL, NULL),
+			"the spec does not compile");
+	uint32_t n = griver_layout_program_compute(&program, 3, 1000, 600, &params,
+			rects);
+	check(n == 3, "%u rects for 3 views", n);
+	for (uint32_t i = 0; i < n; i++) {
+		check(rects[i].width > 1 && rects[i].x + rects[i].width <= 1000,
+				"view %u is at %u and %u wide", i, rects[i].x, rects[i].width);
+	}
+}
+
+int main (void)
+{
+	test_compile();
+	test_full_ratio();
+
+	return check_status();
+}
@@ -0,0 +1,158 @@
+/* Checks that tag states kept in a state file come back after reopening
+ * it, are shared by every handle, and that a broken file is started over
+ * without taking the states from whoever still has the old one mapped.
+ */
+#include <glib/gstdio.h>
+#include <math.h>
+#include <string.h>
+
+#include "griver-state-file-private.h"
+#include "check.h"
+
+static GriverStateFile *open_file (const char *path)
+{
+	GError *error = NULL;
+	GriverStateFile *file = griver_state_file_open(path, &error);
+
+	check(file != NULL, "can't open %s: %s", path,
+			error != NULL ? error->message : "no error");
+	g_clear_error(&error);
+	return file;
+}
+
+static void test_round_trip (const char *path)
+{
+	GriverStateFile *file = open_file(path);
+	bool restored = true;
+
+	GriverTagState *states = griver_state_file_lookup(file, "tile", "DP-1",
+			&restored);
+	check(states != NULL && !restored, "a new file restored DP-1");
+	states[0].main_count = 3;
+	states[0].ratio = 0.7;
+	states[5].layout = GRIVER_LAYOUT_GRID;
+	states[5].rotation = GRIVER_TOP;
+	griver_state_file_unref(file);
+
+	file = open_file(path);
+	states = griver_state_file_lookup(file, "tile", "DP-1", &restored);
+	check(states != NULL && restored, "DP-1 was not restored");
+	check(states[0].main_count == 3 && states[0].ratio == 0.7,
+			"tag 1 came back as %u, %f", states[0].main_count, states[0].ratio);
+	check(states[5].layout == GRIVER_LAYOUT_GRID &&
+			states[5].rotation == GRIVER_TOP, "tag 6 lost its layout");
+
+	/* the key is the namespace and the output */
+	check(griver_state_file_lookup(file, "tile", "DP-2", &restored) != states &&
+			!restored, "DP-2 got the states of DP-1");
+	check(griver_state_file_lookup(file, "monocle", "DP-1", &restored) != states &&
+			!restored, "another namespace got the states of DP-1");
+	griver_state_file_unref(file);
+}
+
+static void test_shared (const char *path)
+{
+	GriverStateFile *a = open_file(path);
+	GriverStateFile *b = open_file(path);
+	bool restored;
+
+	GriverTagState *states_a = griver_state_file_lookup(a, "tile", "HDMI-A-1",
+			&restored);
+	GriverTagState *states_b = griver_state_file_lookup(b, "tile", "HDMI-A-1",
+			&restored);
+	check(states_a != NULL && states_b != NULL && restored,
+			"the second handle doesn't see the output of the first");
+	states_a[2].outer_padding = 17;
+	check(states_b[2].outer_padding == 17, "a change didn't reach the other handle");
+
+	griver_state_file_unref(a);
+	griver_state_file_unref(b);
+}
+
+static void test_invalid_states (const char *path)
+{
+	GriverStateFile *file = open_file(path);
+	bool restored;
+
+	GriverTagState *states = griver_state_file_lookup(file, "tile", "eDP-1",
+			&restored);
+	states[1].ratio = NAN;
+	states[2].layout = (GriverLayout) 1000;
+	states[3].main_count = 2;
+	griver_state_file_unref(file);
+
+	GriverTagState defaults;
+	g_river_tag_state_reset(&defaults);
+	file = open_file(path);
+	states = griver_state_file_lookup(file, "tile", "eDP-1", &restored);
+	check(restored && states[1].ratio == defaults.ratio &&
+			states[2].layout == defaults.layout,
+			"broken tag states were restored");
+	check(states[3].main_count == 2, "a valid tag state was reset");
+	griver_state_file_unref(file);
+}
+
+static void test_replaced (const char *path)
+{
+	GriverStateFile *old = open_file(path);
+	bool restored;
+
+	GriverTagState *states = griver_state_file_lookup(old, "tile", "DP-3",
+			&restored);
+	states[0].view_padding = 9;
+
+	/* anything else at the path is started over, the old mapping stays */
+	check(g_file_set_contents(path, "junk", -1, NULL), "can't write %s", path);
+	GriverStateFile *file = open_file(path);
+	check(griver_state_file_lookup(file, "tile", "DP-3", &restored) != NULL &&
+			!restored, "a broken file restored DP-3");
+	check(states[0].view_padding == 9, "the old mapping changed");
+	states[0].view_padding = 10;
+
+	griver_state_file_unref(file);
+	griver_state_file_unref(old);
+}
+
+static void test_full (const char *path)
+{
+	GriverStateFile *file = open_file(path);
+	char long_name[300];
+	bool restored;
+	int n = 0;
+
+	for (; n < 1000; n++) {
+		char name[16];
+		g_snprintf(name, sizeof(name), "out-%d", n);
+		if (griver_state_file_lookup(file, "full", name, &restored) == NULL) {
+			break;
+		}
+	}
+	check(n > 0 && n < 1000, "%d outputs fit", n);
+
+	memset(long_name, 'x', sizeof(long_name) - 1);
+	long_name[sizeof(long_name) - 1] = '\0';
+	check(griver_state_file_lookup(file, "tile", long_name, &restored) == NULL,
+			"a key longer than a slot fit");
+	griver_state_file_unref(file);
+}
+
+int main (void)
+{
+	char *dir = g_dir_make_tmp("griver-state-XXXXXX", NULL);
+	char *path = g_build_filename(dir, "tag-state", NULL);
+
+	check(dir != NULL, "no temporary directory");
+	test_round_trip(path);
+	test_shared(path);
+	test_invalid_states(path);
+	test_replaced(path);
+	g_unlink(path);
+	test_full(path);
+
+	g_unlink(path);
+	g_rmdir(dir);
+	g_free(path);
+	g_free(dir);
+
+	return check_status();
+}